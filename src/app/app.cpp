@@ -0,0 +1,241 @@
+#include "app.h"
+#include "../common/logger.h"
+#include "../common/stats.h"
+#include "../common/trace.h"
+#include "../hal/hal.h"
+
+namespace App {
+
+namespace {
+
+Modules app;
+
+const char* gestureName(uint8_t event) {
+    switch (event) {
+        case EVENT_SINGLE_CLICK: return "SINGLE_CLICK";
+        case EVENT_DOUBLE_CLICK: return "DOUBLE_CLICK";
+        case EVENT_MULTI_CLICK: return "MULTI_CLICK";
+        case EVENT_LONG_PRESS: return "LONG_PRESS";
+        case EVENT_HOLD_REPEAT: return "HOLD_REPEAT";
+        case EVENT_HOLD_END: return "HOLD_END";
+        default: return "UNKNOWN";
+    }
+}
+
+void publishGesture(const ButtonGesture& gesture, uint8_t source) {
+    Stats::add(STAT_BUTTON_EVENTS);
+    Stats::record(STAT_HIST_BUTTON_EVENT, (uint32_t)Hal::nowUs() - gesture.timeUs);
+    if (source < BANK_SOURCE_FIRST) {
+        Logger::info(">>> BUTTON EVENT: %s (clicks %u)%s <<<", gestureName(gesture.event), gesture.clicks,
+                     gesture.upgrade ? " upgrade" : "");
+    } else {
+        Logger::info(">>> KEY %u EVENT: %s (clicks %u)%s <<<", gesture.key, gestureName(gesture.event),
+                     gesture.clicks, gesture.upgrade ? " upgrade" : "");
+    }
+
+    BusEvent event = {};
+    event.type = BUS_EVENT_BUTTON;
+    event.source = source;
+    event.traceId = gesture.traceId;
+    event.timeUs = gesture.timeUs;
+    event.payload.button.event = gesture.event;
+    event.payload.button.clicks = gesture.clicks;
+    event.payload.button.repeat = gesture.repeat;
+    event.payload.button.upgrade = gesture.upgrade;
+    event.payload.button.repeatMs = gesture.repeatMs;
+    Trace::mark(TRACE_GESTURE, gesture.traceId, gesture.event);
+    EventBus::publish(event);
+}
+
+}  // namespace
+
+void wire(const Modules& modules) {
+    app = modules;
+    UARTCommandHandler& uart = *app.uart;
+
+    uart.setPWMCallback([](uint8_t dutyCycle) {
+        return app.actor->setDutyCycle(0, dutyCycle, app.uart->commandOrigin());
+    });
+
+    uart.getPWMCallback([]() {
+        return app.actor->getDutyCycle();
+    });
+
+    uart.setChannelPWMCallback([](uint8_t channel, uint8_t dutyCycle) {
+        return app.actor->setDutyCycle(channel, dutyCycle, app.uart->commandOrigin());
+    });
+
+    uart.setFadeCallback([](uint8_t channel, uint8_t dutyCycle, uint32_t durationMs) {
+        return app.actor->fadeTo(channel, dutyCycle, durationMs, app.uart->commandOrigin());
+    });
+
+    uart.setPermilleCallback([](uint8_t channel, uint16_t permille) {
+        return app.actor->setDutyPermille(channel, permille, app.uart->commandOrigin());
+    });
+
+    uart.setPWMConfigCallback([](uint8_t channel, uint32_t frequency, uint8_t resolution) {
+        return app.actor->configureChannel(channel, frequency, resolution, app.uart->commandOrigin());
+    });
+
+    uart.setDitherCallback([](uint8_t channel, bool enabled) {
+        return app.actor->setDithering(channel, enabled, app.uart->commandOrigin());
+    });
+
+    uart.setBatchCallback([](const PWMDutyUpdate* updates, uint8_t count) {
+        return app.actor->applyBatch(updates, count, app.uart->commandOrigin());
+    });
+
+    uart.setSequenceLoadCallback([](uint16_t loops) {
+        return app.sequencer->load(loops);
+    });
+
+    // Таймер последовательности и контур не делят канал: кадры на канал контура отвергаются
+    uart.setSequenceKeyCallback([](const SequenceKey& key) {
+        return !app.actor->isReserved(key.channel) && app.sequencer->addKey(key);
+    });
+
+    uart.setSequencePlayCallback([](bool play) {
+        if (!play) {
+            app.sequencer->stop();
+            return true;
+        }
+        // Кадры могли загрузить до SET TARGET
+        if (app.sequencer->channelMask() & app.actor->reservedChannels()) {
+            return false;
+        }
+        return app.sequencer->play();
+    });
+
+    uart.setSequenceStatusCallback([](SequenceStatus& status) {
+        app.sequencer->status(status);
+    });
+
+    // Канал контура резервируется до первого такта: ручные команды на нём отвергает актор
+    uart.setLoopTargetCallback([](bool enable, uint16_t target) {
+        if (!enable) {
+            app.loop->disable();
+            app.actor->reserveChannels(0);
+            return true;
+        }
+        // Играющая последовательность с кадрами на канале контура держит его за собой
+        SequenceStatus sequence;
+        app.sequencer->status(sequence);
+        if (sequence.playing && (app.sequencer->channelMask() & (1U << PWM_LOOP_CHANNEL))) {
+            return false;
+        }
+        app.actor->reserveChannels(1U << PWM_LOOP_CHANNEL);
+        if (!app.loop->setTarget(target)) {
+            ClosedLoopStatus status;
+            app.loop->status(status);
+            app.actor->reserveChannels(status.enabled ? 1U << PWM_LOOP_CHANNEL : 0);
+            return false;
+        }
+        return true;
+    });
+
+    uart.setLoopGainsCallback([](uint32_t kpMilli, uint32_t kiMilli, uint32_t kdMilli) {
+        app.loop->setGains(kpMilli, kiMilli, kdMilli);
+    });
+
+    uart.setLoopStatusCallback([](ClosedLoopStatus& status) {
+        app.loop->status(status);
+    });
+
+    uart.setPWMStatusCallback([](PWMSnapshot& snapshot) {
+        app.actor->snapshot(snapshot);
+    });
+
+    // Выборка STREAM: снимок актора и счётчики, без захвата чужих задач
+    uart.setTelemetrySource([](TelemetrySample& sample) {
+        PWMSnapshot snapshot;
+        app.actor->snapshot(snapshot);
+        memcpy(sample.duty16, snapshot.duty16, sizeof(sample.duty16));
+        sample.activeMask = snapshot.activeMask;
+        sample.pwmApplied = snapshot.applied;
+        sample.pressed = app.button->isPressed();
+        sample.buttonEvents = Stats::counter(STAT_BUTTON_EVENTS);
+        sample.commands = Stats::counter(STAT_COMMANDS);
+        sample.rxBytes = Stats::counter(STAT_RX_BYTES);
+    });
+
+    // Действия ШИМ - в контексте публикации, первым подписчиком жестов
+    EventBus::subscribe(BUS_EVENT_MASK(BUS_EVENT_BUTTON), handleGesture);
+}
+
+void processButton() {
+    ButtonGesture gesture;
+
+    // Обновление логики кнопки по меткам времени фронтов
+    app.button->update();
+
+    while (app.button->getEvent(gesture)) {
+        publishGesture(gesture, gesture.key);
+    }
+}
+
+void processBank() {
+    if (!app.bank) {
+        return;
+    }
+    ButtonGesture gesture;
+
+    // Одна выборка всех клавиш; жесты в очереди уже помечены индексом клавиши
+    app.bank->scan();
+
+    while (app.bank->getEvent(gesture)) {
+        publishGesture(gesture, BANK_SOURCE_FIRST + gesture.key);
+    }
+}
+
+// Порядок команд кнопки сохраняется вместе с командами UART.
+// Задержка до применения считается от фронта/срока, породившего жест
+void handleGesture(const BusEvent& event) {
+    TraceOrigin origin = { event.timeUs, event.traceId };
+
+    // Канал 0 меняет только кнопка BUTTON_PIN; жесты клавиш панели - для других подписчиков
+    if (event.source >= BANK_SOURCE_FIRST) {
+        return;
+    }
+
+    // Кнопка меняет канал 0; пока им управляет контур, жесты не применяются
+    if (app.actor->isReserved(0)) {
+        uint8_t gesture = event.payload.button.event;
+        if (gesture == EVENT_SINGLE_CLICK || gesture == EVENT_DOUBLE_CLICK || gesture == EVENT_LONG_PRESS) {
+            Logger::info("Button ignored: PWM channel 0 is driven by closed loop");
+        }
+        return;
+    }
+
+    switch (event.payload.button.event) {
+        case EVENT_SINGLE_CLICK:
+            app.actor->increaseDutyCycle(origin);
+            break;
+
+        case EVENT_DOUBLE_CLICK:
+            // При спекулятивном клике +10% уже применён - сброс в 0 его перекрывает
+            app.actor->setDutyCycle(0, 0, origin);
+            break;
+
+        case EVENT_LONG_PRESS:
+            Logger::info("LONG PRESS STARTED - cyclic PWM change");
+            // Сразу делаем первое изменение; шаг тянется до следующего автоповтора
+            app.actor->cycleDutyCycle(event.payload.button.repeatMs, origin);
+            break;
+
+        case EVENT_HOLD_REPEAT:
+            // Темп задаёт автомат жестов (с ускорением) - каждый повтор даёт шаг
+            app.actor->cycleDutyCycle(event.payload.button.repeatMs, origin);
+            break;
+
+        case EVENT_HOLD_END:
+            // Завершение длительного нажатия
+            app.actor->resetLongPressCycle(origin);
+            Logger::info("LONG PRESS ENDED");
+            break;
+
+        default:
+            break;
+    }
+}
+
+}  // namespace App
@@ -0,0 +1,50 @@
+#ifndef APP_H
+#define APP_H
+
+#include <Arduino.h>
+#include "../button/button.h"
+#include "../button/button_bank.h"
+#include "../pwm/pwm_actor.h"
+#include "../pwm/sequencer.h"
+#include "../pwm/closed_loop.h"
+#include "../uart/uart.h"
+#include "../common/event_bus.h"
+
+/**
+ * Связи модулей прошивки: кнопка и панель клавиш -> шина событий -> PWMActor
+ * и команды UART -> PWMActor, секвенсор и контур.
+ *
+ * Одна реализация на прошивку (main.cpp) и хостовый симулятор
+ * (src/sim/sim_main.cpp): они различаются только тем, кто вызывает
+ * processButton, processBank, processCommands и processNext - задачи, реактор или
+ * цикл симулятора. Модули создаёт и запускает (begin) вызывающий.
+ */
+namespace App {
+
+// Источник BUS_EVENT_BUTTON: 0 - кнопка BUTTON_PIN, BANK_SOURCE_FIRST + k - клавиша k панели
+const uint8_t BANK_SOURCE_FIRST = 1;
+
+struct Modules {
+    Button* button;
+    ButtonBank* bank;           // nullptr - панели нет
+    PWMActor* actor;
+    PWMSequencer* sequencer;
+    PWMClosedLoop* loop;
+    UARTCommandHandler* uart;
+};
+
+// Колбэки UART, выборка STREAM и подписка жестов на шину; до запуска задач
+void wire(const Modules& modules);
+
+// Фронты -> жесты -> шина событий; не блокируется
+void processButton();
+
+// Скан панели -> жесты клавиш -> шина событий; без панели ничего не делает
+void processBank();
+
+// Действия кнопки: команды владельцу ШИМ в контексте публикации
+void handleGesture(const BusEvent& event);
+
+}  // namespace App
+
+#endif
@@ -1,79 +1,170 @@
 #include "button.h"
+#include "../common/stats.h"
+#include "../common/trace.h"
+#include "../hal/hal.h"
 
-Button::Button(uint8_t pin) : pin_(pin), currentState_(HIGH), lastState_(HIGH),
-                             lastPressTime_(0), lastReleaseTime_(0),
-                             lastDebounceTime_(0), clickCount_(0),
-                             longPressEventSent_(false) {  // Инициализируем новое поле
+namespace {
+
+inline uint32_t nowUs() {
+    return (uint32_t)Hal::nowUs();
 }
 
-void Button::begin() {
-    pinMode(pin_, INPUT_PULLUP);
-    Logger::info("Button initialized on pin " + String(pin_));
+}  // namespace
+
+Button::Button(uint8_t pin, const GestureTiming& timing)
+    : pin_(pin), currentState_(HIGH), rawState_(HIGH), settling_(false),
+      burstStartUs_(0), lastEdgeUs_(0), burstTraceId_(0), acceptedTraceId_(0), gestures_(timing), edgesLost_(false), task_(nullptr),
+      notifyBits_(0) {
 }
 
-void Button::update() {
-    bool reading = digitalRead(pin_);
+void Button::setTiming(const GestureTiming& timing) {
+    gestures_.setTiming(timing);
+}
+
+void Button::begin() {
+    Hal::pinMode(pin_, INPUT_PULLUP);
+    currentState_ = rawState_ = readLevel();
     
-    // Фильтрация дребезга
-    if (reading != lastState_) {
-        lastDebounceTime_ = millis();
+    // Фронты снимаются прерыванием, опрос входа по таймеру не нужен
+    Hal::attachEdgeInterrupt(pin_, edgeISR, this);
+    Logger::info("Button initialized on pin %u (edge interrupt)", pin_);
+}
+
+bool IRAM_ATTR Button::readLevel() const {
+    // Прямое чтение GPIO_IN/GPIO_IN1: безопасно в ISR, в отличие от digitalRead
+    return (Hal::readInputs(pin_ / 32) >> (pin_ % 32)) & 1;
+}
+
+void IRAM_ATTR Button::edgeISR(void* arg) {
+    Button* button = static_cast<Button*>(arg);
+    ButtonEdge edge = { nowUs(), button->readLevel() };
+    if (!button->edges_.put(edge)) {
+        button->edgesLost_ = true;
     }
     
-    if ((millis() - lastDebounceTime_) > DEBOUNCE_DELAY_MS) {
-        if (reading != currentState_) {
-            currentState_ = reading;
-            
-            if (currentState_ == LOW) {
-                // Кнопка нажата
-                lastPressTime_ = millis();
-                longPressEventSent_ = false;  // Сбрасываем флаг при новом нажатии
-                Logger::debug("Button pressed");
-            } else {
-                // Кнопка отпущена
-                lastReleaseTime_ = millis();
-                clickCount_++;
-                Logger::debug("Button released, click count: " + String(clickCount_));
-                
-                // Сбрасываем флаг длительного нажатия при отпускании
-                longPressEventSent_ = false;
-            }
+    TaskHandle_t task = button->task_;
+    if (task) {
+        BaseType_t woken = pdFALSE;
+        if (button->notifyBits_) {
+            xTaskNotifyFromISR(task, button->notifyBits_, eSetBits, &woken);
+        } else {
+            vTaskNotifyGiveFromISR(task, &woken);
         }
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+void Button::waitForEdges() {
+    if (!task_) {
+        task_ = xTaskGetCurrentTaskHandle();
     }
     
-    lastState_ = reading;
+    // Фронты могли прийти до регистрации задачи - тогда не спим
+    if (!edges_.isEmpty()) {
+        return;
+    }
+    ulTaskNotifyTake(pdTRUE, ticksUntilDeadline(nowUs()));
+}
+
+void Button::notifyTask(TaskHandle_t task, uint32_t bits) {
+    notifyBits_ = bits;
+    task_ = task;
 }
 
-ButtonEvent Button::getEvent() {
-    ButtonEvent event = EVENT_NONE;
+TickType_t Button::nextTimeout() const {
+    if (!edges_.isEmpty()) {
+        return 0;
+    }
+    return ticksUntilDeadline(nowUs());
+}
+
+TickType_t Button::ticksUntilDeadline(uint32_t now) const {
+    /**
+     * БЛИЖАЙШИЙ СРОК:
+     * 1. Конец дребезга - через debounceMs после последнего фронта
+     * 2. Срок автомата жестов: порог удержания, автоповтор, окно следующего клика
+     * Если ни одного срока нет, задача спит до следующего фронта.
+     */
+    uint32_t remaining;
+    bool hasDeadline = gestures_.nextDeadline(now, remaining);
     
-    // Проверка длительного нажатия (пока кнопка нажата и еще не отправляли событие)
-    if (currentState_ == LOW && !longPressEventSent_) {
-        if (millis() - lastPressTime_ > LONG_PRESS_MIN_MS) {
-            event = EVENT_LONG_PRESS;
-            longPressEventSent_ = true; // Помечаем что отправили событие
-            clickCount_ = 0; // Сбрасываем счетчик кликов
-            Logger::info(">>> LONG PRESS EVENT <<<");
-            return event;
+    if (settling_) {
+        uint32_t debounceUs = gestures_.timing().debounceMs * 1000UL;
+        uint32_t elapsed = now - lastEdgeUs_;
+        uint32_t left = elapsed >= debounceUs ? 0 : debounceUs - elapsed;
+        if (!hasDeadline || left < remaining) {
+            remaining = left;
         }
+        hasDeadline = true;
+    }
+    
+    if (!hasDeadline) {
+        return portMAX_DELAY;
+    }
+    // Округление вверх: проснуться раньше срока бесполезно
+    return pdMS_TO_TICKS((remaining + 999) / 1000) + 1;
+}
+
+void Button::update() {
+    ButtonEdge edge;
+    while (edges_.get(&edge)) {
+        applyEdge(edge);
+        Stats::add(STAT_BUTTON_EDGES);
+    }
+    
+    // Часть фронтов потеряна - берём текущий уровень входа как последний фронт
+    if (edgesLost_) {
+        edgesLost_ = false;
+        applyEdge({ nowUs(), readLevel() });
+        Stats::add(STAT_BUTTON_EDGES_LOST);
+        Logger::error("Button edge queue overflow");
     }
     
-    // Обработка кликов (только когда кнопка отпущена)
-    if (currentState_ == HIGH && clickCount_ > 0) {
-        if (millis() - lastReleaseTime_ > DOUBLE_CLICK_MAX_MS) {
-            if (clickCount_ == 1) {
-                event = EVENT_SINGLE_CLICK;
-                Logger::info(">>> SINGLE CLICK EVENT <<<");
-            } else if (clickCount_ >= 2) {
-                event = EVENT_DOUBLE_CLICK;
-                Logger::info(">>> DOUBLE CLICK EVENT <<<");
+    // Фильтрация дребезга: уровень принят, если после последнего фронта
+    // вход стабилен debounceMs
+    uint32_t now = nowUs();
+    if (settling_ && now - lastEdgeUs_ >= gestures_.timing().debounceMs * 1000UL) {
+        settling_ = false;
+        
+        // Момент нажатия/отпускания - первый фронт серии, а не время обработки
+        if (rawState_ != currentState_) {
+            currentState_ = rawState_;
+            acceptedTraceId_ = burstTraceId_;
+            Trace::mark(TRACE_BUTTON_ACCEPT, acceptedTraceId_, currentState_);
+            if (currentState_ == LOW) {
+                gestures_.onPress(burstStartUs_);
+                Logger::debug("Button pressed");
+            } else {
+                gestures_.onRelease(burstStartUs_);
+                Logger::debug("Button released");
             }
-            clickCount_ = 0;
         }
     }
     
-    return event;
+    // Сроки жестов (удержание, автоповтор, окно клика) по тем же часам
+    gestures_.poll(now);
+}
+
+void Button::applyEdge(const ButtonEdge& edge) {
+    if (!settling_) {
+        settling_ = true;
+        burstStartUs_ = edge.timeUs;
+        burstTraceId_ = Trace::begin();
+        Trace::markAt(TRACE_BUTTON_EDGE, burstTraceId_, edge.timeUs, edge.level);
+    }
+    lastEdgeUs_ = edge.timeUs;
+    rawState_ = edge.level;
+}
+
+bool Button::getEvent(ButtonGesture& gesture) {
+    if (!gestures_.getEvent(gesture)) {
+        return false;
+    }
+    // Жест по сроку (удержание, окно клика) продолжает трассу последнего нажатия
+    gesture.traceId = acceptedTraceId_;
+    return true;
 }
 
 bool Button::isPressed() {
     return currentState_ == LOW;
-}
\ No newline at end of file
+}
@@ -4,31 +4,52 @@
 #include <Arduino.h>
 #include "../common/config.h"
 #include "../common/logger.h"
+#include "../common/ring_buffer.h"
+#include "gesture.h"
 
-enum ButtonEvent {
-    EVENT_NONE,
-    EVENT_SINGLE_CLICK, 
-    EVENT_DOUBLE_CLICK,
-    EVENT_LONG_PRESS
+// Фронт на входе кнопки, снятый в прерывании
+struct ButtonEdge {
+    uint32_t timeUs;  // Hal::nowUs() в момент прерывания
+    bool level;       // Уровень входа после фронта
 };
 
 class Button {
 public:
-    Button(uint8_t pin);
+    Button(uint8_t pin, const GestureTiming& timing = DEFAULT_GESTURE_TIMING);
     void begin();
     void update();
-    ButtonEvent getEvent();
+    bool getEvent(ButtonGesture& gesture);
     bool isPressed();
+    void setTiming(const GestureTiming& timing);
+    
+    // Сон задачи до фронта или до ближайшего срока (дребезг, удержание, окно клика)
+    void waitForEdges();
+    
+    // Для внешнего цикла ожидания: прерывание выставляет биты задачи (eSetBits),
+    // nextTimeout - тиков до ближайшего срока, 0 если фронты уже ждут обработки
+    void notifyTask(TaskHandle_t task, uint32_t bits);
+    TickType_t nextTimeout() const;
 
 private:
     uint8_t pin_;
     bool currentState_;
-    bool lastState_;
-    unsigned long lastPressTime_;
-    unsigned long lastReleaseTime_;
-    unsigned long lastDebounceTime_;
-    int clickCount_;
-    bool longPressEventSent_;
+    bool rawState_;                 // Уровень после последнего фронта
+    bool settling_;                 // Идёт серия фронтов (дребезг)
+    uint32_t burstStartUs_;         // Первый фронт серии - момент нажатия/отпускания
+    uint32_t lastEdgeUs_;
+    uint16_t burstTraceId_;         // Трасса текущей серии фронтов
+    uint16_t acceptedTraceId_;      // Трасса последнего принятого нажатия/отпускания
+    GestureEngine gestures_;        // Распознавание жестов по принятым фронтам
+    
+    RingBuffer<ButtonEdge, BUTTON_EDGE_QUEUE_SIZE> edges_; // ISR -> задача
+    volatile bool edgesLost_;       // Очередь фронтов переполнялась
+    volatile TaskHandle_t task_;    // Задача, которую будит прерывание
+    uint32_t notifyBits_;           // 0 - xTaskNotifyGive, иначе биты eSetBits
+    
+    static void IRAM_ATTR edgeISR(void* arg);
+    bool readLevel() const;
+    void applyEdge(const ButtonEdge& edge);
+    TickType_t ticksUntilDeadline(uint32_t nowUs) const;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,202 @@
+#include "button_bank.h"
+#include "../hal/hal.h"
+
+namespace {
+
+// Вертикальный счётчик принимает уровень после стольких одинаковых выборок
+const uint8_t DEBOUNCE_SAMPLES = 4;
+
+inline uint32_t nowUs() {
+    return (uint32_t)Hal::nowUs();
+}
+
+}  // namespace
+
+ButtonBank::ButtonBank() : keyCount_(0), activeKeys_(0), nextSampleUs_(0), task_(nullptr), notifyBits_(0) {
+    memset(words_, 0, sizeof(words_));
+    memset(keyForPin_, NO_KEY, sizeof(keyForPin_));
+}
+
+bool ButtonBank::addKey(uint8_t pin, const GestureTiming& timing) {
+    if (keyCount_ >= BUTTON_BANK_MAX_KEYS || pin >= PIN_COUNT || keyForPin_[pin] != NO_KEY) {
+        Logger::error("ButtonBank: cannot add key on pin %u", pin);
+        return false;
+    }
+    
+    uint8_t key = keyCount_++;
+    pins_[key] = pin;
+    keyForPin_[pin] = key;
+    keys_[key].setTiming(timing);
+    words_[pin / 32].mask |= 1UL << (pin % 32);
+    return true;
+}
+
+void ButtonBank::setTiming(uint8_t key, const GestureTiming& timing) {
+    if (key < keyCount_) {
+        keys_[key].setTiming(timing);
+    }
+}
+
+void ButtonBank::begin() {
+    for (uint8_t key = 0; key < keyCount_; key++) {
+        // Пины 34-39 без подтяжки - для них нужен внешний резистор
+        Hal::pinMode(pins_[key], INPUT_PULLUP);
+        Hal::attachEdgeInterrupt(pins_[key], edgeISR, this);
+    }
+    
+    // Счётчики в исходном состоянии (3): смена уровня примется через 4 выборки
+    for (uint8_t w = 0; w < GPIO_WORDS; w++) {
+        words_[w].count0 = words_[w].count1 = UINT32_MAX;
+        words_[w].state = 0;
+    }
+    Logger::info("ButtonBank initialized with %u keys", keyCount_);
+}
+
+void IRAM_ATTR ButtonBank::edgeISR(void* arg) {
+    // Прерывание только будит задачу: уровни читает scan() одним чтением регистра
+    ButtonBank* bank = static_cast<ButtonBank*>(arg);
+    TaskHandle_t task = bank->task_;
+    if (task) {
+        BaseType_t woken = pdFALSE;
+        if (bank->notifyBits_) {
+            xTaskNotifyFromISR(task, bank->notifyBits_, eSetBits, &woken);
+        } else {
+            vTaskNotifyGiveFromISR(task, &woken);
+        }
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+void ButtonBank::waitForActivity() {
+    if (!task_) {
+        task_ = xTaskGetCurrentTaskHandle();
+    }
+    ulTaskNotifyTake(pdTRUE, nextTimeout());
+}
+
+void ButtonBank::notifyTask(TaskHandle_t task, uint32_t bits) {
+    notifyBits_ = bits;
+    task_ = task;
+}
+
+TickType_t ButtonBank::nextTimeout() const {
+    /**
+     * ВЫБОР ТАЙМАУТА:
+     * 1. Есть неустоявшиеся входы - до срока следующей выборки nextSampleUs_
+     * 2. Иначе - ближайший срок жестов активных клавиш
+     * 3. Иначе - сон до фронта на любой клавише
+     */
+    TickType_t timeout = portMAX_DELAY;
+    if (words_[0].pending | words_[1].pending) {
+        int32_t left = (int32_t)(nextSampleUs_ - nowUs());
+        timeout = left > 0 ? pdMS_TO_TICKS((left + 999) / 1000) : 0;
+    } else if (activeKeys_) {
+        uint32_t now = nowUs();
+        uint32_t nearest = UINT32_MAX;
+        for (uint32_t active = activeKeys_; active; active &= active - 1) {
+            uint32_t remaining;
+            if (keys_[__builtin_ctz(active)].nextDeadline(now, remaining) && remaining < nearest) {
+                nearest = remaining;
+            }
+        }
+        if (nearest != UINT32_MAX) {
+            timeout = pdMS_TO_TICKS((nearest + 999) / 1000) + 1;
+        }
+    }
+    return timeout == 0 ? 1 : timeout;
+}
+
+void ButtonBank::scan() {
+    uint32_t now = nowUs();
+    
+    /**
+     * КАДЕНС ВЫБОРОК:
+     * Первая выборка после покоя - сразу по фронту. Дальше, пока есть
+     * неустоявшиеся входы, фронты дребезга только будят задачу: выборка
+     * берётся не раньше nextSampleUs_, иначе 4 выборки подряд могли бы
+     * уложиться в доли миллисекунды между фронтами.
+     */
+    bool settling = words_[0].pending | words_[1].pending;
+    if (!settling || (int32_t)(now - nextSampleUs_) >= 0) {
+        sample(now);
+    }
+    
+    // Сроки жестов только у клавиш с незавершённым жестом
+    for (uint32_t active = activeKeys_; active; active &= active - 1) {
+        uint8_t key = __builtin_ctz(active);
+        keys_[key].poll(now);
+        collectEvents(key);
+        
+        uint32_t remaining;
+        if (!keys_[key].nextDeadline(now, remaining) && !keys_[key].isPressed()) {
+            activeKeys_ &= ~(1UL << key);
+        }
+    }
+}
+
+void ButtonBank::sample(uint32_t now) {
+    nextSampleUs_ = now + BUTTON_SCAN_MS * 1000UL;
+    uint32_t raw[GPIO_WORDS];
+    raw[0] = Hal::readInputs(0);
+    raw[1] = words_[1].mask ? Hal::readInputs(1) : 0;
+    
+    for (uint8_t w = 0; w < GPIO_WORDS; w++) {
+        InputWord& word = words_[w];
+        
+        /**
+         * ВЕРТИКАЛЬНЫЙ СЧЁТЧИК (все 32 входа слова за несколько операций):
+         * 1. delta - входы, у которых выборка отличается от принятого состояния
+         * 2. Для них 2-битный счётчик (count1:count0) уменьшается 3 -> 2 -> 1 -> 0,
+         *    для остальных сбрасывается в 3
+         * 3. Вход, чей счётчик прошёл 0 (4 выборки подряд), переключается
+         */
+        uint32_t pressed = ~raw[w] & word.mask;  // Активный уровень - низкий
+        uint32_t delta = pressed ^ word.state;
+        word.count0 = ~(word.count0 & delta);
+        word.count1 = word.count0 ^ (word.count1 & delta);
+        uint32_t toggled = delta & word.count0 & word.count1;
+        word.state ^= toggled;
+        word.pending = delta & ~toggled;
+        
+        if (toggled) {
+            // Переход датируется первой из выборок, на которых он был виден
+            applyToggles(w, toggled, now - (DEBOUNCE_SAMPLES - 1) * BUTTON_SCAN_MS * 1000UL);
+        }
+    }
+}
+
+void ButtonBank::applyToggles(uint8_t word, uint32_t toggled, uint32_t timeUs) {
+    for (; toggled; toggled &= toggled - 1) {
+        uint8_t bit = __builtin_ctz(toggled);
+        uint8_t key = keyForPin_[word * 32 + bit];
+        if (words_[word].state & (1UL << bit)) {
+            keys_[key].onPress(timeUs);
+        } else {
+            keys_[key].onRelease(timeUs);
+        }
+        activeKeys_ |= 1UL << key;
+        collectEvents(key);
+    }
+}
+
+void ButtonBank::collectEvents(uint8_t key) {
+    ButtonGesture gesture;
+    while (keys_[key].getEvent(gesture)) {
+        gesture.key = key;
+        if (!events_.put(gesture)) {
+            Logger::error("ButtonBank event queue overflow, key %u", key);
+        }
+    }
+}
+
+bool ButtonBank::getEvent(ButtonGesture& gesture) {
+    return events_.get(&gesture);
+}
+
+bool ButtonBank::isPressed(uint8_t key) const {
+    if (key >= keyCount_) {
+        return false;
+    }
+    uint8_t pin = pins_[key];
+    return words_[pin / 32].state & (1UL << (pin % 32));
+}
@@ -0,0 +1,86 @@
+#ifndef BUTTON_BANK_H
+#define BUTTON_BANK_H
+
+#include <Arduino.h>
+#include "../common/config.h"
+#include "../common/logger.h"
+#include "../common/ring_buffer.h"
+#include "gesture.h"
+
+/**
+ * Панель из нескольких клавиш (до BUTTON_BANK_MAX_KEYS) с общим сканированием.
+ *
+ * - Все входы читаются одним-двумя чтениями GPIO_IN/GPIO_IN1.
+ * - Дребезг фильтруется вертикальными 2-битными счётчиками сразу для всех
+ *   32 бит слова: уровень принимается после 4 одинаковых выборок подряд.
+ * - Каждая клавиша имеет свой GestureEngine (свои пороги), жесты всех
+ *   клавиш попадают в одну очередь с индексом клавиши в ButtonGesture::key.
+ * - Сканирование идёт с периодом BUTTON_SCAN_MS только пока есть
+ *   неустоявшиеся входы; в покое задачу будит прерывание по фронту любой клавиши.
+ *   Пока входы не устоялись, фронты (дребезг) новых выборок не дают: соседние
+ *   выборки не ближе BUTTON_SCAN_MS, так что 4 выборки - не меньше 15 мс.
+ *
+ * Стоимость скана не зависит от числа клавиш: автоматы жестов вызываются
+ * только для клавиш, у которых сменилось состояние или идёт отсчёт срока.
+ *
+ *   ButtonBank panel;
+ *   panel.addKey(4); panel.addKey(5); panel.addKey(18);
+ *   panel.begin();
+ *   while (1) { panel.waitForActivity(); panel.scan(); while (panel.getEvent(g)) { ... } }
+ *
+ * В прошивке панель включает BUTTON_BANK_ENABLED (пины - BUTTON_BANK_PINS),
+ * жесты уходят на шину событий через App::processBank.
+ */
+class ButtonBank {
+public:
+    ButtonBank();
+    
+    // Индекс клавиши - порядок добавления; false при неверном пине или переполнении
+    bool addKey(uint8_t pin, const GestureTiming& timing = DEFAULT_GESTURE_TIMING);
+    void begin();
+    
+    void waitForActivity();
+    void scan();
+    
+    // Для внешнего цикла ожидания (реактор, симулятор), как у Button: прерывание
+    // выставляет биты задачи (eSetBits), nextTimeout - тиков до следующего скана
+    void notifyTask(TaskHandle_t task, uint32_t bits);
+    TickType_t nextTimeout() const;
+    bool getEvent(ButtonGesture& gesture);
+    
+    uint8_t keyCount() const { return keyCount_; }
+    bool isPressed(uint8_t key) const;
+    void setTiming(uint8_t key, const GestureTiming& timing);
+
+private:
+    static const uint8_t GPIO_WORDS = 2;   // GPIO_IN: пины 0-31, GPIO_IN1: пины 32-39
+    static const uint8_t PIN_COUNT = 40;
+    static const uint8_t NO_KEY = 0xFF;
+    
+    // Вертикальные счётчики одного 32-битного слова входов
+    struct InputWord {
+        uint32_t mask;      // Пины, занятые клавишами
+        uint32_t state;     // Принятое состояние: 1 - нажата
+        uint32_t count0;    // Младший бит счётчика каждого входа
+        uint32_t count1;    // Старший бит счётчика
+        uint32_t pending;   // Входы, отличающиеся от принятого состояния
+    };
+    
+    InputWord words_[GPIO_WORDS];
+    GestureEngine keys_[BUTTON_BANK_MAX_KEYS];
+    uint8_t pins_[BUTTON_BANK_MAX_KEYS];
+    uint8_t keyForPin_[PIN_COUNT];
+    uint8_t keyCount_;
+    uint32_t activeKeys_;               // Клавиши с незавершённым жестом
+    uint32_t nextSampleUs_;             // Раньше этого выборка при неустоявшихся входах не берётся
+    RingBuffer<ButtonGesture, BUTTON_BANK_QUEUE_SIZE> events_;
+    volatile TaskHandle_t task_;
+    uint32_t notifyBits_;               // 0 - пробуждение через vTaskNotifyGive
+    
+    static void IRAM_ATTR edgeISR(void* arg);
+    void sample(uint32_t now);
+    void applyToggles(uint8_t word, uint32_t toggled, uint32_t timeUs);
+    void collectEvents(uint8_t key);
+};
+
+#endif
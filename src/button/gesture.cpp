@@ -0,0 +1,166 @@
+#include "gesture.h"
+#include "../common/logger.h"
+
+/**
+ * ТАБЛИЦА ПЕРЕХОДОВ:
+ * Строка - состояние, столбец - вход. Действие может досрочно завершить
+ * жест (клик номер maxClicks), тогда автомат возвращается в STATE_IDLE.
+ */
+const GestureEngine::Transition GestureEngine::TRANSITIONS[STATE_COUNT][INPUT_COUNT] = {
+    //                   PRESS                          RELEASE                          TIMEOUT
+    /* IDLE     */ { { STATE_PRESSED, ACTION_PRESS }, { STATE_IDLE, ACTION_NONE },       { STATE_IDLE, ACTION_NONE } },
+    /* PRESSED  */ { { STATE_PRESSED, ACTION_NONE },  { STATE_RELEASED, ACTION_CLICK },  { STATE_HOLDING, ACTION_HOLD } },
+    /* HOLDING  */ { { STATE_HOLDING, ACTION_NONE },  { STATE_IDLE, ACTION_HOLD_END },   { STATE_HOLDING, ACTION_REPEAT } },
+    /* RELEASED */ { { STATE_PRESSED, ACTION_PRESS }, { STATE_RELEASED, ACTION_NONE },   { STATE_IDLE, ACTION_CLICKS_DONE } },
+};
+
+GestureEngine::GestureEngine(const GestureTiming& timing)
+    : timing_(timing), state_(STATE_IDLE), stateSinceUs_(0), repeatIntervalUs_(0),
+      clicks_(0), repeats_(0) {
+}
+
+void GestureEngine::setTiming(const GestureTiming& timing) {
+    timing_ = timing;
+}
+
+void GestureEngine::onPress(uint32_t timeUs) {
+    step(INPUT_PRESS, timeUs);
+}
+
+void GestureEngine::onRelease(uint32_t timeUs) {
+    step(INPUT_RELEASE, timeUs);
+}
+
+void GestureEngine::poll(uint32_t nowUs) {
+    // Срок отсчитывается от момента перехода, а не от времени опроса:
+    // событие датируется точно, даже если задача проснулась позже
+    uint32_t timeoutUs;
+    while (stateTimeout(timeoutUs) && nowUs - stateSinceUs_ >= timeoutUs) {
+        step(INPUT_TIMEOUT, stateSinceUs_ + timeoutUs);
+        
+        if (state_ == STATE_HOLDING && nowUs - stateSinceUs_ >= repeatIntervalUs_) {
+            // Опоздание больше интервала: пропущенные автоповторы не догоняем
+            stateSinceUs_ = nowUs;
+        }
+    }
+}
+
+bool GestureEngine::nextDeadline(uint32_t nowUs, uint32_t& remainingUs) const {
+    uint32_t timeoutUs;
+    if (!stateTimeout(timeoutUs)) {
+        return false;
+    }
+    uint32_t elapsed = nowUs - stateSinceUs_;
+    remainingUs = elapsed >= timeoutUs ? 0 : timeoutUs - elapsed;
+    return true;
+}
+
+bool GestureEngine::getEvent(ButtonGesture& gesture) {
+    return events_.get(&gesture);
+}
+
+bool GestureEngine::isPressed() const {
+    return state_ == STATE_PRESSED || state_ == STATE_HOLDING;
+}
+
+bool GestureEngine::stateTimeout(uint32_t& timeoutUs) const {
+    switch (state_) {
+        case STATE_PRESSED:
+            timeoutUs = timing_.holdMs * 1000UL;
+            return true;
+        case STATE_HOLDING:
+            timeoutUs = repeatIntervalUs_;
+            return timing_.repeatStartMs > 0;
+        case STATE_RELEASED:
+            timeoutUs = timing_.multiClickMs * 1000UL;
+            return true;
+        default:
+            return false;
+    }
+}
+
+void GestureEngine::step(Input input, uint32_t timeUs) {
+    const Transition& transition = TRANSITIONS[state_][input];
+    State next = transition.next;
+    if (transition.action != ACTION_NONE && run(transition.action, timeUs)) {
+        next = STATE_IDLE;  // Жест завершён досрочно
+    }
+    if (next != state_ || transition.action == ACTION_REPEAT) {
+        stateSinceUs_ = timeUs;
+    }
+    state_ = next;
+}
+
+bool GestureEngine::run(Action action, uint32_t timeUs) {
+    switch (action) {
+        case ACTION_PRESS:
+            break;
+        
+        case ACTION_CLICK:
+            clicks_++;
+            if (timing_.speculativeSingle && clicks_ == 1) {
+                // Спекулятивный клик: действие сразу, уточнение придёт, если будет второй клик
+                emit(EVENT_SINGLE_CLICK, timeUs);
+            }
+            if (clicks_ >= timing_.maxClicks) {
+                emitClicks(timeUs);
+                return true;
+            }
+            break;
+        
+        case ACTION_HOLD:
+            clicks_ = 0;
+            repeats_ = 0;
+            repeatIntervalUs_ = timing_.repeatStartMs * 1000UL;
+            emit(EVENT_LONG_PRESS, timeUs);
+            break;
+        
+        case ACTION_REPEAT: {
+            repeats_++;
+            
+            // Ускорение автоповтора до нижней границы; жест несёт уже новый интервал
+            uint32_t minUs = timing_.repeatMinMs * 1000UL;
+            repeatIntervalUs_ -= repeatIntervalUs_ / 100 * timing_.repeatAccelPercent;
+            if (repeatIntervalUs_ < minUs) {
+                repeatIntervalUs_ = minUs;
+            }
+            emit(EVENT_HOLD_REPEAT, timeUs);
+            break;
+        }
+        
+        case ACTION_HOLD_END:
+            emit(EVENT_HOLD_END, timeUs);
+            break;
+        
+        case ACTION_CLICKS_DONE:
+            emitClicks(timeUs);
+            break;
+        
+        default:
+            break;
+    }
+    return false;
+}
+
+void GestureEngine::emitClicks(uint32_t timeUs) {
+    bool upgrade = timing_.speculativeSingle;
+    if (clicks_ == 1) {
+        if (!upgrade) {
+            emit(EVENT_SINGLE_CLICK, timeUs);
+        }
+    } else if (clicks_ == 2) {
+        emit(EVENT_DOUBLE_CLICK, timeUs, upgrade);
+    } else if (clicks_ > 2) {
+        emit(EVENT_MULTI_CLICK, timeUs, upgrade);
+    }
+    clicks_ = 0;
+}
+
+void GestureEngine::emit(ButtonEvent event, uint32_t timeUs, bool upgrade) {
+    bool holding = event == EVENT_LONG_PRESS || event == EVENT_HOLD_REPEAT;
+    uint16_t repeatMs = holding ? (uint16_t)(repeatIntervalUs_ / 1000) : 0;
+    ButtonGesture gesture = { event, 0, clicks_, repeats_, upgrade, timeUs, 0, repeatMs };
+    if (!events_.put(gesture)) {
+        Logger::error("Button gesture queue overflow, event %d lost", event);
+    }
+}
@@ -0,0 +1,125 @@
+#ifndef GESTURE_H
+#define GESTURE_H
+
+#include <stdint.h>
+#include "../common/config.h"
+#include "../common/ring_buffer.h"
+
+enum ButtonEvent {
+    EVENT_NONE,
+    EVENT_SINGLE_CLICK,
+    EVENT_DOUBLE_CLICK,
+    EVENT_LONG_PRESS,
+    EVENT_MULTI_CLICK,   // Три клика и больше, число в ButtonGesture::clicks
+    EVENT_HOLD_REPEAT,   // Автоповтор при удержании после EVENT_LONG_PRESS
+    EVENT_HOLD_END       // Отпускание после EVENT_LONG_PRESS
+};
+
+struct ButtonGesture {
+    ButtonEvent event;
+    uint8_t key;         // Индекс клавиши в ButtonBank, 0 для одиночной Button
+    uint8_t clicks;      // Число кликов жеста
+    uint8_t repeat;      // Номер автоповтора для EVENT_HOLD_REPEAT
+    bool upgrade;        // Уточняет уже отправленный спекулятивный EVENT_SINGLE_CLICK
+    uint32_t timeUs;     // Момент жеста по фронтам кнопки
+    uint16_t traceId;    // Трасса нажатия, породившего жест (заполняет Button)
+    uint16_t repeatMs;   // До следующего автоповтора (LONG_PRESS, HOLD_REPEAT), 0 - автоповтора нет
+};
+
+// Пороги распознавания жестов, задаются для каждой кнопки отдельно
+struct GestureTiming {
+    uint16_t debounceMs;
+    uint16_t multiClickMs;       // Окно ожидания следующего клика
+    uint16_t holdMs;             // Удержание до EVENT_LONG_PRESS
+    uint16_t repeatStartMs;      // Первый интервал автоповтора, 0 - без автоповтора
+    uint16_t repeatMinMs;        // Нижняя граница интервала при ускорении
+    uint8_t repeatAccelPercent;  // Сокращение интервала на каждом повторе
+    uint8_t maxClicks;           // Клик с этим номером завершает жест сразу
+    bool speculativeSingle;      // EVENT_SINGLE_CLICK сразу после первого отпускания
+};
+
+constexpr GestureTiming DEFAULT_GESTURE_TIMING = {
+    DEBOUNCE_DELAY_MS,
+    DOUBLE_CLICK_MAX_MS,
+    LONG_PRESS_MIN_MS,
+    BUTTON_REPEAT_START_MS,
+    BUTTON_REPEAT_MIN_MS,
+    BUTTON_REPEAT_ACCEL_PERCENT,
+    BUTTON_MAX_CLICKS,
+    BUTTON_SPECULATIVE_CLICK
+};
+
+/**
+ * Табличный автомат жестов одной кнопки.
+ *
+ * На вход - уже отфильтрованные от дребезга нажатия/отпускания с метками
+ * времени и опрос сроков (poll). На выход - очередь ButtonGesture.
+ * Автомат не читает часы сам, поэтому одинаково работает от прерываний,
+ * от сканирования матрицы клавиш и в тестах на хосте.
+ */
+class GestureEngine {
+public:
+    explicit GestureEngine(const GestureTiming& timing = DEFAULT_GESTURE_TIMING);
+
+    void setTiming(const GestureTiming& timing);
+    const GestureTiming& timing() const { return timing_; }
+
+    void onPress(uint32_t timeUs);
+    void onRelease(uint32_t timeUs);
+    void poll(uint32_t nowUs);
+
+    // Время до ближайшего срока; false - автомат ждёт только нажатия
+    bool nextDeadline(uint32_t nowUs, uint32_t& remainingUs) const;
+
+    bool getEvent(ButtonGesture& gesture);
+    bool isPressed() const;
+
+private:
+    enum State : uint8_t {
+        STATE_IDLE,
+        STATE_PRESSED,      // Нажата, ждём отпускания или порога удержания
+        STATE_HOLDING,      // Удержание, идут автоповторы
+        STATE_RELEASED,     // Отпущена, ждём следующего клика
+        STATE_COUNT
+    };
+
+    enum Input : uint8_t {
+        INPUT_PRESS,
+        INPUT_RELEASE,
+        INPUT_TIMEOUT,
+        INPUT_COUNT
+    };
+
+    enum Action : uint8_t {
+        ACTION_NONE,
+        ACTION_PRESS,
+        ACTION_CLICK,
+        ACTION_HOLD,
+        ACTION_REPEAT,
+        ACTION_HOLD_END,
+        ACTION_CLICKS_DONE
+    };
+
+    struct Transition {
+        State next;
+        Action action;
+    };
+
+    static const Transition TRANSITIONS[STATE_COUNT][INPUT_COUNT];
+
+    GestureTiming timing_;
+    State state_;
+    uint32_t stateSinceUs_;      // Начало отсчёта срока текущего состояния
+    uint32_t repeatIntervalUs_;
+    uint8_t clicks_;
+    uint8_t repeats_;
+    RingBuffer<ButtonGesture, BUTTON_GESTURE_QUEUE_SIZE> events_;
+
+    void step(Input input, uint32_t timeUs);
+    bool run(Action action, uint32_t timeUs);
+    bool stateTimeout(uint32_t& timeoutUs) const;
+    void emitClicks(uint32_t timeUs);
+    void emit(ButtonEvent event, uint32_t timeUs, bool upgrade = false);
+};
+
+#endif
@@ -10,16 +10,96 @@
 #define UART_BAUDRATE 115200
 #define UART_RX_BUFFER_SIZE 256  // Размер кольцевого буфера
 #define UART_CMD_BUFFER_SIZE 128 // Размер буфера для команд
+#define UART_RX_CHUNK_SIZE 64    // Порция чтения из драйвера UART
+#define UART_RX_TIMEOUT_SYMBOLS 2 // Тишина на линии (в символах), после которой будится задача
+#define UART_IDLE_TIMEOUT_MS 1000 // Страховочное пробуждение задачи UART без данных
+#define UART_MAX_TOKENS 8         // Слов в одной команде (глагол + параметры)
+#define UART_RESPONSE_SIZE 96     // Максимальная длина ответа на команду
+#define UART_TX_BUFFER_SIZE 256   // Ответы за один проход processCommands уходят одной записью
+#define TELEMETRY_BUFFER_SIZE 1024 // Кольцо выборок STREAM до записи в UART (степень двойки)
+#define TELEMETRY_MAX_RATE_HZ 200  // Верхняя частота выборок STREAM
+
+// Общая шина RS-485 (адресные команды "@<адрес> ...", src/uart/bus_address.h)
+#define BUS_NODE_ADDRESS 0           // Адрес узла 1-199, 0 - одиночный узел без адреса
+#define BUS_RS485_DE_PIN -1          // Вывод DE/RE приёмопередатчика, -1 - без управления направлением
 
 // Конфигурация кнопки (увеличим времена для надежности)
 #define DEBOUNCE_DELAY_MS 50
 #define DOUBLE_CLICK_MAX_MS 600    // 600ms для двойного клика
 #define LONG_PRESS_MIN_MS 1200     // 1.2 секунды для длительного нажатия
+#define BUTTON_EDGE_QUEUE_SIZE 32  // Фронтов от прерывания до обработки (степень двойки)
+#define BUTTON_REPEAT_START_MS 1000   // Первый автоповтор при удержании (0 - без автоповтора)
+#define BUTTON_REPEAT_MIN_MS 1000     // Нижняя граница интервала автоповтора
+#define BUTTON_REPEAT_ACCEL_PERCENT 0 // Сокращение интервала на каждом повторе, %
+#define BUTTON_MAX_CLICKS 2           // Клик с этим номером отправляется сразу, без ожидания окна
+#define BUTTON_SPECULATIVE_CLICK false // Мгновенный SINGLE_CLICK с последующим уточнением
+#define BUTTON_GESTURE_QUEUE_SIZE 4   // Жестов, ожидающих выборки (степень двойки)
+#define BUTTON_BANK_MAX_KEYS 32       // Клавиш в одной ButtonBank
+#define BUTTON_SCAN_MS 5              // Период сканирования банка, пока есть неустоявшиеся клавиши
+#define BUTTON_BANK_QUEUE_SIZE 32     // Общая очередь жестов банка: по жесту на клавишу за скан (степень двойки)
+#define BUTTON_BANK_ENABLED false     // Панель клавиш ButtonBank в дополнение к BUTTON_PIN
+#define BUTTON_BANK_PINS 25, 26, 27, 32  // Пины клавиш панели, индекс клавиши - порядок в списке
 
 // Конфигурация ШИМ
 #define PWM_MIN 0
 #define PWM_MAX 100
 #define PWM_STEP 10
 #define PWM_LONG_PRESS_INTERVAL_MS 1000
+#define PWM_MAX_CHANNELS 16          // Каналов LEDC на ESP32 (8 high-speed + 8 low-speed)
+#define PWM_DEFAULT_FREQUENCY 5000   // Частота по умолчанию, Гц
+#define PWM_DEFAULT_RESOLUTION 8     // Разрешение по умолчанию, бит
+#define PWM_MAX_RESOLUTION 16        // Верхняя граница разрешения (скважность хранится в Q16)
+#define PWM_LEDC_CLOCK_HZ 80000000   // Тактовая LEDC (APB): частота * 2^разрешение не больше
+#define PWM_TICK_US 1000             // Период таймера переходов и дизеринга (1 кГц)
+#define PWM_DITHER_BITS 4            // Дополнительные биты временного дизеринга
+#define PWM_FADE_MAX_MS 60000        // Максимальная длительность перехода
+#define PWM_GAMMA_STEPS 1024         // Размер таблицы перцептивной кривой
+#define PWM_COMMAND_QUEUE_SIZE 16    // Очередь команд к задаче-владельцу ШИМ
+#define PWM_SNAPSHOT_PERIOD_MS 10    // Снимок после частых записей (контур, секвенсор) - не чаще
+#define PWM_SEQ_MAX_KEYS 64          // Ключевых кадров в загруженной последовательности (8 байт каждый)
+
+// Замкнутый контур ШИМ (ПИД, src/pwm/closed_loop.h)
+#define PWM_LOOP_CHANNEL 0           // Канал, которым управляет контур
+#define PWM_FEEDBACK_PIN 34          // Вход АЦП1 обратной связи (датчик тока/света)
+#define PWM_LOOP_RATE_HZ 1000        // Частота такта регулятора
+#define PWM_LOOP_KP_MILLI 500        // Коэффициенты по умолчанию, тысячные: Kp
+#define PWM_LOOP_KI_MILLI 25000      // Ki, 1/с
+#define PWM_LOOP_KD_MILLI 0          // Kd, с
+
+
+// Конфигурация логгера
+#define LOG_QUEUE_SIZE 64            // Записей в очереди (степень двойки)
+#define LOG_MAX_ARGS 4               // Аргументов на запись
+#define LOG_TEXT_SIZE 32             // Байт под строковые аргументы %s
+#define LOG_LINE_SIZE 160            // Максимальная длина выводимой строки
+#define LOG_DRAIN_IDLE_MS 100        // Период проверки очереди задачей вывода
+#define LOG_TASK_STACK_SIZE 3072
+#define LOG_TASK_PRIORITY 1
+#define LOG_BINARY_DEFAULT false     // Бинарный вывод лога после старта
+#define LOG_TOKEN_CACHE_SIZE 32      // Кэш токенов форматов (степень двойки)
+
+// Размещение задач FreeRTOS (таблица задач - src/common/rtos.h)
+#define RTOS_CONTROL_CORE 1          // Кнопка, ШИМ, UART, LED, реактор
+#define RTOS_IO_CORE 0               // Вывод лога
+#define RTOS_RAM_BUDGET 24576        // Предел статического ОЗУ под задачи, очереди и таймеры
+
+// Режим реактора: одна задача вместо задач Button/PWM/UART/StatusLED
+#define REACTOR_MODE false
+#define REACTOR_MAX_HANDLERS 8       // Обработчиков (битов уведомления) в реакторе
+#define REACTOR_STACK_SIZE 4096
+#define REACTOR_PRIORITY 3
+
+// Счётчики производительности (команда STATS)
+#define STATS_ENABLED true
+#define STATS_HIST_BUCKETS 20        // Логарифмические корзины гистограмм: до 2^19 мкс и больше
+
+// Трасса этапов кнопка/UART -> ШИМ (команда TRACE)
+#define TRACE_ENABLED true
+#define TRACE_BUFFER_SIZE 256        // Записей по 8 байт, степень двойки
+
+// Конфигурация шины событий
+#define EVENT_BUS_MAX_SUBSCRIBERS 4  // Подписчиков на всю шину
+#define EVENT_BUS_MAX_QUEUES 2       // Из них с собственной очередью (статическое хранилище)
+#define EVENT_BUS_QUEUE_SIZE 8       // Глубина очереди подписчика
 
 #endif
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "event_bus.h"
+#include "logger.h"
+#include "stats.h"
+
+EventBus::Subscriber EventBus::subscribers_[EVENT_BUS_MAX_SUBSCRIBERS];
+EventBus::QueueStorage EventBus::queues_[EVENT_BUS_MAX_QUEUES];
+uint8_t EventBus::count_ = 0;
+uint8_t EventBus::queueCount_ = 0;
+
+int8_t EventBus::subscribe(uint32_t typeMask) {
+    if (count_ >= EVENT_BUS_MAX_SUBSCRIBERS || queueCount_ >= EVENT_BUS_MAX_QUEUES) {
+        Logger::error("Event bus: subscriber table full");
+        return -1;
+    }
+    QueueHandle_t queue = queues_[queueCount_++].create();
+    if (!queue) {
+        Logger::error("Event bus: subscriber queue creation failed");
+        return -1;
+    }
+    return add(typeMask, queue, nullptr);
+}
+
+int8_t EventBus::subscribe(uint32_t typeMask, Handler handler) {
+    return add(typeMask, nullptr, handler);
+}
+
+int8_t EventBus::add(uint32_t typeMask, QueueHandle_t queue, Handler handler) {
+    if (count_ >= EVENT_BUS_MAX_SUBSCRIBERS) {
+        Logger::error("Event bus: subscriber table full");
+        return -1;
+    }
+    Subscriber& subscriber = subscribers_[count_];
+    subscriber.typeMask = typeMask;
+    subscriber.queue = queue;
+    subscriber.handler = handler;
+    subscriber.dropped = 0;
+    return count_++;
+}
+
+void EventBus::publish(const BusEvent& event) {
+    uint32_t bit = BUS_EVENT_MASK(event.type);
+    for (uint8_t i = 0; i < count_; i++) {
+        Subscriber& subscriber = subscribers_[i];
+        if (!(subscriber.typeMask & bit)) {
+            continue;
+        }
+        if (subscriber.handler) {
+            subscriber.handler(event);
+        } else if (xQueueSend(subscriber.queue, &event, 0) == pdTRUE) {
+            Stats::gauge(STAT_GAUGE_BUS_QUEUE, uxQueueMessagesWaiting(subscriber.queue));
+        } else {
+            // Теряется только копия этого подписчика
+            __atomic_fetch_add(&subscriber.dropped, 1, __ATOMIC_RELAXED);
+            Stats::add(STAT_BUS_DROPPED);
+        }
+    }
+}
+
+bool EventBus::receive(int8_t subscriber, BusEvent& event, TickType_t timeout) {
+    if (subscriber < 0 || subscriber >= count_ || !subscribers_[subscriber].queue) {
+        return false;
+    }
+    return xQueueReceive(subscribers_[subscriber].queue, &event, timeout) == pdTRUE;
+}
+
+uint32_t EventBus::droppedCount(int8_t subscriber) {
+    if (subscriber < 0 || subscriber >= count_) {
+        return 0;
+    }
+    return __atomic_load_n(&subscribers_[subscriber].dropped, __ATOMIC_RELAXED);
+}
+
+uint8_t EventBus::subscriberCount() {
+    return count_;
+}
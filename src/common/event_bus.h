@@ -0,0 +1,85 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "rtos.h"
+
+enum BusEventType : uint8_t {
+    BUS_EVENT_BUTTON,        // Распознанный жест кнопки
+    BUS_EVENT_PWM,           // Изменение скважности
+    BUS_EVENT_TYPE_COUNT
+};
+
+#define BUS_EVENT_MASK(type) (1UL << (type))
+
+// Запись фиксированного размера: копируется в очереди подписчиков по значению
+struct BusEvent {
+    BusEventType type;
+    uint8_t source;          // Индекс клавиши, канал ШИМ и т.п.
+    uint16_t traceId;        // Корреляционный ID трассы (см. trace.h), 0 - без трассы
+    uint32_t timeUs;
+    union {
+        struct {
+            uint8_t event;   // ButtonEvent
+            uint8_t clicks;
+            uint8_t repeat;
+            uint8_t upgrade;
+            uint16_t repeatMs;   // ButtonGesture::repeatMs
+        } button;
+        struct {
+            uint16_t duty16;
+            uint16_t reserved;
+        } pwm;
+        uint32_t words[2];
+    } payload;
+};
+
+/**
+ * Шина событий с раздачей нескольким подписчикам.
+ *
+ * Подписчик - это очередь FreeRTOS фиксированной глубины (задача читает её
+ * через receive) или обработчик, вызываемый прямо в контексте публикации.
+ * Обработчик не должен блокироваться. Публикация проходит по таблице
+ * подписчиков (O(подписчиков)) и кладёт запись без ожидания. Если очередь
+ * подписчика полна, запись теряется только для него и учитывается в его
+ * счётчике, так что медленный потребитель не тормозит производителя.
+ *
+ * Подписка выполняется в setup() до запуска задач, публиковать можно из
+ * любой задачи. Очереди подписчиков размещены статически
+ * (EVENT_BUS_MAX_QUEUES по EVENT_BUS_QUEUE_SIZE записей).
+ */
+class EventBus {
+public:
+    typedef void (*Handler)(const BusEvent& event);
+    
+    typedef Rtos::StaticQueue<BusEvent, EVENT_BUS_QUEUE_SIZE> QueueStorage;
+    static constexpr uint32_t STATIC_RAM_BYTES = EVENT_BUS_MAX_QUEUES * sizeof(QueueStorage);
+    
+    // Номер подписчика или -1, если таблица или пул очередей заполнены
+    static int8_t subscribe(uint32_t typeMask);
+    static int8_t subscribe(uint32_t typeMask, Handler handler);
+    
+    static void publish(const BusEvent& event);
+    static bool receive(int8_t subscriber, BusEvent& event, TickType_t timeout);
+    
+    static uint32_t droppedCount(int8_t subscriber);
+    static uint8_t subscriberCount();
+
+private:
+    struct Subscriber {
+        uint32_t typeMask;
+        QueueHandle_t queue;
+        Handler handler;
+        volatile uint32_t dropped;
+    };
+    
+    static Subscriber subscribers_[EVENT_BUS_MAX_SUBSCRIBERS];
+    static QueueStorage queues_[EVENT_BUS_MAX_QUEUES];
+    static uint8_t count_;
+    static uint8_t queueCount_;
+    
+    static int8_t add(uint32_t typeMask, QueueHandle_t queue, Handler handler);
+};
+
+#endif
@@ -0,0 +1,394 @@
+#include "logger.h"
+#include "rtos.h"
+#include "../hal/hal.h"
+#include "../uart/binary_protocol.h"
+#include <atomic>
+
+// ============================================================================
+// Очередь записей лога: ограниченная MPSC-очередь с номером последовательности
+// в каждой ячейке. Производители (любые задачи и ISR) захватывают ячейку через
+// compare-and-swap, единственный потребитель - задача вывода.
+// ============================================================================
+
+namespace {
+
+static_assert((LOG_QUEUE_SIZE & (LOG_QUEUE_SIZE - 1)) == 0, "LOG_QUEUE_SIZE must be a power of two");
+static_assert((LOG_TOKEN_CACHE_SIZE & (LOG_TOKEN_CACHE_SIZE - 1)) == 0, "LOG_TOKEN_CACHE_SIZE must be a power of two");
+// Пакет: тег, уровень, токен, дельта времени, аргументы (varint или длина + строка), CRC
+const size_t LOG_PACKET_MAX = 2 + 3 + 5 + LOG_MAX_ARGS * 5 + LOG_TEXT_SIZE + 2;
+static_assert(LOG_LINE_SIZE >= BinaryProtocol::cobsEncodedSize(LOG_PACKET_MAX) + 2,
+              "LOG_LINE_SIZE too small for a binary frame");
+
+struct LogRecord {
+    const char* format;
+    uint32_t timestamp;
+    uint32_t args[LOG_MAX_ARGS];   // Числа или смещение строки в text
+    uint8_t level;
+    uint8_t argCount;
+    char text[LOG_TEXT_SIZE];      // Скопированные аргументы %s
+};
+
+struct LogSlot {
+    std::atomic<uint32_t> sequence;
+    LogRecord record;
+};
+
+LogSlot logSlots[LOG_QUEUE_SIZE];
+std::atomic<uint32_t> logHead(0);
+std::atomic<uint32_t> logDropped(0);
+std::atomic<bool> drainWaiting(false);
+std::atomic<bool> binaryMode(LOG_BINARY_DEFAULT);
+std::atomic<bool> serialOutput(true);
+uint32_t logTail = 0;
+uint32_t reportedDropped = 0;       // Потери, о которых уже сообщили
+TaskHandle_t drainTaskHandle = nullptr;
+bool slotsInitialized = false;
+
+const char* const LEVEL_PREFIX[] = { "[INFO] ", "[ERROR] ", "[DEBUG] " };
+
+// Разбор следующей спецификации формата: возвращает символ преобразования или 0
+char nextConversion(const char*& p, bool& isLong, char* spec, size_t specSize) {
+    while (*p) {
+        if (*p++ != '%') {
+            continue;
+        }
+        if (*p == '%') {
+            p++;
+            continue;
+        }
+
+        size_t len = 0;
+        if (spec && len < specSize - 1) {
+            spec[len++] = '%';
+        }
+        isLong = false;
+        while (*p && strchr("-+ #0123456789.", *p)) {
+            if (spec && len < specSize - 2) {
+                spec[len++] = *p;
+            }
+            p++;
+        }
+        // Модификаторы длины: на ESP32 int и long одного размера, учитываем только l
+        while (*p && strchr("hlzjt", *p)) {
+            if (*p == 'l') {
+                isLong = true;
+            }
+            p++;
+        }
+        char conversion = *p ? *p++ : 0;
+        if (spec) {
+            spec[len++] = conversion;
+            spec[len] = '\0';
+        }
+        return conversion;
+    }
+    return 0;
+}
+
+void initSlots() {
+    for (uint32_t i = 0; i < LOG_QUEUE_SIZE; i++) {
+        logSlots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    slotsInitialized = true;
+}
+
+// Текстовый вывод: "[LEVEL] сообщение\r\n"
+size_t formatText(const LogRecord& record, char* line) {
+    char spec[12];
+    size_t len = strlen(LEVEL_PREFIX[record.level]);
+    memcpy(line, LEVEL_PREFIX[record.level], len);
+    const char* p = record.format;
+    uint8_t argIndex = 0;
+    while (*p && len < LOG_LINE_SIZE - 3) {
+        if (*p != '%') {
+            line[len++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            line[len++] = '%';
+            p += 2;
+            continue;
+        }
+
+        bool isLong;
+        char conversion = nextConversion(p, isLong, spec, sizeof(spec));
+        if (!conversion) {
+            break;
+        }
+
+        uint32_t value = argIndex < record.argCount ? record.args[argIndex] : 0;
+        argIndex++;
+        int written;
+        if (conversion == 's') {
+            const char* str = value < LOG_TEXT_SIZE ? &record.text[value] : "";
+            written = snprintf(line + len, LOG_LINE_SIZE - 2 - len, spec, str);
+        } else {
+            written = snprintf(line + len, LOG_LINE_SIZE - 2 - len, spec, value);
+        }
+        if (written > 0) {
+            len += written;
+            if (len > LOG_LINE_SIZE - 3) {
+                len = LOG_LINE_SIZE - 3;
+            }
+        }
+    }
+
+    line[len++] = '\r';
+    line[len++] = '\n';
+    return len;
+}
+
+// ============================================================================
+// Бинарный (токенизированный) вывод. Кадр - как остальные бинарные кадры порта
+// (ответы на команды, выборки STREAM): 0x00 <COBS(пакет)> 0x00, пакет
+//   0xFD | уровень | токен u24 LE | дельта времени varint | аргументы | crc16 LE
+// Тег LOG_TAG отличает запись лога от выборки (0xFE) и от ответа (ровно
+// RESPONSE_SIZE байт, а пакет лога всегда длиннее). Байты аргументов внутри
+// COBS не могут сбить синхронизацию, повреждённый кадр отсекает CRC.
+// Токен - FNV-1a 32 от строки формата, свёрнутый до 24 бит; таблицу строк для
+// хоста собирает tools/log_tokens.py при сборке и там же проверяет коллизии. Целые со знаком (%d %i) кодируются zigzag
+// varint, беззнаковые - varint, строки - длина и байты. Токен 0 зарезервирован
+// под сообщение о потерянных записях.
+// ============================================================================
+
+uint32_t fnv1a24(const char* str) {
+    uint32_t hash = 2166136261UL;
+    while (*str) {
+        hash ^= (uint8_t)*str++;
+        hash *= 16777619UL;
+    }
+    return (hash >> 24) ^ (hash & 0xFFFFFF);
+}
+
+// Кэш токенов: хэш строки считается один раз на адрес формата
+uint32_t tokenFor(const char* format) {
+    static const char* cachedFormats[LOG_TOKEN_CACHE_SIZE];
+    static uint32_t cachedTokens[LOG_TOKEN_CACHE_SIZE];
+    uint32_t index = ((uintptr_t)format >> 2) & (LOG_TOKEN_CACHE_SIZE - 1);
+    if (cachedFormats[index] != format) {
+        cachedFormats[index] = format;
+        cachedTokens[index] = fnv1a24(format);
+    }
+    return cachedTokens[index];
+}
+
+size_t putVarint(uint8_t* out, uint32_t value) {
+    size_t len = 0;
+    while (value >= 0x80) {
+        out[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[len++] = (uint8_t)value;
+    return len;
+}
+
+size_t putToken(uint8_t* out, uint32_t token) {
+    out[0] = (uint8_t)token;
+    out[1] = (uint8_t)(token >> 8);
+    out[2] = (uint8_t)(token >> 16);
+    return 3;
+}
+
+uint32_t lastTimestamp = 0;
+
+// CRC и COBS поверх готового пакета: кадр 0x00 <COBS> 0x00 в frame
+size_t finishFrame(uint8_t* packet, size_t length, uint8_t* frame) {
+    BinaryProtocol::writeLe16(packet + length, BinaryProtocol::crc16(packet, length));
+    length += 2;
+    frame[0] = 0;
+    size_t wireLength = 1 + BinaryProtocol::cobsEncode(packet, length, frame + 1);
+    frame[wireLength++] = 0;
+    return wireLength;
+}
+
+size_t encodeBinary(const LogRecord& record, uint8_t* frame) {
+    uint8_t packet[LOG_PACKET_MAX];
+    packet[0] = BinaryProtocol::LOG_TAG;
+    packet[1] = record.level;
+    size_t len = 2;
+    len += putToken(packet + len, tokenFor(record.format));
+    len += putVarint(packet + len, record.timestamp - lastTimestamp);
+    lastTimestamp = record.timestamp;
+
+    const char* p = record.format;
+    bool isLong;
+    char conversion;
+    uint8_t argIndex = 0;
+    while (argIndex < record.argCount && (conversion = nextConversion(p, isLong, nullptr, 0))) {
+        uint32_t value = record.args[argIndex++];
+        if (conversion == 's') {
+            const char* str = value < LOG_TEXT_SIZE ? &record.text[value] : "";
+            size_t strLen = strlen(str);
+            packet[len++] = (uint8_t)strLen;
+            memcpy(packet + len, str, strLen);
+            len += strLen;
+        } else if (conversion == 'd' || conversion == 'i') {
+            int32_t signedValue = (int32_t)value;
+            len += putVarint(packet + len, ((uint32_t)signedValue << 1) ^ (uint32_t)(signedValue >> 31));
+        } else {
+            len += putVarint(packet + len, value);
+        }
+    }
+    return finishFrame(packet, len, frame);
+}
+
+size_t encodeDropped(uint32_t dropped, uint8_t* frame) {
+    uint8_t packet[LOG_PACKET_MAX];
+    packet[0] = BinaryProtocol::LOG_TAG;
+    packet[1] = Logger::LEVEL_ERROR;
+    size_t len = 2;
+    len += putToken(packet + len, 0);
+    len += putVarint(packet + len, 0);
+    len += putVarint(packet + len, dropped);
+    return finishFrame(packet, len, frame);
+}
+
+}  // namespace
+
+void Logger::begin() {
+    if (!slotsInitialized) {
+        initSlots();
+    }
+    drainTaskHandle = Rtos::startTask<Rtos::TASK_LOGGER>(drainTask);
+}
+
+uint32_t Logger::droppedCount() {
+    return logDropped.load(std::memory_order_relaxed);
+}
+
+void Logger::write(Level level, const char* format, va_list args) {
+    if (!slotsInitialized) {
+        initSlots();
+    }
+
+    // Захват ячейки
+    uint32_t position = logHead.load(std::memory_order_relaxed);
+    LogSlot* slot;
+    while (true) {
+        slot = &logSlots[position & (LOG_QUEUE_SIZE - 1)];
+        uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+        int32_t diff = (int32_t)(sequence - position);
+        if (diff == 0) {
+            if (logHead.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Очередь заполнена: считаем потерю и не ждём
+            logDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            position = logHead.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Заполнение записи: только копирование аргументов, без форматирования
+    LogRecord& record = slot->record;
+    record.format = format;
+    record.timestamp = Hal::millis();
+    record.level = level;
+    record.argCount = 0;
+    uint8_t textUsed = 0;
+
+    const char* p = format;
+    bool isLong;
+    char conversion;
+    while (record.argCount < LOG_MAX_ARGS && (conversion = nextConversion(p, isLong, nullptr, 0))) {
+        uint32_t value;
+        if (conversion == 's') {
+            const char* str = va_arg(args, const char*);
+            if (!str) {
+                str = "(null)";
+            }
+            value = textUsed;
+            while (*str && textUsed < LOG_TEXT_SIZE - 1) {
+                record.text[textUsed++] = *str++;
+            }
+            if (textUsed < LOG_TEXT_SIZE) {
+                record.text[textUsed++] = '\0';
+            }
+        } else if (isLong) {
+            value = (uint32_t)va_arg(args, unsigned long);
+        } else {
+            value = va_arg(args, unsigned int);
+        }
+        record.args[record.argCount++] = value;
+    }
+    record.text[LOG_TEXT_SIZE - 1] = '\0';
+
+    slot->sequence.store(position + 1, std::memory_order_release);
+
+    // Будим задачу вывода только если она уснула на пустой очереди
+    if (drainTaskHandle && drainWaiting.exchange(false, std::memory_order_acq_rel)) {
+        if (xPortInIsrContext()) {
+            BaseType_t woken = pdFALSE;
+            vTaskNotifyGiveFromISR(drainTaskHandle, &woken);
+            portYIELD_FROM_ISR(woken);
+        } else {
+            xTaskNotifyGive(drainTaskHandle);
+        }
+    }
+}
+
+void Logger::setBinaryMode(bool enabled) {
+    binaryMode.store(enabled, std::memory_order_relaxed);
+}
+
+bool Logger::isBinaryMode() {
+    return binaryMode.load(std::memory_order_relaxed);
+}
+
+void Logger::setSerialOutput(bool enabled) {
+    serialOutput.store(enabled, std::memory_order_relaxed);
+}
+
+bool Logger::drain() {
+    if (!slotsInitialized) {
+        return false;
+    }
+    LogRecord record;
+    uint8_t output[LOG_LINE_SIZE];
+
+    LogSlot& slot = logSlots[logTail & (LOG_QUEUE_SIZE - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != logTail + 1) {
+        // Очередь пуста: сообщаем о потерях
+        uint32_t dropped = logDropped.load(std::memory_order_relaxed);
+        if (dropped != reportedDropped) {
+            size_t len = binaryMode.load(std::memory_order_relaxed)
+                ? encodeDropped(dropped - reportedDropped, output)
+                : snprintf((char*)output, sizeof(output), "[ERROR] Logger dropped %u messages\r\n",
+                           (unsigned)(dropped - reportedDropped));
+            if (serialOutput.load(std::memory_order_relaxed)) {
+                Hal::serial().write(output, len);
+            }
+            reportedDropped = dropped;
+        }
+        return false;
+    }
+
+    record = slot.record;
+    slot.sequence.store(logTail + LOG_QUEUE_SIZE, std::memory_order_release);
+    logTail++;
+    if (!serialOutput.load(std::memory_order_relaxed)) {
+        return true;
+    }
+
+    size_t len = binaryMode.load(std::memory_order_relaxed)
+        ? encodeBinary(record, output)
+        : formatText(record, (char*)output);
+    Hal::serial().write(output, len);
+    return true;
+}
+
+void Logger::drainTask(void* parameter) {
+    while (1) {
+        if (drain()) {
+            continue;
+        }
+
+        // Засыпаем до следующей записи; запись, пришедшая до флага, разбирается сразу
+        drainWaiting.store(true, std::memory_order_release);
+        if (logSlots[logTail & (LOG_QUEUE_SIZE - 1)].sequence.load(std::memory_order_acquire) != logTail + 1) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOG_DRAIN_IDLE_MS));
+        }
+    }
+}
@@ -2,25 +2,70 @@
 #define LOGGER_H
 
 #include <Arduino.h>
+#include <stdarg.h>
+#include "config.h"
 
+/**
+ * Асинхронный логгер. Вызов info/error/debug только кладёт запись фиксированного
+ * размера (формат + аргументы) в lock-free очередь; форматирование и вывод в
+ * Serial выполняет низкоприоритетная задача. При переполнении запись
+ * отбрасывается и учитывается в счётчике, вызывающий никогда не ждёт UART.
+ *
+ * Формат - статическая строка printf (%d %i %u %x %X %c %s и %%). Строки %s
+ * копируются в запись в момент вызова, поэтому можно передавать временные буферы.
+ *
+ * В бинарном режиме вместо текста уходит кадр с токеном формата, уровнем,
+ * временем и сырыми аргументами; текст восстанавливает декодер на хосте.
+ */
 class Logger {
 public:
-    static void info(const String& message) {
-        Serial.print("[INFO] ");
-        Serial.println(message);
+    enum Level : uint8_t {
+        LEVEL_INFO,
+        LEVEL_ERROR,
+        LEVEL_DEBUG
+    };
+
+    static void begin();
+
+    static void info(const char* format, ...) __attribute__((format(printf, 1, 2))) {
+        va_list args;
+        va_start(args, format);
+        write(LEVEL_INFO, format, args);
+        va_end(args);
     }
-    
-    static void error(const String& message) {
-        Serial.print("[ERROR] ");
-        Serial.println(message);
+
+    static void error(const char* format, ...) __attribute__((format(printf, 1, 2))) {
+        va_list args;
+        va_start(args, format);
+        write(LEVEL_ERROR, format, args);
+        va_end(args);
     }
-    
-    static void debug(const String& message) {
+
+    static void debug(const char* format, ...) __attribute__((format(printf, 1, 2))) {
         #ifdef DEBUG
-        Serial.print("[DEBUG] ");
-        Serial.println(message);
+        va_list args;
+        va_start(args, format);
+        write(LEVEL_DEBUG, format, args);
+        va_end(args);
         #endif
     }
+
+    static uint32_t droppedCount();
+
+    // Вывод одной записи (или сводки потерь), false - очередь пуста. Задача вывода
+    // вызывает его в цикле; хостовые сборки без задач - сами
+    static bool drain();
+
+    // Токенизированный бинарный вывод (декодер: tools/log_decode.py)
+    static void setBinaryMode(bool enabled);
+    static bool isBinaryMode();
+
+    // Вывод в Serial: узел с адресом на общей шине молчит, записи только расходуются
+    static void setSerialOutput(bool enabled);
+
+private:
+    static void write(Level level, const char* format, va_list args);
+    static void drainTask(void* parameter);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,99 @@
+#include "reactor.h"
+#include "logger.h"
+#include "rtos.h"
+#include "stats.h"
+#include "../hal/hal.h"
+
+Reactor::Entry Reactor::entries_[REACTOR_MAX_HANDLERS];
+uint8_t Reactor::count_ = 0;
+TaskHandle_t Reactor::task_ = nullptr;
+volatile uint32_t Reactor::wakeups_ = 0;
+
+uint32_t Reactor::add(Handler handler, Deadline deadline) {
+    if (count_ >= REACTOR_MAX_HANDLERS) {
+        Logger::error("Reactor: handler table full");
+        return 0;
+    }
+    Entry& entry = entries_[count_];
+    entry.handler = handler;
+    entry.deadline = deadline;
+    entry.hasDue = false;
+    return 1UL << count_++;
+}
+
+bool Reactor::begin() {
+    task_ = Rtos::startTask<Rtos::TASK_REACTOR>(run);
+    if (!task_) {
+        Logger::error("Reactor task creation failed");
+        return false;
+    }
+    Logger::info("Reactor started with %u handlers", count_);
+    return true;
+}
+
+TaskHandle_t Reactor::task() {
+    return task_;
+}
+
+void Reactor::signal(uint32_t bits) {
+    TaskHandle_t task = task_;
+    if (task) {
+        xTaskNotify(task, bits, eSetBits);
+    }
+}
+
+void IRAM_ATTR Reactor::signalFromISR(uint32_t bits, BaseType_t* woken) {
+    TaskHandle_t task = task_;
+    if (task) {
+        xTaskNotifyFromISR(task, bits, eSetBits, woken);
+    }
+}
+
+uint32_t Reactor::wakeupCount() {
+    return wakeups_;
+}
+
+TickType_t Reactor::refreshDeadlines(TickType_t now) {
+    // Сроки пересчитываются после каждого прохода: обработчик мог их сдвинуть
+    TickType_t timeout = portMAX_DELAY;
+    for (uint8_t i = 0; i < count_; i++) {
+        Entry& entry = entries_[i];
+        TickType_t ticks = entry.deadline ? entry.deadline() : portMAX_DELAY;
+        entry.hasDue = ticks != portMAX_DELAY;
+        if (entry.hasDue) {
+            entry.dueTick = now + ticks;
+            if (ticks < timeout) {
+                timeout = ticks;
+            }
+        }
+    }
+    return timeout;
+}
+
+void Reactor::run(void* parameter) {
+    uint32_t fired = 0;
+    
+    while (1) {
+        /**
+         * ПРОХОД РЕАКТОРА:
+         * 1. Вызываем обработчики с выставленным битом или наступившим сроком
+         * 2. Собираем ближайший срок по всем обработчикам
+         * 3. Спим в xTaskNotifyWait до уведомления или срока, биты сбрасываются при выходе
+         */
+        TickType_t now = xTaskGetTickCount();
+        uint32_t startUs = (uint32_t)Hal::nowUs();
+        for (uint8_t i = 0; i < count_; i++) {
+            Entry& entry = entries_[i];
+            bool due = entry.hasDue && (TickType_t)(now - entry.dueTick) < portMAX_DELAY / 2;
+            if ((fired & (1UL << i)) || due) {
+                entry.handler();
+            }
+        }
+        
+        TickType_t timeout = refreshDeadlines(xTaskGetTickCount());
+        Stats::taskLoop(Rtos::TASK_REACTOR, (uint32_t)Hal::nowUs() - startUs);
+        fired = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &fired, timeout);
+        wakeups_++;
+    }
+}
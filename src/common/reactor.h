@@ -0,0 +1,52 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * Однопоточный реактор: одна задача вместо отдельных задач модулей.
+ *
+ * Каждому обработчику при регистрации выдаётся бит уведомления. Источники
+ * (прерывание кнопки, драйвер UART, очередь ШИМ, программный таймер)
+ * выставляют свой бит через xTaskNotify(eSetBits), задача реактора спит в
+ * xTaskNotifyWait до ближайшего срока и вызывает только обработчики с
+ * выставленным битом или наступившим сроком.
+ *
+ * Обработчики не должны блокироваться: всё ожидание сосредоточено в run().
+ * Регистрация - в setup() до создания задачи реактора.
+ */
+class Reactor {
+public:
+    typedef void (*Handler)();
+    typedef TickType_t (*Deadline)();   // Тиков до срока, portMAX_DELAY - срока нет
+    
+    // Бит уведомления обработчика, 0 - таблица заполнена
+    static uint32_t add(Handler handler, Deadline deadline = nullptr);
+    
+    static bool begin();                // Создаёт задачу реактора
+    static TaskHandle_t task();
+    
+    static void signal(uint32_t bits);
+    static void signalFromISR(uint32_t bits, BaseType_t* woken);
+    
+    static uint32_t wakeupCount();
+
+private:
+    struct Entry {
+        Handler handler;
+        Deadline deadline;
+        TickType_t dueTick;             // Абсолютный срок, действителен при hasDue
+        bool hasDue;
+    };
+    
+    static Entry entries_[REACTOR_MAX_HANDLERS];
+    static uint8_t count_;
+    static TaskHandle_t task_;
+    static volatile uint32_t wakeups_;
+    
+    static void run(void* parameter);
+    static TickType_t refreshDeadlines(TickType_t now);
+};
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+
+/**
+ * Кольцевой буфер "один производитель - один потребитель" без блокировок.
+ *
+ * - Ёмкость - степень двойки, индексы свободно растут и маскируются при доступе,
+ *   поэтому нет ни деления, ни общего счётчика элементов.
+ * - head_ пишет только производитель, tail_ - только потребитель. Запись
+ *   индекса с release и чтение чужого индекса с acquire гарантируют, что данные
+ *   видны до индекса - буфер безопасен между ISR и задачей.
+ * - Пакетные write/read/peek копируют не более чем двумя непрерывными кусками.
+ *
+ * Методы производителя: put, write, space, isFull.
+ * Методы потребителя: get, read, peek, skip, clear, available, isEmpty.
+ */
+template <typename T, size_t Capacity>
+class RingBuffer {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "RingBuffer capacity must be a power of two");
+
+public:
+    RingBuffer() : head_(0), tail_(0) {
+    }
+
+    bool put(const T& item) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= Capacity) {
+            return false; // Буфер переполнен
+        }
+        data_[head & MASK] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool get(T* item) {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (head_.load(std::memory_order_acquire) == tail) {
+            return false; // Буфер пуст
+        }
+        *item = data_[tail & MASK];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Записывает сколько поместится, возвращает число записанных элементов
+    size_t write(const T* items, size_t count) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        size_t free = Capacity - (head - tail_.load(std::memory_order_acquire));
+        if (count > free) {
+            count = free;
+        }
+        copyIn(head, items, count);
+        head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    size_t read(T* items, size_t count) {
+        size_t copied = peek(items, count);
+        tail_.store(tail_.load(std::memory_order_relaxed) + copied, std::memory_order_release);
+        return copied;
+    }
+
+    // Копирует без извлечения
+    size_t peek(T* items, size_t count) const {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        size_t used = head_.load(std::memory_order_acquire) - tail;
+        if (count > used) {
+            count = used;
+        }
+        size_t offset = tail & MASK;
+        size_t first = std::min(count, Capacity - offset);
+        std::copy_n(data_ + offset, first, items);
+        std::copy_n(data_, count - first, items + first);
+        return count;
+    }
+
+    size_t skip(size_t count) {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        size_t used = head_.load(std::memory_order_acquire) - tail;
+        if (count > used) {
+            count = used;
+        }
+        tail_.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    // Сброс со стороны потребителя: всё записанное считается прочитанным
+    void clear() {
+        tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    size_t available() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    size_t space() const {
+        return Capacity - available();
+    }
+
+    bool isEmpty() const {
+        return available() == 0;
+    }
+
+    bool isFull() const {
+        return available() >= Capacity;
+    }
+
+    static constexpr size_t capacity() {
+        return Capacity;
+    }
+
+private:
+    static constexpr uint32_t MASK = Capacity - 1;
+
+    void copyIn(uint32_t head, const T* items, size_t count) {
+        size_t offset = head & MASK;
+        size_t first = std::min(count, Capacity - offset);
+        std::copy_n(items, first, data_ + offset);
+        std::copy_n(items + first, count - first, data_);
+    }
+
+    T data_[Capacity];
+    std::atomic<uint32_t> head_;
+    std::atomic<uint32_t> tail_;
+};
+
+#endif
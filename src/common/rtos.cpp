@@ -0,0 +1,19 @@
+#include "rtos.h"
+
+namespace Rtos {
+
+namespace {
+
+TaskHandle_t handles[TASK_COUNT];
+
+}  // namespace
+
+void registerTask(TaskId id, TaskHandle_t handle) {
+    handles[id] = handle;
+}
+
+TaskHandle_t taskHandle(TaskId id) {
+    return id < TASK_COUNT ? handles[id] : nullptr;
+}
+
+}  // namespace Rtos
@@ -0,0 +1,103 @@
+#ifndef RTOS_H
+#define RTOS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * Единая таблица задач прошивки и их статическое размещение.
+ *
+ * Стек и TCB каждой задачи - статические массивы, создаются через
+ * xTaskCreateStaticPinnedToCore, поэтому нехватка кучи при старте невозможна,
+ * а объём ОЗУ под задачи известен при сборке (RTOS_TASK_RAM_BYTES).
+ * Хранилище задачи - статический член шаблона, и в образ оно попадает,
+ * только если код запуска задачи жив (--gc-sections): в режиме реактора
+ * стеки отдельных задач не занимают память.
+ *
+ * Размер стека - в байтах (на ESP32 StackType_t однобайтовый).
+ */
+namespace Rtos {
+
+enum TaskId : uint8_t {
+    TASK_LOGGER,
+    TASK_BUTTON,
+    TASK_KEYS,
+    TASK_PWM,
+    TASK_UART,
+    TASK_STATUS_LED,
+    TASK_REACTOR,
+    TASK_COUNT
+};
+
+struct TaskSpec {
+    const char* name;
+    uint32_t stackBytes;
+    UBaseType_t priority;
+    BaseType_t core;
+    bool enabled;            // Запускается в текущем режиме сборки
+};
+
+// Управляющие задачи на одном ядре: приоритеты задают порядок без гонок между ядрами
+constexpr TaskSpec TASK_TABLE[TASK_COUNT] = {
+    //  name         stack                 priority            core        enabled
+    { "Logger",      LOG_TASK_STACK_SIZE,  LOG_TASK_PRIORITY,  RTOS_IO_CORE,       true },
+    { "Button",      4096,                 3,                  RTOS_CONTROL_CORE, !REACTOR_MODE },
+    { "Keys",        3072,                 3,                  RTOS_CONTROL_CORE, !REACTOR_MODE && BUTTON_BANK_ENABLED },
+    { "PWM",         4096,                 3,                  RTOS_CONTROL_CORE, !REACTOR_MODE },
+    { "UART",        4096,                 2,                  RTOS_CONTROL_CORE, !REACTOR_MODE },
+    { "StatusLED",   2048,                 1,                  RTOS_CONTROL_CORE, !REACTOR_MODE },
+    { "Reactor",     REACTOR_STACK_SIZE,   REACTOR_PRIORITY,   RTOS_CONTROL_CORE,  REACTOR_MODE },
+};
+
+constexpr uint32_t taskRamBytes() {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < TASK_COUNT; i++) {
+        if (TASK_TABLE[i].enabled) {
+            total += TASK_TABLE[i].stackBytes + sizeof(StaticTask_t);
+        }
+    }
+    return total;
+}
+
+constexpr uint32_t RTOS_TASK_RAM_BYTES = taskRamBytes();
+
+template <TaskId Id>
+struct TaskStorage {
+    static StackType_t stack[TASK_TABLE[Id].stackBytes / sizeof(StackType_t)];
+    static StaticTask_t tcb;
+};
+
+template <TaskId Id>
+StackType_t TaskStorage<Id>::stack[TASK_TABLE[Id].stackBytes / sizeof(StackType_t)];
+
+template <TaskId Id>
+StaticTask_t TaskStorage<Id>::tcb;
+
+void registerTask(TaskId id, TaskHandle_t handle);
+TaskHandle_t taskHandle(TaskId id);
+
+// Создание задачи по строке таблицы, хранилище - TaskStorage<Id>
+template <TaskId Id>
+TaskHandle_t startTask(TaskFunction_t function, void* parameter = nullptr) {
+    const TaskSpec& spec = TASK_TABLE[Id];
+    TaskHandle_t handle = xTaskCreateStaticPinnedToCore(function, spec.name, spec.stackBytes, parameter,
+                                                        spec.priority, TaskStorage<Id>::stack,
+                                                        &TaskStorage<Id>::tcb, spec.core);
+    registerTask(Id, handle);
+    return handle;
+}
+
+// Статическая очередь: хранилище элементов и управляющая структура рядом
+template <typename T, uint8_t Depth>
+struct StaticQueue {
+    uint8_t storage[Depth * sizeof(T)];
+    StaticQueue_t control;
+    
+    QueueHandle_t create() {
+        return xQueueCreateStatic(Depth, sizeof(T), storage, &control);
+    }
+};
+
+}  // namespace Rtos
+
+#endif
@@ -0,0 +1,111 @@
+#include "stats.h"
+#include "../hal/hal.h"
+
+uint32_t Stats::counters_[STAT_COUNTER_COUNT];
+Stats::Gauge Stats::gauges_[STAT_GAUGE_COUNT];
+Stats::Histogram Stats::histograms_[STAT_HIST_COUNT];
+Stats::TaskTime Stats::tasks_[Rtos::TASK_COUNT];
+uint32_t Stats::resetMs_ = 0;
+
+namespace {
+
+const char* const COUNTER_NAMES[STAT_COUNTER_COUNT] = {
+    "RX_BYTES",
+    "RX_OVERFLOWS",
+    "CMD_OVERFLOWS",
+    "COMMANDS",
+    "COMMAND_ERRORS",
+    "BINARY_FRAMES",
+    "FOREIGN_LINES",
+    "BUTTON_EDGES",
+    "BUTTON_EDGES_LOST",
+    "BUTTON_EVENTS",
+    "PWM_APPLIED",
+    "PWM_DROPPED",
+    "BUS_DROPPED",
+};
+
+const char* const GAUGE_NAMES[STAT_GAUGE_COUNT] = {
+    "UART_RX",
+    "PWM_QUEUE",
+    "BUS_QUEUE",
+};
+
+const char* const HISTOGRAM_NAMES[STAT_HIST_COUNT] = {
+    "BUTTON_EVENT_US",
+    "COMMAND_APPLY_US",
+    "LOOP_JITTER_US",
+};
+
+}  // namespace
+
+void Stats::taskLoop(Rtos::TaskId task, uint32_t busyUs) {
+    #if STATS_ENABLED
+    // Каждую строку пишет только своя задача, атомарность нужна лишь против сброса
+    TaskTime& time = tasks_[task];
+    __atomic_fetch_add(&time.loops, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&time.busyUs, busyUs, __ATOMIC_RELAXED);
+    raiseMax(time.maxLoopUs, busyUs);
+    #endif
+}
+
+void Stats::reset() {
+    for (uint8_t i = 0; i < STAT_COUNTER_COUNT; i++) {
+        __atomic_store_n(&counters_[i], 0, __ATOMIC_RELAXED);
+    }
+    for (uint8_t i = 0; i < STAT_GAUGE_COUNT; i++) {
+        __atomic_store_n(&gauges_[i].max, gauges_[i].current, __ATOMIC_RELAXED);
+    }
+    for (uint8_t i = 0; i < STAT_HIST_COUNT; i++) {
+        for (uint8_t b = 0; b < STATS_HIST_BUCKETS; b++) {
+            __atomic_store_n(&histograms_[i].buckets[b], 0, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&histograms_[i].max, 0, __ATOMIC_RELAXED);
+    }
+    for (uint8_t i = 0; i < Rtos::TASK_COUNT; i++) {
+        __atomic_store_n(&tasks_[i].loops, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&tasks_[i].busyUs, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&tasks_[i].maxLoopUs, 0, __ATOMIC_RELAXED);
+    }
+    resetMs_ = Hal::millis();
+}
+
+uint32_t Stats::sinceResetMs() {
+    return Hal::millis() - resetMs_;
+}
+
+uint32_t Stats::counter(StatCounter id) {
+    return __atomic_load_n(&counters_[id], __ATOMIC_RELAXED);
+}
+
+Stats::Gauge Stats::gaugeValue(StatGauge id) {
+    Gauge value = { __atomic_load_n(&gauges_[id].current, __ATOMIC_RELAXED),
+                    __atomic_load_n(&gauges_[id].max, __ATOMIC_RELAXED) };
+    return value;
+}
+
+void Stats::histogram(StatHistogram id, Histogram& out) {
+    for (uint8_t b = 0; b < STATS_HIST_BUCKETS; b++) {
+        out.buckets[b] = __atomic_load_n(&histograms_[id].buckets[b], __ATOMIC_RELAXED);
+    }
+    out.max = __atomic_load_n(&histograms_[id].max, __ATOMIC_RELAXED);
+}
+
+Stats::TaskTime Stats::taskTime(Rtos::TaskId task) {
+    TaskTime time = { __atomic_load_n(&tasks_[task].loops, __ATOMIC_RELAXED),
+                      __atomic_load_n(&tasks_[task].busyUs, __ATOMIC_RELAXED),
+                      __atomic_load_n(&tasks_[task].maxLoopUs, __ATOMIC_RELAXED) };
+    return time;
+}
+
+const char* Stats::counterName(StatCounter id) {
+    return COUNTER_NAMES[id];
+}
+
+const char* Stats::gaugeName(StatGauge id) {
+    return GAUGE_NAMES[id];
+}
+
+const char* Stats::histogramName(StatHistogram id) {
+    return HISTOGRAM_NAMES[id];
+}
@@ -0,0 +1,124 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "rtos.h"
+
+enum StatCounter : uint8_t {
+    STAT_RX_BYTES,
+    STAT_RX_OVERFLOWS,          // Переполнение кольцевого буфера приёма
+    STAT_CMD_OVERFLOWS,         // Слишком длинная строка команды
+    STAT_COMMANDS,
+    STAT_COMMAND_ERRORS,
+    STAT_BINARY_FRAMES,
+    STAT_FOREIGN_LINES,         // Строки для других узлов шины, отброшенные до разбора
+    STAT_BUTTON_EDGES,
+    STAT_BUTTON_EDGES_LOST,
+    STAT_BUTTON_EVENTS,
+    STAT_PWM_APPLIED,
+    STAT_PWM_DROPPED,
+    STAT_BUS_DROPPED,
+    STAT_COUNTER_COUNT
+};
+
+// Текущее значение и максимум с последнего сброса
+enum StatGauge : uint8_t {
+    STAT_GAUGE_UART_RX,         // Байт в кольцевом буфере приёма
+    STAT_GAUGE_PWM_QUEUE,       // Команд в очереди владельца ШИМ
+    STAT_GAUGE_BUS_QUEUE,       // Записей в очереди подписчика шины (наибольшая)
+    STAT_GAUGE_COUNT
+};
+
+enum StatHistogram : uint8_t {
+    STAT_HIST_BUTTON_EVENT,     // Фронт/срок жеста -> публикация жеста, мкс
+    STAT_HIST_COMMAND_APPLY,    // Приём команды (строка UART, жест) -> применение ШИМ, мкс
+    STAT_HIST_LOOP_JITTER,      // Отклонение периода такта замкнутого контура от номинала, мкс
+    STAT_HIST_COUNT
+};
+
+/**
+ * Счётчики производительности.
+ *
+ * Запись на горячих путях - одна атомарная операция без блокировок
+ * (гистограмма - две). Гистограммы логарифмические: корзина i считает
+ * значения в [2^(i-1), 2^i), последняя - всё, что больше. Время задач
+ * копится по циклам: время от пробуждения до следующего сна.
+ *
+ * Сброс (STATS RESET) обнуляет значения без остановки записи, отдельные
+ * инкременты на его границе могут попасть в старый или новый интервал.
+ */
+class Stats {
+public:
+    struct Gauge {
+        uint32_t current;
+        uint32_t max;
+    };
+    
+    struct Histogram {
+        uint32_t buckets[STATS_HIST_BUCKETS];
+        uint32_t max;
+    };
+    
+    struct TaskTime {
+        uint32_t loops;
+        uint32_t busyUs;
+        uint32_t maxLoopUs;
+    };
+    
+    static void add(StatCounter counter, uint32_t amount = 1) {
+        #if STATS_ENABLED
+        __atomic_fetch_add(&counters_[counter], amount, __ATOMIC_RELAXED);
+        #endif
+    }
+    
+    static void gauge(StatGauge id, uint32_t value) {
+        #if STATS_ENABLED
+        gauges_[id].current = value;
+        raiseMax(gauges_[id].max, value);
+        #endif
+    }
+    
+    static void record(StatHistogram id, uint32_t valueUs) {
+        #if STATS_ENABLED
+        uint8_t bucket = valueUs ? 32 - __builtin_clz(valueUs) : 0;
+        if (bucket >= STATS_HIST_BUCKETS) {
+            bucket = STATS_HIST_BUCKETS - 1;
+        }
+        __atomic_fetch_add(&histograms_[id].buckets[bucket], 1, __ATOMIC_RELAXED);
+        raiseMax(histograms_[id].max, valueUs);
+        #endif
+    }
+    
+    // Цикл задачи: busyUs - время работы от пробуждения до сна
+    static void taskLoop(Rtos::TaskId task, uint32_t busyUs);
+    
+    static void reset();
+    static uint32_t sinceResetMs();
+    
+    static uint32_t counter(StatCounter id);
+    static Gauge gaugeValue(StatGauge id);
+    static void histogram(StatHistogram id, Histogram& out);
+    static TaskTime taskTime(Rtos::TaskId task);
+    
+    static const char* counterName(StatCounter id);
+    static const char* gaugeName(StatGauge id);
+    static const char* histogramName(StatHistogram id);
+
+private:
+    static uint32_t counters_[STAT_COUNTER_COUNT];
+    static Gauge gauges_[STAT_GAUGE_COUNT];
+    static Histogram histograms_[STAT_HIST_COUNT];
+    static TaskTime tasks_[Rtos::TASK_COUNT];
+    static uint32_t resetMs_;
+    
+    // Максимум без блокировок: CAS повторяется, только пока значение растёт
+    static void raiseMax(uint32_t& target, uint32_t value) {
+        uint32_t seen = __atomic_load_n(&target, __ATOMIC_RELAXED);
+        while (value > seen &&
+               !__atomic_compare_exchange_n(&target, &seen, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,66 @@
+#include "trace.h"
+
+TraceRecord Trace::records_[TRACE_BUFFER_SIZE];
+uint32_t Trace::head_ = 0;
+uint16_t Trace::nextId_ = 0;
+bool Trace::enabled_ = true;
+
+namespace {
+
+const char* const STAGE_NAMES[TRACE_STAGE_COUNT] = {
+    "EDGE",
+    "ACCEPT",
+    "GESTURE",
+    "RX",
+    "LINE",
+    "PARSE",
+    "DISPATCH",
+    "SEND",
+    "RECEIVE",
+    "APPLY",
+};
+
+}  // namespace
+
+uint16_t Trace::begin() {
+    uint16_t id;
+    do {
+        id = __atomic_add_fetch(&nextId_, 1, __ATOMIC_RELAXED);
+    } while (id == 0);
+    return id;
+}
+
+void Trace::setEnabled(bool enabled) {
+    __atomic_store_n(&enabled_, enabled, __ATOMIC_RELAXED);
+}
+
+bool Trace::isEnabled() {
+    return __atomic_load_n(&enabled_, __ATOMIC_RELAXED);
+}
+
+void Trace::clear() {
+    __atomic_store_n(&head_, 0, __ATOMIC_RELAXED);
+}
+
+uint16_t Trace::available() {
+    uint32_t head = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+    return head < TRACE_BUFFER_SIZE ? head : TRACE_BUFFER_SIZE;
+}
+
+uint32_t Trace::lost() {
+    uint32_t head = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+    return head - available();
+}
+
+bool Trace::read(uint16_t index, TraceRecord& record) {
+    if (index >= available()) {
+        return false;
+    }
+    uint32_t oldest = __atomic_load_n(&head_, __ATOMIC_RELAXED) - available();
+    record = records_[(oldest + index) & (TRACE_BUFFER_SIZE - 1)];
+    return true;
+}
+
+const char* Trace::stageName(TraceStage stage) {
+    return stage < TRACE_STAGE_COUNT ? STAGE_NAMES[stage] : "UNKNOWN";
+}
@@ -0,0 +1,90 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "../hal/hal.h"
+
+// Этапы прохождения нажатия и команды до ШИМ
+enum TraceStage : uint8_t {
+    TRACE_BUTTON_EDGE,          // Первый фронт серии (время прерывания), arg - уровень
+    TRACE_BUTTON_ACCEPT,        // Уровень принят фильтром дребезга, arg - уровень
+    TRACE_GESTURE,              // Жест опубликован на шину, arg - ButtonEvent
+    TRACE_UART_RX,              // Порция с первым байтом строки/кадра прочитана из драйвера
+    TRACE_UART_LINE,            // Строка или кадр собраны целиком
+    TRACE_UART_PARSE,           // Команда разобрана на слова / CRC кадра проверен
+    TRACE_UART_DISPATCH,        // Вызов обработчика команды
+    TRACE_QUEUE_SEND,           // Команда поставлена в очередь ШИМ, arg - PWMCommandType
+    TRACE_QUEUE_RECEIVE,        // Владелец ШИМ забрал команду из очереди
+    TRACE_PWM_APPLY,            // Команда выполнена (ledcWrite/запуск перехода), arg - канал
+    TRACE_STAGE_COUNT
+};
+
+struct TraceRecord {
+    uint32_t timeUs;
+    uint16_t id;                // Корреляционный ID: одно нажатие или одна строка UART
+    TraceStage stage;
+    uint8_t arg;
+};
+
+// Происхождение команды ШИМ: момент приёма и ID трассы (0 - без трассы)
+struct TraceOrigin {
+    uint32_t timeUs;
+    uint16_t id;
+};
+
+/**
+ * Кольцо трассы для разбора отдельных медленных взаимодействий.
+ *
+ * Каждый этап - одна запись с меткой времени и корреляционным ID.
+ * Запись без блокировок: место резервируется атомарным инкрементом
+ * головы, старые записи перезаписываются. Из прерываний не пишем -
+ * фронт кнопки записывается задачей с меткой времени из прерывания.
+ *
+ * TRACE DUMP останавливает запись на время выгрузки; tools/trace_json.py
+ * превращает выгрузку в JSON для chrome://tracing и Perfetto.
+ */
+class Trace {
+public:
+    static_assert((TRACE_BUFFER_SIZE & (TRACE_BUFFER_SIZE - 1)) == 0, "TRACE_BUFFER_SIZE must be a power of two");
+    
+    // Новый корреляционный ID, никогда не 0
+    static uint16_t begin();
+    
+    static void mark(TraceStage stage, uint16_t id, uint8_t arg = 0) {
+        markAt(stage, id, (uint32_t)Hal::nowUs(), arg);
+    }
+    
+    static void markAt(TraceStage stage, uint16_t id, uint32_t timeUs, uint8_t arg = 0) {
+        #if TRACE_ENABLED
+        if (id == 0 || !__atomic_load_n(&enabled_, __ATOMIC_RELAXED)) {
+            return;
+        }
+        uint32_t slot = __atomic_fetch_add(&head_, 1, __ATOMIC_RELAXED) & (TRACE_BUFFER_SIZE - 1);
+        TraceRecord& record = records_[slot];
+        record.timeUs = timeUs;
+        record.id = id;
+        record.stage = stage;
+        record.arg = arg;
+        #endif
+    }
+    
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+    static void clear();
+    
+    // Выгрузка: available записей от старой к новой, lost - перезаписанные
+    static uint16_t available();
+    static uint32_t lost();
+    static bool read(uint16_t index, TraceRecord& record);
+    
+    static const char* stageName(TraceStage stage);
+
+private:
+    static TraceRecord records_[TRACE_BUFFER_SIZE];
+    static uint32_t head_;
+    static uint16_t nextId_;
+    static bool enabled_;
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef HAL_H
+#define HAL_H
+
+/**
+ * Слой доступа к железу: часы, входы/выходы GPIO, LEDC, последовательный порт.
+ *
+ * В прошивке функции Hal - встраиваемые обёртки над Arduino/ESP-IDF: вызов
+ * Hal::nowUs() компилируется в тот же esp_timer_get_time(), накладных
+ * расходов нет. В хостовой сборке (HAL_NATIVE, [env:native]) те же функции
+ * уходят в подменяемые реализации из src/hal/native/: виртуальные часы,
+ * модель входов и регистров LEDC, порт с подачей и захватом байтов. Модули
+ * кнопки, ШИМ и UART выполняются на хосте без изменений и без реального
+ * времени (симулятор - src/sim/).
+ *
+ * Таймеры esp_timer и примитивы FreeRTOS модули вызывают напрямую: на хосте
+ * их заменяют заголовки src/hal/native/include/ поверх тех же виртуальных часов.
+ */
+
+#ifdef HAL_NATIVE
+
+#include "native/hal_native.h"
+
+#else
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <driver/ledc.h>
+#include <soc/gpio_reg.h>
+#include <soc/soc.h>
+
+// Обёртки, вызываемые из IRAM-обработчиков прерываний, встраиваются всегда
+#define HAL_INLINE inline __attribute__((always_inline))
+
+namespace Hal {
+
+typedef HardwareSerial SerialPort;
+
+// Часы
+HAL_INLINE int64_t nowUs() {
+    return esp_timer_get_time();
+}
+
+HAL_INLINE uint32_t millis() {
+    return ::millis();
+}
+
+// GPIO
+HAL_INLINE void pinMode(uint8_t pin, uint8_t mode) {
+    ::pinMode(pin, mode);
+}
+
+HAL_INLINE void digitalWrite(uint8_t pin, uint8_t level) {
+    ::digitalWrite(pin, level);
+}
+
+// Уровни входов слова: bank 0 - GPIO0-31, 1 - GPIO32-39. Безопасно в ISR, в отличие от digitalRead
+HAL_INLINE uint32_t readInputs(uint8_t bank) {
+    return bank ? REG_READ(GPIO_IN1_REG) : REG_READ(GPIO_IN_REG);
+}
+
+HAL_INLINE void attachEdgeInterrupt(uint8_t pin, void (*handler)(void*), void* arg) {
+    attachInterruptArg(digitalPinToInterrupt(pin), handler, arg, CHANGE);
+}
+
+HAL_INLINE uint16_t analogRead(uint8_t pin) {
+    return ::analogRead(pin);
+}
+
+// LEDC: номер канала 0-15, старшая восьмёрка - low-speed группа
+HAL_INLINE uint32_t ledcSetup(uint8_t channel, uint32_t frequency, uint8_t resolution) {
+    return ::ledcSetup(channel, frequency, resolution);
+}
+
+HAL_INLINE void ledcAttachPin(uint8_t pin, uint8_t channel) {
+    ::ledcAttachPin(pin, channel);
+}
+
+// Запись в регистр скважности без защёлкивания: выход меняет ledcUpdateDuty
+HAL_INLINE void ledcSetDuty(uint8_t channel, uint32_t counts) {
+    ledc_set_duty((ledc_mode_t)(channel / 8), (ledc_channel_t)(channel % 8), counts);
+}
+
+HAL_INLINE void ledcUpdateDuty(uint8_t channel) {
+    ledc_update_duty((ledc_mode_t)(channel / 8), (ledc_channel_t)(channel % 8));
+}
+
+// Последовательный порт команд и лога
+HAL_INLINE SerialPort& serial() {
+    return Serial;
+}
+
+}  // namespace Hal
+
+#endif
+
+#endif
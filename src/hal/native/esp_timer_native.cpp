@@ -0,0 +1,140 @@
+#include "hal_native.h"
+#include <esp_timer.h>
+
+/**
+ * Таймеры esp_timer поверх Hal::VirtualClock.
+ *
+ * Таймеры - статический пул (как и всё остальное в прошивке, без кучи).
+ * Срок - абсолютное время часов; при равных сроках первым срабатывает
+ * таймер, запущенный раньше, как в очереди esp_timer.
+ */
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void* arg;
+    const char* name;
+    int64_t dueUs;
+    uint64_t periodUs;      // 0 - однократный
+    uint32_t order;         // Порядок запуска при равных сроках
+    bool created;
+    bool armed;
+};
+
+namespace {
+
+const uint8_t TIMER_POOL_SIZE = 16;
+
+esp_timer timers[TIMER_POOL_SIZE];
+uint32_t startOrder = 0;
+
+esp_timer* nextDue() {
+    esp_timer* next = nullptr;
+    for (esp_timer& timer : timers) {
+        if (timer.armed && (!next || timer.dueUs < next->dueUs ||
+                            (timer.dueUs == next->dueUs && timer.order < next->order))) {
+            next = &timer;
+        }
+    }
+    return next;
+}
+
+esp_err_t arm(esp_timer_handle_t timer, uint64_t delayUs, uint64_t periodUs) {
+    if (!timer || !timer->created) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->dueUs = Hal::nowUs() + (int64_t)delayUs;
+    timer->periodUs = periodUs;
+    timer->order = startOrder++;
+    timer->armed = true;
+    return ESP_OK;
+}
+
+}  // namespace
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle) {
+    for (esp_timer& timer : timers) {
+        if (!timer.created) {
+            timer = {};
+            timer.callback = args->callback;
+            timer.arg = args->arg;
+            timer.name = args->name;
+            timer.created = true;
+            *handle = &timer;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs) {
+    return arm(timer, timeoutUs, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUs) {
+    return arm(timer, periodUs, periodUs);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (!timer || !timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    if (!timer || timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->created = false;
+    return ESP_OK;
+}
+
+int64_t esp_timer_get_time() {
+    return Hal::nowUs();
+}
+
+TickType_t xTaskGetTickCount() {
+    return pdMS_TO_TICKS(Hal::millis());
+}
+
+namespace Hal {
+
+bool VirtualClock::nextTimerUs(int64_t& dueUs) const {
+    esp_timer* next = nextDue();
+    if (!next) {
+        return false;
+    }
+    dueUs = next->dueUs;
+    return true;
+}
+
+bool VirtualClock::runDueTimers() {
+    bool fired = false;
+    esp_timer* timer;
+    while ((timer = nextDue()) && timer->dueUs <= nowUs_) {
+        // Периодический перезапускается до колбэка: колбэк может его остановить
+        if (timer->periodUs) {
+            timer->dueUs += (int64_t)timer->periodUs;
+            timer->order = startOrder++;
+        } else {
+            timer->armed = false;
+        }
+        timer->callback(timer->arg);
+        fired = true;
+    }
+    return fired;
+}
+
+void VirtualClock::advanceTo(int64_t targetUs) {
+    int64_t dueUs;
+    while (nextTimerUs(dueUs) && dueUs <= targetUs) {
+        setNow(dueUs);
+        runDueTimers();
+    }
+    setNow(targetUs);
+}
+
+}  // namespace Hal
@@ -0,0 +1,103 @@
+#include "hal_native.h"
+
+namespace Hal {
+
+namespace {
+
+// Заглушки до install(): часы стоят, входы подтянуты, выход пропадает
+class IdleClock : public Clock {
+public:
+    int64_t nowUs() override {
+        return 0;
+    }
+};
+
+class IdleGpio : public Gpio {
+public:
+    void pinMode(uint8_t pin, uint8_t mode) override {
+    }
+    void digitalWrite(uint8_t pin, uint8_t level) override {
+    }
+    uint32_t readInputs(uint8_t bank) override {
+        return UINT32_MAX;
+    }
+    void attachEdgeInterrupt(uint8_t pin, void (*handler)(void*), void* arg) override {
+    }
+    uint16_t analogRead(uint8_t pin) override {
+        return 0;
+    }
+};
+
+class IdleLedc : public Ledc {
+public:
+    uint32_t setup(uint8_t channel, uint32_t frequency, uint8_t resolution) override {
+        return frequency;
+    }
+    void attachPin(uint8_t pin, uint8_t channel) override {
+    }
+    void setDuty(uint8_t channel, uint32_t counts) override {
+    }
+    void updateDuty(uint8_t channel) override {
+    }
+};
+
+class IdleSerial : public SerialPort {
+public:
+    int available() override {
+        return 0;
+    }
+    size_t read(uint8_t* buffer, size_t size) override {
+        return 0;
+    }
+    int availableForWrite() override {
+        return INT32_MAX;
+    }
+    size_t write(const uint8_t* data, size_t size) override {
+        return size;
+    }
+};
+
+IdleClock idleClock;
+IdleGpio idleGpio;
+IdleLedc idleLedc;
+IdleSerial idleSerial;
+
+Clock* activeClock = &idleClock;
+Gpio* activeGpio = &idleGpio;
+Ledc* activeLedc = &idleLedc;
+SerialPort* activeSerial = &idleSerial;
+
+}  // namespace
+
+void install(Clock* clock, Gpio* gpio, Ledc* ledc, SerialPort* serial) {
+    if (clock) {
+        activeClock = clock;
+    }
+    if (gpio) {
+        activeGpio = gpio;
+    }
+    if (ledc) {
+        activeLedc = ledc;
+    }
+    if (serial) {
+        activeSerial = serial;
+    }
+}
+
+Clock& clock() {
+    return *activeClock;
+}
+
+Gpio& gpio() {
+    return *activeGpio;
+}
+
+Ledc& ledc() {
+    return *activeLedc;
+}
+
+SerialPort& serial() {
+    return *activeSerial;
+}
+
+}  // namespace Hal
@@ -0,0 +1,147 @@
+#ifndef HAL_NATIVE_H
+#define HAL_NATIVE_H
+
+#include <Arduino.h>
+#include <functional>
+
+/**
+ * Хостовая реализация Hal: функции уходят в подключаемые реализации.
+ *
+ * Каждая часть железа - интерфейс с виртуальными методами; симулятор
+ * устанавливает свои реализации через Hal::install() до begin() модулей.
+ * Без установки работают заглушки: часы стоят, входы подтянуты, запись
+ * в LEDC и порт пропадает.
+ */
+namespace Hal {
+
+class Clock {
+public:
+    virtual ~Clock() {}
+    virtual int64_t nowUs() = 0;
+};
+
+class Gpio {
+public:
+    virtual ~Gpio() {}
+    virtual void pinMode(uint8_t pin, uint8_t mode) = 0;
+    virtual void digitalWrite(uint8_t pin, uint8_t level) = 0;
+    virtual uint32_t readInputs(uint8_t bank) = 0;
+    virtual void attachEdgeInterrupt(uint8_t pin, void (*handler)(void*), void* arg) = 0;
+    virtual uint16_t analogRead(uint8_t pin) = 0;
+};
+
+class Ledc {
+public:
+    virtual ~Ledc() {}
+    virtual uint32_t setup(uint8_t channel, uint32_t frequency, uint8_t resolution) = 0;
+    virtual void attachPin(uint8_t pin, uint8_t channel) = 0;
+    virtual void setDuty(uint8_t channel, uint32_t counts) = 0;
+    virtual void updateDuty(uint8_t channel) = 0;
+};
+
+// Подмножество HardwareSerial, которым пользуются модули
+class SerialPort {
+public:
+    virtual ~SerialPort() {}
+    virtual void begin(unsigned long baud) {}
+    virtual size_t setRxBufferSize(size_t size) { return size; }
+    virtual void setRxTimeout(uint8_t symbols) {}
+    virtual void onReceive(std::function<void()> callback, bool onlyOnTimeout = false) {}
+    virtual bool setPins(int8_t rx, int8_t tx, int8_t cts = -1, int8_t rts = -1) { return true; }
+    virtual bool setMode(uint8_t mode) { return true; }
+    virtual int available() = 0;
+    virtual size_t read(uint8_t* buffer, size_t size) = 0;
+    virtual int availableForWrite() = 0;
+    virtual size_t write(const uint8_t* data, size_t size) = 0;
+};
+
+// Backend == nullptr оставляет текущий
+void install(Clock* clock, Gpio* gpio, Ledc* ledc, SerialPort* serial);
+
+Clock& clock();
+Gpio& gpio();
+Ledc& ledc();
+SerialPort& serial();
+
+inline int64_t nowUs() {
+    return clock().nowUs();
+}
+
+inline uint32_t millis() {
+    return (uint32_t)(clock().nowUs() / 1000);
+}
+
+inline void pinMode(uint8_t pin, uint8_t mode) {
+    gpio().pinMode(pin, mode);
+}
+
+inline void digitalWrite(uint8_t pin, uint8_t level) {
+    gpio().digitalWrite(pin, level);
+}
+
+inline uint32_t readInputs(uint8_t bank) {
+    return gpio().readInputs(bank);
+}
+
+inline void attachEdgeInterrupt(uint8_t pin, void (*handler)(void*), void* arg) {
+    gpio().attachEdgeInterrupt(pin, handler, arg);
+}
+
+inline uint16_t analogRead(uint8_t pin) {
+    return gpio().analogRead(pin);
+}
+
+inline uint32_t ledcSetup(uint8_t channel, uint32_t frequency, uint8_t resolution) {
+    return ledc().setup(channel, frequency, resolution);
+}
+
+inline void ledcAttachPin(uint8_t pin, uint8_t channel) {
+    ledc().attachPin(pin, channel);
+}
+
+inline void ledcSetDuty(uint8_t channel, uint32_t counts) {
+    ledc().setDuty(channel, counts);
+}
+
+inline void ledcUpdateDuty(uint8_t channel) {
+    ledc().updateDuty(channel);
+}
+
+/**
+ * ВИРТУАЛЬНЫЕ ЧАСЫ:
+ * Время стоит, пока его не сдвинут. advanceTo() идёт к цели по срокам
+ * таймеров esp_timer: часы встают на срок ближайшего таймера, вызывают
+ * его колбэк (как задача esp_timer) и идут дальше. Час работы прошивки
+ * проходит за время вызова колбэков.
+ */
+class VirtualClock : public Clock {
+public:
+    VirtualClock() : nowUs_(0) {}
+
+    int64_t nowUs() override {
+        return nowUs_;
+    }
+
+    // Ближайший срок запущенного таймера, false - таймеров нет
+    bool nextTimerUs(int64_t& dueUs) const;
+
+    // Вызов таймеров со сроком не позже текущего времени; false - ни одного
+    bool runDueTimers();
+
+    // Сдвиг времени с вызовом всех таймеров по пути
+    void advanceTo(int64_t targetUs);
+
+    // Время без таймеров (назад не идёт)
+    void setNow(int64_t nowUs) {
+        if (nowUs > nowUs_) {
+            nowUs_ = nowUs;
+        }
+    }
+
+private:
+    int64_t nowUs_;
+};
+
+}  // namespace Hal
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+/**
+ * Хостовая замена Arduino.h для сборки HAL_NATIVE.
+ *
+ * Только типы, константы и макросы, которыми пользуются модули. Функций
+ * ядра (millis, pinMode, Serial, ledc*) здесь намеренно нет: модули
+ * обращаются к железу через Hal, и пропущенный прямой вызов виден как
+ * ошибка хостовой сборки.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_attr.h"
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define PULLUP 0x04
+#define INPUT_PULLUP 0x05
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#endif
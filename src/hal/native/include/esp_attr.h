@@ -0,0 +1,8 @@
+#ifndef NATIVE_ESP_ATTR_H
+#define NATIVE_ESP_ATTR_H
+
+// Размещение в IRAM/DRAM на хосте не имеет смысла
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+#endif
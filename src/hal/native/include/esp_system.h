@@ -0,0 +1,16 @@
+#ifndef NATIVE_ESP_SYSTEM_H
+#define NATIVE_ESP_SYSTEM_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Куча хоста не моделируется: MEM показывает нули
+inline uint32_t esp_get_free_heap_size() {
+    return 0;
+}
+
+inline uint32_t esp_get_minimum_free_heap_size() {
+    return 0;
+}
+
+#endif
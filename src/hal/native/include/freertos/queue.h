@@ -0,0 +1,65 @@
+#ifndef NATIVE_QUEUE_H
+#define NATIVE_QUEUE_H
+
+#include <string.h>
+#include "FreeRTOS.h"
+
+// Очередь без блокировок: в однопоточной модели ждать некого, таймауты не используются
+typedef struct {
+    uint8_t* storage;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    UBaseType_t head;
+    UBaseType_t count;
+} StaticQueue_t;
+
+typedef StaticQueue_t* QueueHandle_t;
+
+inline QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t itemSize, uint8_t* storage,
+                                        StaticQueue_t* queue) {
+    queue->storage = storage;
+    queue->length = length;
+    queue->itemSize = itemSize;
+    queue->head = 0;
+    queue->count = 0;
+    return queue;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t timeout) {
+    if (queue->count == queue->length) {
+        return pdFAIL;
+    }
+    UBaseType_t tail = (queue->head + queue->count) % queue->length;
+    memcpy(queue->storage + tail * queue->itemSize, item, queue->itemSize);
+    queue->count++;
+    return pdPASS;
+}
+
+inline BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* woken) {
+    return xQueueSend(queue, item, 0);
+}
+
+inline BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t timeout) {
+    if (queue->count == 0) {
+        return pdFAIL;
+    }
+    memcpy(item, queue->storage + queue->head * queue->itemSize, queue->itemSize);
+    return pdPASS;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t timeout) {
+    if (xQueuePeek(queue, item, timeout) != pdPASS) {
+        return pdFAIL;
+    }
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    return pdPASS;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    return queue->count;
+}
+
+#define xQueueSendToBack xQueueSend
+
+#endif
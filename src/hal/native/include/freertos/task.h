@@ -0,0 +1,96 @@
+#ifndef NATIVE_TASK_H
+#define NATIVE_TASK_H
+
+#include "FreeRTOS.h"
+
+// Задача симулятора: обработчик, который вызывается при ненулевом уведомлении.
+// preempt - задача выше приоритетом, чем уведомивший: выполняется сразу из xTaskNotify
+struct tskTaskControlBlock {
+    const char* name;
+    uint32_t notifyValue;
+    void (*preempt)(tskTaskControlBlock* task);
+};
+
+typedef struct tskTaskControlBlock* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+typedef enum {
+    eNoAction,
+    eSetBits,
+    eIncrement,
+    eSetValueWithOverwrite,
+    eSetValueWithoutOverwrite
+} eNotifyAction;
+
+inline BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    switch (action) {
+        case eSetBits: task->notifyValue |= value; break;
+        case eIncrement: task->notifyValue++; break;
+        case eSetValueWithOverwrite: task->notifyValue = value; break;
+        case eSetValueWithoutOverwrite:
+            if (task->notifyValue) {
+                return pdFAIL;
+            }
+            task->notifyValue = value;
+            break;
+        default: break;
+    }
+    if (task->preempt) {
+        task->preempt(task);
+    }
+    return pdPASS;
+}
+
+inline BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t* woken) {
+    return xTaskNotify(task, value, action);
+}
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    return xTaskNotify(task, 0, eIncrement);
+}
+
+inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken) {
+    xTaskNotify(task, 0, eIncrement);
+}
+
+// Ожидания не блокируют: модуль в симуляторе вызывается, когда у него есть работа
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t timeout) {
+    return 0;
+}
+
+inline BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t* value, TickType_t timeout) {
+    if (value) {
+        *value = 0;
+    }
+    return pdFAIL;
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return nullptr;
+}
+
+// Задачи прошивки на хосте не создаются (Logger::begin и т.п. не вызываются)
+inline TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t function, const char* name, uint32_t stackBytes,
+                                                  void* parameter, UBaseType_t priority, StackType_t* stack,
+                                                  StaticTask_t* tcb, BaseType_t core) {
+    return nullptr;
+}
+
+inline void vTaskDelete(TaskHandle_t task) {
+}
+
+inline void vTaskSuspendAll() {
+}
+
+inline BaseType_t xTaskResumeAll() {
+    return pdFALSE;
+}
+
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return 0;
+}
+
+// Тики от виртуальных часов (src/hal/native/esp_timer_native.cpp)
+TickType_t xTaskGetTickCount();
+
+#endif
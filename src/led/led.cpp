@@ -1,17 +1,18 @@
 #include "led.h"
+#include "../hal/hal.h"
 
 LED::LED(uint8_t pin) : pin_(pin), state_(false) {
 }
 
 void LED::begin() {
-    pinMode(pin_, OUTPUT);
+    Hal::pinMode(pin_, OUTPUT);
     setState(false);
-    Logger::info("LED initialized on pin " + String(pin_));
+    Logger::info("LED initialized on pin %u", pin_);
 }
 
 void LED::setState(bool state) {
     state_ = state;
-    digitalWrite(pin_, state_ ? HIGH : LOW);
+    Hal::digitalWrite(pin_, state_ ? HIGH : LOW);
 }
 
 void LED::toggle() {
@@ -1,62 +1,113 @@
 #include <Arduino.h>
+#include <freertos/timers.h>
+#include "app/app.h"
 #include "button/button.h"
+#include "button/button_bank.h"
 #include "pwm/pwm.h"
+#include "pwm/pwm_actor.h"
+#include "pwm/sequencer.h"
+#include "pwm/closed_loop.h"
 #include "uart/uart.h"
 #include "led/led.h"
 #include "common/config.h"
 #include "common/logger.h"
+#include "common/event_bus.h"
+#include "common/reactor.h"
+#include "common/rtos.h"
+#include "common/stats.h"
+#include "common/trace.h"
+#include "hal/hal.h"
 
 // Глобальные объекты
 Button button(BUTTON_PIN);
+#if BUTTON_BANK_ENABLED
+ButtonBank buttonBank;  // Панель клавиш BUTTON_BANK_PINS, жесты - на шину событий
+#endif
 PWMController pwmController(LED_PWM_PIN);
+PWMActor pwmActor(pwmController);  // Единственный путь изменения ШИМ из задач
+PWMSequencer pwmSequencer(pwmController);  // Воспроизведение загруженных последовательностей по таймеру
+PWMClosedLoop pwmLoop(pwmController, PWM_LOOP_CHANNEL);  // Стабилизация выхода по обратной связи
 UARTCommandHandler uartHandler;
 LED statusLed(LED_STATUS_PIN);
 
-// Очередь FreeRTOS
-QueueHandle_t buttonEventQueue;
+// Подписчик шины, чья очередь читает задача статусного LED
+int8_t ledSubscriber = -1;
+
+// Бит реактора, который выставляет программный таймер мигания LED
+uint32_t ledBlinkBit = 0;
+StaticTimer_t blinkTimerStorage;
+
+/**
+ * БЮДЖЕТ СТАТИЧЕСКОГО ОЗУ RTOS:
+ * стеки и TCB задач из таблицы Rtos::TASK_TABLE, очереди ШИМ и шины событий,
+ * таймер мигания. Превышение RTOS_RAM_BUDGET - ошибка сборки; разбивку по
+ * символам готового образа печатает tools/mem_report.py.
+ */
+constexpr uint32_t RTOS_STATIC_RAM_BYTES = Rtos::RTOS_TASK_RAM_BYTES + PWMActor::STATIC_RAM_BYTES +
+                                           EventBus::STATIC_RAM_BYTES + sizeof(StaticTimer_t);
+static_assert(RTOS_STATIC_RAM_BYTES <= RTOS_RAM_BUDGET, "Static RTOS RAM exceeds RTOS_RAM_BUDGET");
 
 // Прототипы задач
 void buttonTask(void *parameter);
+void keysTask(void *parameter);
 void pwmTask(void *parameter);
 void uartTask(void *parameter);
 void statusLedTask(void *parameter);
+void startTasks();
+void startReactor();
 
 void setup() {
     // Настройка Serial ПЕРВЫМ делом
-    Serial.setRxBufferSize(UART_RX_BUFFER_SIZE);
-    Serial.begin(UART_BAUDRATE);
+    Hal::serial().setRxBufferSize(UART_RX_BUFFER_SIZE);
+    Hal::serial().begin(UART_BAUDRATE);
     delay(1000);
     
+    // Вывод лога идёт из отдельной задачи, вызовы Logger не ждут UART
+    Logger::begin();
     Logger::info("=== SYSTEM STARTING ===");
     
     // Инициализация модулей
     button.begin();
+#if BUTTON_BANK_ENABLED
+    for (uint8_t pin : { BUTTON_BANK_PINS }) {
+        buttonBank.addKey(pin);
+    }
+    buttonBank.begin();
+#endif
     pwmController.begin();
+    pwmActor.begin();
+    pwmSequencer.begin();
+    // Обратная связь по умолчанию - АЦП1, 12 бит -> Q16
+    pwmLoop.begin([]() { return (uint16_t)(Hal::analogRead(PWM_FEEDBACK_PIN) << 4); });
     uartHandler.begin();
     statusLed.begin();
     
-    // UART callbacks
-    uartHandler.setPWMCallback([](uint8_t dutyCycle) {
-        pwmController.setDutyCycle(dutyCycle);
-    });
-    
-    uartHandler.getPWMCallback([]() {
-        return pwmController.getDutyCycle();
-    });
-    
-    // Создание очереди
-    buttonEventQueue = xQueueCreate(10, sizeof(ButtonEvent));
+    // Колбэки UART и действия кнопки - общие с симулятором (src/app/app.cpp)
+#if BUTTON_BANK_ENABLED
+    App::Modules modules = { &button, &buttonBank, &pwmActor, &pwmSequencer, &pwmLoop, &uartHandler };
+#else
+    App::Modules modules = { &button, nullptr, &pwmActor, &pwmSequencer, &pwmLoop, &uartHandler };
+#endif
+    App::wire(modules);
     
-    // Создание задач FreeRTOS
-    xTaskCreate(buttonTask, "Button", 4096, NULL, 3, NULL);
-    xTaskCreate(pwmTask, "PWM", 4096, NULL, 2, NULL);
-    xTaskCreate(uartTask, "UART", 4096, NULL, 2, NULL);
-    xTaskCreate(statusLedTask, "StatusLED", 2048, NULL, 1, NULL);
+#if REACTOR_MODE
+    startReactor();
+#else
+    startTasks();
+#endif
     
-    Logger::info("FreeRTOS tasks started");
     Logger::info("Button commands: single=+, double=0, long=cycle");
-    Logger::info("UART commands: SET PWM X, GET PWM");
-    Logger::info("UART buffer: " + String(UART_RX_BUFFER_SIZE) + " bytes ring buffer");
+    Logger::info("UART commands: SET PWM [CH] X, FADE PWM [CH] X MS, GET PWM, MEM, STATS [RESET], TRACE DUMP|CLEAR|ON|OFF");
+    Logger::info("UART commands: SET PERMILLE [CH] X, SET PWMCFG CH HZ BITS, SET DITHER CH 0|1, SET LOG TEXT|BIN");
+    Logger::info("UART closed loop: SET TARGET PERMILLE|OFF, SET GAINS KP KI KD (milli), GET LOOP");
+    Logger::info("UART sequences: SEQ LOAD [LOOPS]; SEQ KEY CH PERMILLE DELAY_US [STEP|RAMP]; SEQ PLAY|STOP|STATUS");
+    Logger::info("UART telemetry: STREAM DUTY,BUTTON,COUNTERS|ALL HZ [TEXT|BIN], STREAM OFF (tools/telemetry.py)");
+    Logger::info("UART bus: @ADDR|@GROUP|@* CMD, SET ADDRESS N, SET GROUP G 0|1, GET NODE (tools/bus_sim.cpp)");
+    Logger::info("UART batches: CMD; CMD; ... and BEGIN; SET PWM CH X; ...; COMMIT|ABORT");
+    Logger::info("UART binary: 0x00 + COBS frames with CRC16 (tools/pwm_bin.py)");
+    Logger::info("UART buffer: %u bytes ring buffer", UART_RX_BUFFER_SIZE);
+    Logger::info("Static RTOS RAM: %lu of %lu bytes",
+                 (unsigned long)RTOS_STATIC_RAM_BYTES, (unsigned long)RTOS_RAM_BUDGET);
     
     vTaskDelete(NULL);
 }
@@ -65,124 +116,138 @@ void loop() {
     vTaskDelete(NULL);
 }
 
-// Задача 1: Обработка кнопки - ДИАГНОСТИЧЕСКАЯ ВЕРСИЯ
-void buttonTask(void *parameter) {
-    ButtonEvent event;
-    unsigned long lastStateChangeTime = 0;
-    bool lastPhysicalState = HIGH;
+// Отдельная задача на каждый модуль
+void startTasks() {
+    // Действия ШИМ подписаны в App::wire, LED читает жесты своей очередью
+    ledSubscriber = EventBus::subscribe(BUS_EVENT_MASK(BUS_EVENT_BUTTON));
     
-    while (1) {
-        // Прямой мониторинг физического состояния кнопки
-        bool currentPhysicalState = digitalRead(BUTTON_PIN);
-        
-        if (currentPhysicalState != lastPhysicalState) {
-            if (currentPhysicalState == LOW) {
-                Logger::info("=== PHYSICAL BUTTON PRESSED ===");
-            } else {
-                Logger::info("=== PHYSICAL BUTTON RELEASED ===");
-            }
-            lastPhysicalState = currentPhysicalState;
-            lastStateChangeTime = millis();
-        }
-        
-        // Обновление логики кнопки
-        button.update();
-        event = button.getEvent();
-        
-        if (event != EVENT_NONE) {
-            String eventStr;
-            switch (event) {
-                case EVENT_SINGLE_CLICK: eventStr = "SINGLE_CLICK"; break;
-                case EVENT_DOUBLE_CLICK: eventStr = "DOUBLE_CLICK"; break;
-                case EVENT_LONG_PRESS: eventStr = "LONG_PRESS"; break;
-                default: eventStr = "UNKNOWN"; break;
-            }
-            Logger::info(">>> BUTTON EVENT: " + eventStr + " <<<");
-            
-            if (xQueueSend(buttonEventQueue, &event, 0) == pdTRUE) {
-                Logger::info("Event sent to PWM task");
-            }
+    // Задачи из таблицы Rtos::TASK_TABLE; владелец ШИМ выше UART на том же ядре,
+    // поэтому команда применяется до следующей строки UART
+    Rtos::startTask<Rtos::TASK_BUTTON>(buttonTask);
+#if BUTTON_BANK_ENABLED
+    Rtos::startTask<Rtos::TASK_KEYS>(keysTask);
+#endif
+    Rtos::startTask<Rtos::TASK_PWM>(pwmTask);
+    Rtos::startTask<Rtos::TASK_UART>(uartTask);
+    Rtos::startTask<Rtos::TASK_STATUS_LED>(statusLedTask);
+    Logger::info("FreeRTOS tasks started");
+}
+
+/**
+ * РЕЖИМ РЕАКТОРА (REACTOR_MODE):
+ * 1. Модули регистрируют неблокирующие обработчики и получают биты уведомления
+ * 2. Прерывание кнопки, драйвер UART и очередь ШИМ будят задачу реактора своими битами
+ * 3. Мигание LED - программный таймер, клики LED обрабатывает подписчик шины
+ * Одна задача и один стек вместо четырёх, пробуждения - только по событиям и срокам.
+ */
+void startReactor() {
+    EventBus::subscribe(BUS_EVENT_MASK(BUS_EVENT_BUTTON), [](const BusEvent& event) {
+        uint8_t gesture = event.payload.button.event;
+        if (gesture == EVENT_SINGLE_CLICK || gesture == EVENT_DOUBLE_CLICK) {
+            statusLed.toggle();
         }
+    });
+    
+    uint32_t buttonBit = Reactor::add(App::processButton, []() { return button.nextTimeout(); });
+#if BUTTON_BANK_ENABLED
+    uint32_t keysBit = Reactor::add(App::processBank, []() { return buttonBank.nextTimeout(); });
+#endif
+    uint32_t pwmBit = Reactor::add([]() { pwmActor.processNext(0); });
+    uint32_t uartBit = Reactor::add([]() { uartHandler.processCommands(); });
+    ledBlinkBit = Reactor::add([]() { statusLed.toggle(); });
+    if (!Reactor::begin()) {
+        return;
+    }
+    
+    button.notifyTask(Reactor::task(), buttonBit);
+#if BUTTON_BANK_ENABLED
+    buttonBank.notifyTask(Reactor::task(), keysBit);
+#endif
+    pwmActor.notifyTask(Reactor::task(), pwmBit);
+    uartHandler.notifyTask(Reactor::task(), uartBit);
+    
+    TimerHandle_t blinkTimer = xTimerCreateStatic("Blink", pdMS_TO_TICKS(1000), pdTRUE, NULL,
+                                                  [](TimerHandle_t) { Reactor::signal(ledBlinkBit); },
+                                                  &blinkTimerStorage);
+    if (blinkTimer) {
+        xTimerStart(blinkTimer, 0);
+    }
+    
+    // Фронты и байты, пришедшие до назначения битов, разбираются первым проходом
+    Reactor::signal(buttonBit | pwmBit | uartBit);
+}
+
+// Задача 1: Обработка кнопки
+void buttonTask(void *parameter) {
+    while (1) {
+        // Задача спит, пока прерывание не принесёт фронт или не наступит срок жеста
+        button.waitForEdges();
         
-        // Отладочная информация о состоянии
-        static unsigned long lastDebugTime = 0;
-        if (millis() - lastDebugTime > 3000) {
-            Logger::debug("Button state: " + String(button.isPressed() ? "PRESSED" : "RELEASED") +
-                         ", Press time: " + String(millis() - lastStateChangeTime) + "ms");
-            lastDebugTime = millis();
-        }
+        uint32_t startUs = (uint32_t)Hal::nowUs();
+        App::processButton();
+        Stats::taskLoop(Rtos::TASK_BUTTON, (uint32_t)Hal::nowUs() - startUs);
+    }
+}
+
+#if BUTTON_BANK_ENABLED
+// Задача 1а: Панель клавиш - скан по фронтам и с периодом BUTTON_SCAN_MS, пока входы не устоялись
+void keysTask(void *parameter) {
+    while (1) {
+        buttonBank.waitForActivity();
         
-        vTaskDelay(pdMS_TO_TICKS(20));
+        uint32_t startUs = (uint32_t)Hal::nowUs();
+        App::processBank();
+        Stats::taskLoop(Rtos::TASK_KEYS, (uint32_t)Hal::nowUs() - startUs);
     }
 }
+#endif
 
-// Задача 2: Управление ШИМ
+// Задача 2: Владелец ШИМ - выполняет команды кнопки и UART по очереди
 void pwmTask(void *parameter) {
-    ButtonEvent event;
-    bool longPressActive = false;
-    unsigned long lastLongPressTime = 0;
-    
     while (1) {
-        if (xQueueReceive(buttonEventQueue, &event, pdMS_TO_TICKS(50))) {
-            switch (event) {
-                case EVENT_SINGLE_CLICK:
-                    pwmController.increaseDutyCycle();
-                    Logger::info("SINGLE CLICK - PWM: " + String(pwmController.getDutyCycle()) + "%");
-                    longPressActive = false;
-                    statusLed.toggle();
-                    break;
-                    
-                case EVENT_DOUBLE_CLICK:
-                    pwmController.setDutyCycle(0);
-                    Logger::info("DOUBLE CLICK - PWM: 0%");
-                    longPressActive = false;
-                    statusLed.toggle();
-                    break;
-                    
-                case EVENT_LONG_PRESS:
-                    longPressActive = true;
-                    lastLongPressTime = millis();
-                    Logger::info("LONG PRESS STARTED - cyclic PWM change");
-                    // Сразу делаем первое изменение
-                    pwmController.handleLongPress();
-                    lastLongPressTime = millis();
-                    break;
-                    
-                default:
-                    break;
-            }
-        }
-        
-        // Обработка активного длительного нажатия
-        if (longPressActive && button.isPressed()) {
-            if (millis() - lastLongPressTime > PWM_LONG_PRESS_INTERVAL_MS) {
-                pwmController.handleLongPress();
-                lastLongPressTime = millis();
-                Logger::debug("Long press PWM: " + String(pwmController.getDutyCycle()) + "%");
-            }
-        } else if (longPressActive && !button.isPressed()) {
-            // Завершение длительного нажатия
-            longPressActive = false;
-            pwmController.resetLongPressCycle();
-            Logger::info("LONG PRESS ENDED");
-        }
+        // Сон до первой команды не входит во время цикла задачи
+        pwmActor.waitForCommand(portMAX_DELAY);
         
-        vTaskDelay(pdMS_TO_TICKS(50));
+        uint32_t startUs = (uint32_t)Hal::nowUs();
+        pwmActor.processNext(0);
+        Stats::taskLoop(Rtos::TASK_PWM, (uint32_t)Hal::nowUs() - startUs);
     }
 }
 
 // Задача 3: Обработка UART
 void uartTask(void *parameter) {
     while (1) {
+        // Задача спит, пока драйвер UART не сообщит о новых данных
+        uartHandler.waitForData(pdMS_TO_TICKS(UART_IDLE_TIMEOUT_MS));
+        
+        uint32_t startUs = (uint32_t)Hal::nowUs();
         uartHandler.processCommands();
-        vTaskDelay(pdMS_TO_TICKS(100));
+        Stats::taskLoop(Rtos::TASK_UART, (uint32_t)Hal::nowUs() - startUs);
     }
 }
 
 // Задача 4: Мигание статусным LED
 void statusLedTask(void *parameter) {
+    BusEvent event;
+    TickType_t lastBlink = xTaskGetTickCount();
+    
     while (1) {
-        statusLed.toggle();
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        // Ждём клик с шины не дольше, чем до следующего мигания
+        TickType_t elapsed = xTaskGetTickCount() - lastBlink;
+        TickType_t period = pdMS_TO_TICKS(1000);
+        TickType_t timeout = elapsed < period ? period - elapsed : 0;
+        
+        bool received = EventBus::receive(ledSubscriber, event, timeout);
+        uint32_t startUs = (uint32_t)Hal::nowUs();
+        if (received) {
+            uint8_t gesture = event.payload.button.event;
+            if (gesture == EVENT_SINGLE_CLICK || gesture == EVENT_DOUBLE_CLICK) {
+                statusLed.toggle();
+            }
+        } else {
+            statusLed.toggle();
+            lastBlink = xTaskGetTickCount();
+        }
+        Stats::taskLoop(Rtos::TASK_STATUS_LED, (uint32_t)Hal::nowUs() - startUs);
     }
 }
\ No newline at end of file
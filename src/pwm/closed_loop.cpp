@@ -0,0 +1,157 @@
+#include "closed_loop.h"
+#include "../common/stats.h"
+#include "../hal/hal.h"
+
+namespace {
+
+const uint32_t LOOP_PERIOD_US = 1000000UL / PWM_LOOP_RATE_HZ;
+
+}  // namespace
+
+PWMClosedLoop::PWMClosedLoop(PWMController& pwm, uint8_t channel)
+    : pwm_(pwm), channel_(channel), source_(nullptr), timer_(nullptr), enabled_(false), ticking_(false), target_(0),
+      measurement_(0), output_(0), ticks_(0), lastTickUs_(0), periodMinUs_(0), periodMaxUs_(0),
+      busyMaxUs_(0) {
+    mux_ = portMUX_INITIALIZER_UNLOCKED;
+    pid_.setGains(pidGainsFromMilli(PWM_LOOP_KP_MILLI, PWM_LOOP_KI_MILLI, PWM_LOOP_KD_MILLI, PWM_LOOP_RATE_HZ));
+}
+
+bool PWMClosedLoop::begin(FeedbackSource source) {
+    source_ = source;
+
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = &PWMClosedLoop::timerCallback;
+    timerArgs.arg = this;
+    timerArgs.dispatch_method = ESP_TIMER_TASK;
+    timerArgs.name = "pwm_loop";
+    if (esp_timer_create(&timerArgs, &timer_) != ESP_OK) {
+        Logger::error("PWM loop timer creation failed");
+        return false;
+    }
+    Logger::info("PWM closed loop on channel %u: %u Hz", channel_, PWM_LOOP_RATE_HZ);
+    return true;
+}
+
+bool PWMClosedLoop::setTarget(uint16_t target) {
+    if (!timer_ || !source_ || !pwm_.isChannelActive(channel_)) {
+        return false;
+    }
+
+    // Измерение до спинлока: источник может быть медленным (АЦП)
+    uint16_t measurement = source_();
+
+    portENTER_CRITICAL(&mux_);
+    target_ = target;
+    bool start = !enabled_;
+    if (start) {
+        output_ = pwm_.getDuty16(channel_);
+        measurement_ = measurement;
+        pid_.reset(measurement, output_);
+        ticks_ = 0;
+        lastTickUs_ = 0;
+        periodMinUs_ = INT32_MAX;
+        periodMaxUs_ = 0;
+        busyMaxUs_ = 0;
+        enabled_ = true;
+        esp_timer_start_periodic(timer_, LOOP_PERIOD_US);
+    }
+    portEXIT_CRITICAL(&mux_);
+
+    if (start) {
+        Logger::info("PWM closed loop enabled, target %u/65535", target);
+    }
+    return true;
+}
+
+void PWMClosedLoop::disable() {
+    portENTER_CRITICAL(&mux_);
+    bool wasEnabled = enabled_;
+    enabled_ = false;
+    if (timer_) {
+        esp_timer_stop(timer_);
+    }
+    portEXIT_CRITICAL(&mux_);
+
+    // Такт на другом ядре мог пройти проверку до выключения - ждём его запись,
+    // иначе она легла бы поверх команды, пришедшей после SET TARGET OFF.
+    // На том же ядре такт не прерывается: задача esp_timer выше по приоритету
+    while (__atomic_load_n(&ticking_, __ATOMIC_ACQUIRE)) {
+    }
+
+    // Скважность остаётся последней, посчитанной контуром
+    if (wasEnabled) {
+        Logger::info("PWM closed loop disabled at %u/65535", output_);
+    }
+}
+
+void PWMClosedLoop::setGains(uint32_t kpMilli, uint32_t kiMilli, uint32_t kdMilli) {
+    PIDGains gains = pidGainsFromMilli(kpMilli, kiMilli, kdMilli, PWM_LOOP_RATE_HZ);
+    portENTER_CRITICAL(&mux_);
+    pid_.setGains(gains);
+    portEXIT_CRITICAL(&mux_);
+    Logger::info("PWM loop gains: kp %lu ki %lu kd %lu (milli)",
+                 (unsigned long)kpMilli, (unsigned long)kiMilli, (unsigned long)kdMilli);
+}
+
+void PWMClosedLoop::status(ClosedLoopStatus& out) {
+    portENTER_CRITICAL(&mux_);
+    out.enabled = enabled_;
+    out.channel = channel_;
+    out.target = target_;
+    out.measurement = measurement_;
+    out.output = output_;
+    out.saturated = pid_.isSaturated();
+    out.ticks = ticks_;
+    out.periodMinUs = ticks_ > 1 ? periodMinUs_ : 0;
+    out.periodMaxUs = periodMaxUs_;
+    out.busyMaxUs = busyMaxUs_;
+    portEXIT_CRITICAL(&mux_);
+}
+
+void PWMClosedLoop::timerCallback(void* arg) {
+    static_cast<PWMClosedLoop*>(arg)->onTick();
+}
+
+void PWMClosedLoop::onTick() {
+    /**
+     * ТАКТ КОНТУРА (PWM_LOOP_RATE_HZ):
+     * 1. Фактический период от прошлого такта - дрожание таймера
+     * 2. Измерение вне спинлока, ПИД под спинлоком (коэффициенты меняет UART)
+     * 3. Запись в LEDC только при изменении скважности
+     */
+    int64_t startUs = Hal::nowUs();
+    uint16_t measurement = source_();
+
+    portENTER_CRITICAL(&mux_);
+    if (!enabled_) {
+        portEXIT_CRITICAL(&mux_);
+        return;
+    }
+    int32_t periodUs = lastTickUs_ ? (int32_t)(startUs - lastTickUs_) : (int32_t)LOOP_PERIOD_US;
+    if (lastTickUs_) {
+        periodMinUs_ = periodUs < periodMinUs_ ? periodUs : periodMinUs_;
+        periodMaxUs_ = periodUs > periodMaxUs_ ? periodUs : periodMaxUs_;
+    }
+    lastTickUs_ = startUs;
+    ticks_++;
+
+    uint16_t output = (uint16_t)pid_.update(target_, measurement);
+    bool changed = output != output_;
+    measurement_ = measurement;
+    output_ = output;
+    ticking_ = true;
+    portEXIT_CRITICAL(&mux_);
+
+    // Запись без лога: на частоте контура debug-строки переполнили бы очередь лога
+    if (changed) {
+        pwm_.writeDuty16(channel_, output);
+    }
+    __atomic_store_n(&ticking_, false, __ATOMIC_RELEASE);
+
+    int32_t jitter = periodUs - (int32_t)LOOP_PERIOD_US;
+    Stats::record(STAT_HIST_LOOP_JITTER, jitter < 0 ? -jitter : jitter);
+    uint32_t busyUs = (uint32_t)(Hal::nowUs() - startUs);
+    if (busyUs > busyMaxUs_) {
+        busyMaxUs_ = busyUs;
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef CLOSED_LOOP_H
+#define CLOSED_LOOP_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "../common/config.h"
+#include "../common/logger.h"
+#include "pwm.h"
+#include "pid.h"
+
+struct ClosedLoopStatus {
+    bool enabled;
+    uint8_t channel;
+    uint16_t target;             // Q16
+    uint16_t measurement;        // Последнее измерение, Q16
+    uint16_t output;             // Последняя скважность, Q16
+    bool saturated;
+    uint32_t ticks;
+    int32_t periodMinUs;         // Фактический период такта с последнего включения
+    int32_t periodMaxUs;
+    uint32_t busyMaxUs;          // Наибольшее время такта (измерение + ПИД + запись)
+};
+
+/**
+ * Замкнутый контур одного канала ШИМ.
+ *
+ * Периодический esp_timer с частотой PWM_LOOP_RATE_HZ читает обратную
+ * связь, считает целочисленный ПИД (pid.h) и пишет скважность канала.
+ * Источник обратной связи подключаемый: функция, возвращающая измерение
+ * в Q16 (АЦП, внешний датчик, модель).
+ *
+ * Таймер работает, только пока контур включён (setTarget). Как и переходы,
+ * запись идёт из задачи esp_timer мимо очереди PWMActor, поэтому на время
+ * работы контура канал принадлежит ему: прошивка резервирует канал в
+ * PWMActor (reserveChannels), и ручные команды на нём отвергаются.
+ */
+class PWMClosedLoop {
+public:
+    typedef uint16_t (*FeedbackSource)();
+
+    PWMClosedLoop(PWMController& pwm, uint8_t channel);
+    bool begin(FeedbackSource source);
+
+    // Задание в Q16; первое включение - безударное, от текущей скважности
+    bool setTarget(uint16_t target);
+    void disable();  // Возвращается после записи уже идущего такта: дальше канал не трогается
+    void setGains(uint32_t kpMilli, uint32_t kiMilli, uint32_t kdMilli);
+    void status(ClosedLoopStatus& out);
+
+private:
+    PWMController& pwm_;
+    uint8_t channel_;
+    FeedbackSource source_;
+    PIDController pid_;
+    esp_timer_handle_t timer_;
+    portMUX_TYPE mux_;
+    bool enabled_;
+    volatile bool ticking_;      // Такт прошёл проверку enabled_ и ещё не записал скважность
+    uint16_t target_;
+    uint16_t measurement_;
+    uint16_t output_;
+    uint32_t ticks_;
+    int64_t lastTickUs_;
+    int32_t periodMinUs_;
+    int32_t periodMaxUs_;
+    uint32_t busyMaxUs_;
+
+    void onTick();
+    static void timerCallback(void* arg);
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef DUTY_TABLE_H
+#define DUTY_TABLE_H
+
+#include <stdint.h>
+
+/**
+ * Таблицы перевода процентов и промилле в 16-битную скважность (Q16, 65535 = 100%).
+ * Строятся компилятором, поэтому путь записи обходится без деления:
+ * дальше отсчёты LEDC получаются сдвигом под разрешение канала.
+ */
+template <uint16_t Scale>
+struct DutyTable {
+    uint16_t values[Scale + 1];
+};
+
+template <uint16_t Scale>
+constexpr DutyTable<Scale> makeDutyTable() {
+    DutyTable<Scale> table{};
+    for (uint32_t i = 0; i <= Scale; i++) {
+        table.values[i] = (uint16_t)((i * 65535UL + Scale / 2) / Scale);
+    }
+    return table;
+}
+
+constexpr DutyTable<100> DUTY_FROM_PERCENT = makeDutyTable<100>();
+constexpr DutyTable<1000> DUTY_FROM_PERMILLE = makeDutyTable<1000>();
+
+static_assert(DUTY_FROM_PERCENT.values[100] == 65535, "Percent table must end at full scale");
+static_assert(DUTY_FROM_PERMILLE.values[1000] == 65535, "Permille table must end at full scale");
+
+// Обратный перевод для отчётов: умножение и сдвиг с округлением
+inline uint8_t dutyToPercent(uint16_t duty) {
+    return (uint8_t)(((uint32_t)duty * 100 + 32767) >> 16);
+}
+
+inline uint16_t dutyToPermille(uint16_t duty) {
+    return (uint16_t)(((uint32_t)duty * 1000 + 32767) >> 16);
+}
+
+#endif
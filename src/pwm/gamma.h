@@ -0,0 +1,52 @@
+#ifndef GAMMA_H
+#define GAMMA_H
+
+#include <stdint.h>
+#include "../common/config.h"
+
+/**
+ * Перцептивная кривая яркости (CIE 1931 L* -> относительная яркость Y).
+ * Таблица строится компилятором и лежит во flash: индекс - равномерный шаг
+ * воспринимаемой яркости, значение - доля скважности в формате Q16 (0..65535).
+ */
+struct GammaTable {
+    uint16_t values[PWM_GAMMA_STEPS];
+};
+
+constexpr GammaTable makeGammaTable() {
+    GammaTable table{};
+    for (uint32_t i = 0; i < PWM_GAMMA_STEPS; i++) {
+        double lightness = 100.0 * i / (PWM_GAMMA_STEPS - 1);
+        double luminance = 0.0;
+        if (lightness <= 8.0) {
+            luminance = lightness / 903.3;
+        } else {
+            double t = (lightness + 16.0) / 116.0;
+            luminance = t * t * t;
+        }
+        table.values[i] = (uint16_t)(luminance * 65535.0 + 0.5);
+    }
+    return table;
+}
+
+constexpr GammaTable GAMMA_TABLE = makeGammaTable();
+
+static_assert(GAMMA_TABLE.values[0] == 0, "Gamma table must start at 0");
+static_assert(GAMMA_TABLE.values[PWM_GAMMA_STEPS - 1] == 65535, "Gamma table must end at full scale");
+
+// Обратный поиск: ближайший индекс таблицы для доли Q16 (двоичный поиск, без деления)
+inline uint16_t gammaIndexForFraction(uint16_t fraction) {
+    uint16_t low = 0;
+    uint16_t high = PWM_GAMMA_STEPS - 1;
+    while (low < high) {
+        uint16_t mid = (low + high) >> 1;
+        if (GAMMA_TABLE.values[mid] < fraction) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+#endif
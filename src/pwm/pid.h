@@ -0,0 +1,114 @@
+#ifndef PID_H
+#define PID_H
+
+#include <stdint.h>
+
+// Коэффициенты на один такт регулятора, Q16.16
+struct PIDGains {
+    int32_t kp;
+    int32_t ki;
+    int32_t kd;
+};
+
+/**
+ * Перевод коэффициентов из тысячных (Ki - в 1/с, Kd - в с) в такты частоты rateHz.
+ * Деления выполняются здесь, при настройке, а не в такте регулятора.
+ */
+inline PIDGains pidGainsFromMilli(uint32_t kpMilli, uint32_t kiMilli, uint32_t kdMilli, uint32_t rateHz) {
+    PIDGains gains;
+    gains.kp = (int32_t)(((int64_t)kpMilli << 16) / 1000);
+    gains.ki = (int32_t)(((int64_t)kiMilli << 16) / (1000LL * rateHz));
+    gains.kd = (int32_t)((((int64_t)kdMilli << 16) * rateHz) / 1000);
+    return gains;
+}
+
+/**
+ * Целочисленный ПИД-регулятор без плавающей точки.
+ *
+ * Задание, измерение и выход - в единицах Q16 (0-65535 = 0-100%).
+ * Произведения считаются в int64, в такте только умножения, сложения
+ * и сдвиги. Дифференциальная часть берётся по измерению, поэтому смена
+ * задания не даёт броска выхода.
+ *
+ * Защита от насыщения интегратора: приращение интеграла принимается,
+ * только если выход не упёрт в ограничение или ошибка уводит от него;
+ * сам интеграл тоже не выходит за пределы выхода.
+ *
+ * Заголовок не зависит от Arduino: тот же код считает модель на хосте
+ * (tools/pid_sim.cpp).
+ */
+class PIDController {
+public:
+    PIDController() : integral_(0), previous_(0), outputMin_(0), outputMax_(65535), saturated_(false) {
+        gains_.kp = 0;
+        gains_.ki = 0;
+        gains_.kd = 0;
+    }
+
+    void setGains(const PIDGains& gains) {
+        gains_ = gains;
+    }
+
+    const PIDGains& gains() const {
+        return gains_;
+    }
+
+    void setOutputLimits(int32_t minimum, int32_t maximum) {
+        outputMin_ = minimum;
+        outputMax_ = maximum;
+    }
+
+    // Безударное включение: интеграл принимает текущий выход
+    void reset(int32_t measurement, int32_t output) {
+        integral_ = (int64_t)clamp(output) << 16;
+        previous_ = measurement;
+        saturated_ = false;
+    }
+
+    int32_t update(int32_t setpoint, int32_t measurement) {
+        int32_t error = setpoint - measurement;
+        int64_t proportional = (int64_t)gains_.kp * error;
+        int64_t derivative = -(int64_t)gains_.kd * (measurement - previous_);
+        int64_t integral = integral_ + (int64_t)gains_.ki * error;
+        previous_ = measurement;
+
+        int64_t lowLimit = (int64_t)outputMin_ << 16;
+        int64_t highLimit = (int64_t)outputMax_ << 16;
+        if (integral > highLimit) {
+            integral = highLimit;
+        } else if (integral < lowLimit) {
+            integral = lowLimit;
+        }
+
+        int64_t output = proportional + integral + derivative;
+        saturated_ = output > highLimit || output < lowLimit;
+        if (!saturated_ || (output > highLimit && error < 0) || (output < lowLimit && error > 0)) {
+            integral_ = integral;
+        }
+        if (output > highLimit) {
+            return outputMax_;
+        }
+        if (output < lowLimit) {
+            return outputMin_;
+        }
+        return (int32_t)(output >> 16);
+    }
+
+    bool isSaturated() const {
+        return saturated_;
+    }
+
+private:
+    PIDGains gains_;
+    int64_t integral_;          // Q16.16 в единицах выхода
+    int32_t previous_;          // Предыдущее измерение для дифференциальной части
+    int32_t outputMin_;
+    int32_t outputMax_;
+    bool saturated_;
+
+    int32_t clamp(int32_t value) const {
+        return value < outputMin_ ? outputMin_ : (value > outputMax_ ? outputMax_ : value);
+    }
+};
+
+#endif
@@ -1,89 +1,474 @@
 #include "pwm.h"
+#include "gamma.h"
+#include "duty_table.h"
+#include "../hal/hal.h"
 
-PWMController::PWMController(uint8_t pin) : pin_(pin), dutyCycle_(0), 
-                                           increasing_(true), lastLongPressTime_(0) {
+PWMController::PWMController(uint8_t pin) : activeFades_(0), ditherChannels_(0),
+                                           outputCallback_(nullptr), outputArg_(nullptr),
+                                           tickTimer_(nullptr), tickTimerRunning_(false),
+                                           initialized_(false),
+                                           increasing_(true) {
+    memset(channels_, 0, sizeof(channels_));
+    memset(outputs_, 0, sizeof(outputs_));
+    tickMux_ = portMUX_INITIALIZER_UNLOCKED;
+    addChannel(0, pin);
+}
+
+bool PWMController::isValidTiming(uint32_t frequency, uint8_t resolution) const {
+    if (resolution == 0 || resolution > PWM_MAX_RESOLUTION || frequency == 0) {
+        return false;
+    }
+    // Счётчик таймера тактируется от APB: частота * 2^разрешение не больше 80 МГц
+    return ((uint64_t)frequency << resolution) <= PWM_LEDC_CLOCK_HZ;
+}
+
+bool PWMController::addChannel(uint8_t channel, uint8_t pin, uint32_t frequency, uint8_t resolution) {
+    if (channel >= PWM_MAX_CHANNELS || !isValidTiming(frequency, resolution)) {
+        return false;
+    }
+
+    /**
+     * Arduino-ядро привязывает каналы 2n и 2n+1 к одному таймеру LEDC,
+     * поэтому частота и разрешение у пары должны совпадать.
+     */
+    const Channel& pair = channels_[channel ^ 1];
+    if (pair.active && (pair.frequency != frequency || pair.resolution != resolution)) {
+        Logger::error("PWM channel %u conflicts with timer of channel %u", channel, channel ^ 1);
+        return false;
+    }
+
+    Channel& ch = channels_[channel];
+    ch.pin = pin;
+    ch.frequency = frequency;
+    ch.resolution = resolution;
+    ch.duty = 0;
+    ch.dithering = false;
+    ch.active = true;
+
+    // Каналы, добавленные после begin(), настраиваются сразу
+    if (initialized_) {
+        setupChannel(channel);
+    }
+    return true;
 }
 
 void PWMController::begin() {
-    // Настройка ШИМ для ESP32
-    ledcSetup(0, 5000, 8);      // Канал 0, частота 5kHz, разрешение 8 бит
-    ledcAttachPin(pin_, 0);     // Привязка пина к каналу 0
-    setDutyCycle(0);            // Инициализация с 0%
-    Logger::info("PWM initialized on pin " + String(pin_));
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = &PWMController::tickTimerCallback;
+    timerArgs.arg = this;
+    timerArgs.dispatch_method = ESP_TIMER_TASK;
+    timerArgs.name = "pwm_tick";
+    if (esp_timer_create(&timerArgs, &tickTimer_) != ESP_OK) {
+        Logger::error("PWM tick timer creation failed");
+    }
+
+    for (uint8_t channel = 0; channel < PWM_MAX_CHANNELS; channel++) {
+        if (channels_[channel].active) {
+            setupChannel(channel);
+        }
+    }
+    initialized_ = true;
+}
+
+void PWMController::setupChannel(uint8_t channel) {
+    Channel& ch = channels_[channel];
+    Hal::ledcSetup(channel, ch.frequency, ch.resolution);
+    Hal::ledcAttachPin(ch.pin, channel);
+    updatePWM(channel, 0);
+    Logger::info("PWM channel %u initialized on pin %u (%lu Hz, %u bit)",
+                 channel, ch.pin, (unsigned long)ch.frequency, ch.resolution);
+}
+
+bool PWMController::configureChannel(uint8_t channel, uint32_t frequency, uint8_t resolution) {
+    if (!isChannelActive(channel) || !isValidTiming(frequency, resolution)) {
+        return false;
+    }
+
+    if (Hal::ledcSetup(channel, frequency, resolution) == 0) {
+        Logger::error("PWM channel %u: LEDC rejected %lu Hz", channel, (unsigned long)frequency);
+        return false;
+    }
+
+    // Таймер общий для пары, поэтому перенастраиваем оба канала
+    uint8_t pairChannels[2] = { (uint8_t)(channel & ~1), (uint8_t)(channel | 1) };
+    for (uint8_t i = 0; i < 2; i++) {
+        uint8_t ch = pairChannels[i];
+        if (!channels_[ch].active) {
+            continue;
+        }
+        channels_[ch].frequency = frequency;
+        channels_[ch].resolution = resolution;
+
+        portENTER_CRITICAL(&tickMux_);
+        Output& out = outputs_[ch];
+        out.ditherError = 0;
+        out.lastCounts = levelToCounts(ch, out.level, &out.ditherError);
+        writeCountsLocked(ch, out.lastCounts);
+        refreshDitherMaskLocked(ch);
+        updateTickTimerLocked();
+        portEXIT_CRITICAL(&tickMux_);
+    }
+
+    Logger::info("PWM channel %u reconfigured: %lu Hz, %u bit", channel, (unsigned long)frequency, resolution);
+    return true;
+}
+
+bool PWMController::setDithering(uint8_t channel, bool enabled) {
+    if (!isChannelActive(channel)) {
+        return false;
+    }
+
+    portENTER_CRITICAL(&tickMux_);
+    channels_[channel].dithering = enabled;
+    outputs_[channel].ditherError = 0;
+    refreshDitherMaskLocked(channel);
+    updateTickTimerLocked();
+    portEXIT_CRITICAL(&tickMux_);
+
+    Logger::info("PWM channel %u dithering %s", channel, enabled ? "on" : "off");
+    return true;
 }
 
 void PWMController::setDutyCycle(uint8_t dutyCycle) {
+    setDutyCycle(0, dutyCycle);
+}
+
+uint8_t PWMController::getDutyCycle() const {
+    return getDutyCycle(0);
+}
+
+bool PWMController::setDutyCycle(uint8_t channel, uint8_t dutyCycle) {
+    if (!isChannelActive(channel)) {
+        return false;
+    }
+
     if (dutyCycle > PWM_MAX) {
         dutyCycle = PWM_MAX;
     }
-    
-    dutyCycle_ = dutyCycle;
-    updatePWM();
-    Logger::info("PWM set to " + String(dutyCycle_) + "%");
+
+    updatePWM(channel, DUTY_FROM_PERCENT.values[dutyCycle]);
+    Logger::info("PWM[%u] set to %u%%", channel, dutyCycle);
+    return true;
 }
 
-uint8_t PWMController::getDutyCycle() const {
-    return dutyCycle_;
+uint8_t PWMController::getDutyCycle(uint8_t channel) const {
+    return isChannelActive(channel) ? dutyToPercent(channels_[channel].duty) : 0;
 }
 
-void PWMController::increaseDutyCycle() {
-    if (dutyCycle_ < PWM_MAX) {
-        dutyCycle_ += PWM_STEP;
-        if (dutyCycle_ > PWM_MAX) {
-            dutyCycle_ = PWM_MAX;
+bool PWMController::setDutyPermille(uint8_t channel, uint16_t permille) {
+    if (!isChannelActive(channel)) {
+        return false;
+    }
+
+    if (permille > 1000) {
+        permille = 1000;
+    }
+
+    updatePWM(channel, DUTY_FROM_PERMILLE.values[permille]);
+    Logger::info("PWM[%u] set to %u permille", channel, permille);
+    return true;
+}
+
+bool PWMController::setDuty16(uint8_t channel, uint16_t duty) {
+    if (!writeDuty16(channel, duty)) {
+        return false;
+    }
+    Logger::debug("PWM[%u] set to %u/65535", channel, duty);
+    return true;
+}
+
+bool PWMController::writeDuty16(uint8_t channel, uint16_t duty) {
+    if (!isChannelActive(channel)) {
+        return false;
+    }
+
+    updatePWM(channel, duty);
+    return true;
+}
+
+uint16_t PWMController::getDuty16(uint8_t channel) const {
+    return isChannelActive(channel) ? channels_[channel].duty : 0;
+}
+
+bool PWMController::isChannelActive(uint8_t channel) const {
+    return channel < PWM_MAX_CHANNELS && channels_[channel].active;
+}
+
+bool PWMController::applyBatch(const PWMDutyUpdate* updates, uint8_t count) {
+    // Пакет применяется целиком или не применяется вовсе
+    for (uint8_t i = 0; i < count; i++) {
+        if (!isChannelActive(updates[i].channel)) {
+            Logger::error("PWM batch rejected: channel %u is not active", updates[i].channel);
+            return false;
         }
-        updatePWM();
-        Logger::info("PWM increased to " + String(dutyCycle_) + "%");
     }
+
+    /**
+     * СТРАТЕГИЯ ПАКЕТНОГО ОБНОВЛЕНИЯ:
+     * 1. Записываем новые значения во все регистры скважности (Hal::ledcSetDuty)
+     * 2. Под спинлоком тика подаём Hal::ledcUpdateDuty на все каналы подряд:
+     *    ни другая задача, ни тик таймера на втором ядре не вклинятся
+     * 3. Аппаратура защёлкивает значение на границе периода, поэтому каналы
+     *    переключаются в одном периоде ШИМ без промежуточных состояний
+     */
+    portENTER_CRITICAL(&tickMux_);
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t channel = updates[i].channel;
+        uint8_t dutyCycle = updates[i].dutyCycle > PWM_MAX ? PWM_MAX : updates[i].dutyCycle;
+        uint32_t counts = prepareDutyLocked(channel, DUTY_FROM_PERCENT.values[dutyCycle]);
+        Hal::ledcSetDuty(channel, counts);
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        Hal::ledcUpdateDuty(updates[i].channel);
+    }
+    updateTickTimerLocked();
+    portEXIT_CRITICAL(&tickMux_);
+    notifyOutputChange(false);
+
+    Logger::info("PWM batch applied to %u channels", count);
+    return true;
 }
 
-void PWMController::decreaseDutyCycle() {
-    if (dutyCycle_ > PWM_MIN) {
-        dutyCycle_ -= PWM_STEP;
-        if (dutyCycle_ < PWM_MIN) {
-            dutyCycle_ = PWM_MIN;
+void PWMController::increaseDutyCycle() {
+    uint8_t dutyCycle = getDutyCycle(0);
+    if (dutyCycle < PWM_MAX) {
+        dutyCycle += PWM_STEP;
+        if (dutyCycle > PWM_MAX) {
+            dutyCycle = PWM_MAX;
         }
-        updatePWM();
-        Logger::info("PWM decreased to " + String(dutyCycle_) + "%");
+        updatePWM(0, DUTY_FROM_PERCENT.values[dutyCycle]);
+        Logger::info("PWM increased to %u%%", dutyCycle);
     }
 }
 
-void PWMController::handleLongPress() {
-    unsigned long currentTime = millis();
-    
-    if ((currentTime - lastLongPressTime_) >= PWM_LONG_PRESS_INTERVAL_MS) {
-        cycleDutyCycle();
-        lastLongPressTime_ = currentTime;
+void PWMController::decreaseDutyCycle() {
+    uint8_t dutyCycle = getDutyCycle(0);
+    if (dutyCycle > PWM_MIN) {
+        dutyCycle = dutyCycle > PWM_MIN + PWM_STEP ? dutyCycle - PWM_STEP : PWM_MIN;
+        updatePWM(0, DUTY_FROM_PERCENT.values[dutyCycle]);
+        Logger::info("PWM decreased to %u%%", dutyCycle);
     }
 }
 
-void PWMController::cycleDutyCycle() {
+void PWMController::cycleDutyCycle(uint32_t stepMs) {
+    uint8_t target = getDutyCycle(0);
     if (increasing_) {
-        if (dutyCycle_ < PWM_MAX) {
-            dutyCycle_ += PWM_STEP;
+        if (target < PWM_MAX) {
+            target += PWM_STEP;
         } else {
             increasing_ = false;
-            dutyCycle_ -= PWM_STEP;
+            target -= PWM_STEP;
         }
     } else {
-        if (dutyCycle_ > PWM_MIN) {
-            dutyCycle_ -= PWM_STEP;
+        if (target > PWM_MIN) {
+            target -= PWM_STEP;
         } else {
             increasing_ = true;
-            dutyCycle_ += PWM_STEP;
+            target += PWM_STEP;
         }
     }
-    
-    updatePWM();
-    Logger::debug("Cyclic PWM: " + String(dutyCycle_) + "%");
+
+    // Шаг растягивается до следующего автоповтора, чтобы цикл шёл без видимых ступенек
+    fadeTo(0, target, stepMs);
+    Logger::debug("Cyclic PWM: %u%%", target);
 }
 
 void PWMController::resetLongPressCycle() {
     increasing_ = true;
-    lastLongPressTime_ = 0;
 }
 
-void PWMController::updatePWM() {
-    uint32_t pwmValue = (dutyCycle_ * 255) / 100;
-    ledcWrite(0, pwmValue);
-}
\ No newline at end of file
+bool PWMController::fadeTo(uint8_t channel, uint8_t dutyCycle, uint32_t durationMs) {
+    if (!isChannelActive(channel) || !tickTimer_) {
+        return false;
+    }
+
+    if (dutyCycle > PWM_MAX) {
+        dutyCycle = PWM_MAX;
+    }
+    if (durationMs > PWM_FADE_MAX_MS) {
+        durationMs = PWM_FADE_MAX_MS;
+    }
+
+    fadeDuty16(channel, DUTY_FROM_PERCENT.values[dutyCycle], durationMs * 1000UL);
+    Logger::debug("PWM[%u] fading to %u%% in %lu ms", channel, dutyCycle, (unsigned long)durationMs);
+    return true;
+}
+
+bool PWMController::fadeDuty16(uint8_t channel, uint16_t targetDuty, uint32_t durationUs) {
+    if (!isChannelActive(channel) || !tickTimer_) {
+        return false;
+    }
+
+    uint32_t ticks = durationUs / PWM_TICK_US;
+    if (ticks == 0) {
+        updatePWM(channel, targetDuty);
+        return true;
+    }
+
+    /**
+     * Все деления выполняются один раз здесь. В тике таймера остаются
+     * только сложение, сдвиг и чтение из таблицы.
+     */
+    int32_t targetPosition = (int32_t)gammaIndexForFraction(targetDuty) << 16;
+
+    portENTER_CRITICAL(&tickMux_);
+    Output& out = outputs_[channel];
+    if (!(activeFades_ & (1U << channel))) {
+        // Старт с текущего выхода канала
+        out.fadePosition = (int32_t)gammaIndexForFraction(out.level) << 16;
+    }
+    out.fadeStep = (targetPosition - out.fadePosition) / (int32_t)ticks;
+    out.fadeTicksLeft = ticks;
+    channels_[channel].duty = targetDuty;
+    activeFades_ |= (1U << channel);
+    updateTickTimerLocked();
+    portEXIT_CRITICAL(&tickMux_);
+    notifyOutputChange(false);
+    return true;
+}
+
+bool PWMController::isFading(uint8_t channel) const {
+    return channel < PWM_MAX_CHANNELS && (activeFades_ & (1U << channel));
+}
+
+void PWMController::onOutputChange(void (*callback)(void*, bool), void* arg) {
+    outputArg_ = arg;
+    outputCallback_ = callback;
+}
+
+void PWMController::notifyOutputChange(bool frequent) {
+    if (outputCallback_) {
+        outputCallback_(outputArg_, frequent);
+    }
+}
+
+uint32_t PWMController::prepareDutyLocked(uint8_t channel, uint16_t duty) {
+    // Новое значение отменяет переход и сбрасывает ошибку дизеринга
+    activeFades_ &= ~(1U << channel);
+    channels_[channel].duty = duty;
+    Output& out = outputs_[channel];
+    out.level = duty;
+    out.ditherError = 0;
+    out.lastCounts = levelToCounts(channel, duty, &out.ditherError);
+    refreshDitherMaskLocked(channel);
+    return out.lastCounts;
+}
+
+void PWMController::refreshDitherMaskLocked(uint8_t channel) {
+    const Channel& ch = channels_[channel];
+    uint16_t level = outputs_[channel].level;
+    uint8_t shift = 16 - ch.resolution;
+    uint8_t ditherBits = shift < PWM_DITHER_BITS ? shift : PWM_DITHER_BITS;
+    uint16_t fraction = (level >> (shift - ditherBits)) & ((1U << ditherBits) - 1);
+
+    // Таймер нужен только каналам, у которых есть дробная часть
+    if (ch.dithering && fraction != 0 && level != 65535) {
+        ditherChannels_ |= (1U << channel);
+    } else {
+        ditherChannels_ &= ~(1U << channel);
+    }
+}
+
+void PWMController::updateTickTimerLocked() {
+    // Таймер работает только пока есть переходы или дизеринг
+    bool needed = (activeFades_ | ditherChannels_) != 0;
+    if (!tickTimer_ || needed == tickTimerRunning_) {
+        return;
+    }
+    if (needed) {
+        esp_timer_start_periodic(tickTimer_, PWM_TICK_US);
+    } else {
+        esp_timer_stop(tickTimer_);
+    }
+    tickTimerRunning_ = needed;
+}
+
+void PWMController::tickTimerCallback(void* arg) {
+    static_cast<PWMController*>(arg)->onTick();
+}
+
+void PWMController::onTick() {
+    /**
+     * ТИК ТАЙМЕРА (PWM_TICK_US):
+     * 1. Под спинлоком продвигаем переходы и дизеринг активных каналов
+     * 2. Уровень перехода берём из гамма-таблицы, отсчёты - сдвигом под разрешение
+     * 3. В LEDC пишем под тем же спинлоком и только изменившиеся значения:
+     *    иначе запись задачи с другого ядра между расчётом и записью тика
+     *    оказалась бы затёрта устаревшим значением перехода
+     * 4. О завершившихся переходах сообщаем уже после выхода из спинлока
+     */
+    bool finished = false;
+    portENTER_CRITICAL(&tickMux_);
+    uint16_t mask = activeFades_ | ditherChannels_;
+    while (mask) {
+        uint8_t channel = __builtin_ctz(mask);
+        mask &= mask - 1;
+
+        Output& out = outputs_[channel];
+        if (activeFades_ & (1U << channel)) {
+            if (--out.fadeTicksLeft == 0) {
+                // Финал перехода - точное значение установленной скважности
+                out.level = channels_[channel].duty;
+                activeFades_ &= ~(1U << channel);
+                finished = true;
+            } else {
+                out.fadePosition += out.fadeStep;
+                out.level = GAMMA_TABLE.values[out.fadePosition >> 16];
+            }
+            refreshDitherMaskLocked(channel);
+        }
+
+        uint32_t value = levelToCounts(channel, out.level, &out.ditherError);
+        if (value != out.lastCounts) {
+            out.lastCounts = value;
+            writeCountsLocked(channel, value);
+        }
+    }
+    updateTickTimerLocked();
+    portEXIT_CRITICAL(&tickMux_);
+
+    if (finished) {
+        notifyOutputChange(false);
+    }
+}
+
+uint32_t PWMController::levelToCounts(uint8_t channel, uint16_t level, uint16_t* ditherError) const {
+    const Channel& ch = channels_[channel];
+    uint8_t shift = 16 - ch.resolution;
+
+    // 100% - постоянный высокий уровень, а не период с одним пропущенным отсчётом
+    if (level == 65535) {
+        return 1UL << ch.resolution;
+    }
+    if (shift == 0) {
+        return level;
+    }
+
+    uint32_t counts = level >> shift;
+    if (ch.dithering) {
+        // Сигма-дельта: дробная часть копится, перенос добавляет один отсчёт
+        uint8_t ditherBits = shift < PWM_DITHER_BITS ? shift : PWM_DITHER_BITS;
+        uint16_t fraction = (level >> (shift - ditherBits)) & ((1U << ditherBits) - 1);
+        uint16_t accumulator = *ditherError + fraction;
+        counts += accumulator >> ditherBits;
+        *ditherError = accumulator & ((1U << ditherBits) - 1);
+    } else if (level & (1U << (shift - 1))) {
+        counts++;  // Округление до ближайшего отсчёта
+    }
+    return counts;
+}
+
+void PWMController::writeCountsLocked(uint8_t channel, uint32_t counts) {
+    // Только регистры LEDC под собственным спинлоком драйвера - без блокировок и логов
+    Hal::ledcSetDuty(channel, counts);
+    Hal::ledcUpdateDuty(channel);
+}
+
+void PWMController::updatePWM(uint8_t channel, uint16_t duty) {
+    // Расчёт и запись - одно целое для всех писателей (задачи, тик таймера)
+    portENTER_CRITICAL(&tickMux_);
+    writeCountsLocked(channel, prepareDutyLocked(channel, duty));
+    updateTickTimerLocked();
+    portEXIT_CRITICAL(&tickMux_);
+    notifyOutputChange(true);
+}
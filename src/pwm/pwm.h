@@ -2,28 +2,100 @@
 #define PWM_H
 
 #include <Arduino.h>
+#include <esp_timer.h>
 #include "../common/config.h"
 #include "../common/logger.h"
 
+// Изменение скважности одного канала в составе пакета
+struct PWMDutyUpdate {
+    uint8_t channel;
+    uint8_t dutyCycle;
+};
+
 class PWMController {
 public:
-    PWMController(uint8_t pin);
+    PWMController(uint8_t pin);  // Пин канала 0
+    bool addChannel(uint8_t channel, uint8_t pin,
+                    uint32_t frequency = PWM_DEFAULT_FREQUENCY,
+                    uint8_t resolution = PWM_DEFAULT_RESOLUTION);
     void begin();
+
+    // Одноканальный API (работает с каналом 0)
     void setDutyCycle(uint8_t dutyCycle);
     uint8_t getDutyCycle() const;
     void increaseDutyCycle();
     void decreaseDutyCycle();
-    void handleLongPress();
     void resetLongPressCycle();
-    void cycleDutyCycle();
+    void cycleDutyCycle(uint32_t stepMs = PWM_LONG_PRESS_INTERVAL_MS);
+
+    // Многоканальный API
+    bool setDutyCycle(uint8_t channel, uint8_t dutyCycle);
+    uint8_t getDutyCycle(uint8_t channel) const;
+    bool applyBatch(const PWMDutyUpdate* updates, uint8_t count);
+    bool isChannelActive(uint8_t channel) const;
+
+    // Точная скважность: промилле (0-1000) или Q16 (0-65535)
+    bool setDutyPermille(uint8_t channel, uint16_t permille);
+    bool setDuty16(uint8_t channel, uint16_t duty);
+    bool writeDuty16(uint8_t channel, uint16_t duty);  // Без лога: для частых тактов контура
+    uint16_t getDuty16(uint8_t channel) const;
+
+    // Частота и разрешение во время работы (общие для пары каналов 2n/2n+1)
+    bool configureChannel(uint8_t channel, uint32_t frequency, uint8_t resolution);
+    bool isValidTiming(uint32_t frequency, uint8_t resolution) const;
+    bool setDithering(uint8_t channel, bool enabled);
+
+    // Плавный переход по перцептивной кривой, шаги выполняет аппаратный таймер
+    bool fadeTo(uint8_t channel, uint8_t dutyCycle, uint32_t durationMs);
+    bool fadeDuty16(uint8_t channel, uint16_t duty, uint32_t durationUs);
+    bool isFading(uint8_t channel) const;
+    // Скважность или выход изменились - вызов вне спинлока в контексте писателя:
+    // задачи, таймера перехода, секвенсора или контура. frequent - одиночная
+    // запись (до 1 кГц от контура), false - переход начат или закончен, пакет
+    void onOutputChange(void (*callback)(void* arg, bool frequent), void* arg);
 
 private:
-    uint8_t pin_;
-    uint8_t dutyCycle_;
+    struct Channel {
+        uint8_t pin;
+        uint32_t frequency;
+        uint8_t resolution;
+        uint16_t duty;          // Установленная скважность Q16
+        bool active;
+        bool dithering;
+    };
+
+    // Состояние выхода, которое продвигает таймер
+    struct Output {
+        int32_t fadePosition;   // Позиция в гамма-таблице в формате Q16
+        int32_t fadeStep;
+        uint32_t fadeTicksLeft;
+        uint16_t level;         // Текущий выход Q16 (с учётом перехода)
+        uint16_t ditherError;   // Накопленная ошибка сигма-дельта
+        uint32_t lastCounts;
+    };
+
+    Channel channels_[PWM_MAX_CHANNELS];
+    Output outputs_[PWM_MAX_CHANNELS];
+    volatile uint16_t activeFades_;     // Битовая маска каналов с активным переходом
+    volatile uint16_t ditherChannels_;  // Битовая маска каналов с дробной частью под дизеринг
+    portMUX_TYPE tickMux_;
+    void (*outputCallback_)(void*, bool);
+    void* outputArg_;
+    esp_timer_handle_t tickTimer_;
+    bool tickTimerRunning_;
+    bool initialized_;
     bool increasing_;
-    unsigned long lastLongPressTime_;
-    
-    void updatePWM();
+
+    void setupChannel(uint8_t channel);
+    uint32_t prepareDutyLocked(uint8_t channel, uint16_t duty);
+    void refreshDitherMaskLocked(uint8_t channel);
+    void updateTickTimerLocked();
+    void onTick();
+    static void tickTimerCallback(void* arg);
+    uint32_t levelToCounts(uint8_t channel, uint16_t level, uint16_t* ditherError) const;
+    void writeCountsLocked(uint8_t channel, uint32_t counts);
+    void updatePWM(uint8_t channel, uint16_t duty);
+    void notifyOutputChange(bool frequent);
 };
 
-#endif
\ No newline at end of file
+#endif
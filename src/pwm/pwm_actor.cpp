@@ -0,0 +1,390 @@
+#include "pwm_actor.h"
+#include "duty_table.h"
+#include "../common/event_bus.h"
+#include "../common/stats.h"
+#include "../hal/hal.h"
+
+namespace {
+
+inline uint32_t nowUs() {
+    return (uint32_t)Hal::nowUs();
+}
+
+}  // namespace
+
+PWMActor::QueueStorage PWMActor::queueStorage_;
+
+PWMActor::PWMActor(PWMController& pwm)
+    : pwm_(pwm), queue_(nullptr), notifyTask_(nullptr), notifyBits_(0), version_(0), dropped_(0), reserved_(0),
+      refreshPending_(false), refreshArmed_(false), refreshTimer_(nullptr), applied_(0), rejected_(0), lastLatencyUs_(0), maxLatencyUs_(0) {
+    memset(snapshots_, 0, sizeof(snapshots_));
+}
+
+bool PWMActor::begin() {
+    queue_ = queueStorage_.create();
+    if (!queue_) {
+        Logger::error("PWM command queue creation failed");
+        return false;
+    }
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = &PWMActor::refreshTimerCallback;
+    timerArgs.arg = this;
+    timerArgs.dispatch_method = ESP_TIMER_TASK;
+    timerArgs.name = "pwm_snapshot";
+    if (esp_timer_create(&timerArgs, &refreshTimer_) != ESP_OK) {
+        Logger::error("PWM snapshot timer creation failed");
+        return false;
+    }
+    pwm_.onOutputChange(outputChanged, this);
+    publishSnapshot();
+    return true;
+}
+
+void PWMActor::outputChanged(void* arg, bool frequent) {
+    PWMActor* actor = static_cast<PWMActor*>(arg);
+    if (!frequent) {
+        actor->requestRefresh();
+        return;
+    }
+    // Частые записи копятся до срабатывания таймера: одно обновление на период
+    if (actor->refreshTimer_ && !__atomic_exchange_n(&actor->refreshArmed_, true, __ATOMIC_ACQ_REL)) {
+        esp_timer_start_once(actor->refreshTimer_, PWM_SNAPSHOT_PERIOD_MS * 1000ULL);
+    }
+}
+
+void PWMActor::refreshTimerCallback(void* arg) {
+    // Флаг снимается до запроса: запись после него взведёт таймер заново
+    PWMActor* actor = static_cast<PWMActor*>(arg);
+    __atomic_store_n(&actor->refreshArmed_, false, __ATOMIC_RELEASE);
+    actor->requestRefresh();
+}
+
+void PWMActor::requestRefresh() {
+    // Один ожидающий запрос на все изменения до его выполнения.
+    // Запрос от команды самого владельца уходит в той же пачке
+    if (!queue_ || __atomic_exchange_n(&refreshPending_, true, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+    PWMCommand command;
+    command.type = PWM_CMD_REFRESH;
+    command.channel = 0;
+    command.enqueuedUs = nowUs();
+    command.originUs = command.enqueuedUs;
+    command.traceId = 0;
+    if (xQueueSend(queue_, &command, 0) != pdTRUE) {
+        // Очередь полна - снимок и так обновится после уже стоящих в ней команд
+        __atomic_store_n(&refreshPending_, false, __ATOMIC_RELEASE);
+        return;
+    }
+    if (notifyTask_) {
+        xTaskNotify(notifyTask_, notifyBits_, eSetBits);
+    }
+}
+
+bool PWMActor::setDutyCycle(uint8_t channel, uint8_t dutyCycle, TraceOrigin origin) {
+    if (!accepts(channel)) {
+        return false;
+    }
+    PWMCommand command;
+    command.type = PWM_CMD_SET_PERCENT;
+    command.channel = channel;
+    command.value = dutyCycle;
+    return post(command, origin);
+}
+
+bool PWMActor::setDutyPermille(uint8_t channel, uint16_t permille, TraceOrigin origin) {
+    if (!accepts(channel)) {
+        return false;
+    }
+    PWMCommand command;
+    command.type = PWM_CMD_SET_PERMILLE;
+    command.channel = channel;
+    command.value = permille;
+    return post(command, origin);
+}
+
+bool PWMActor::setDuty16(uint8_t channel, uint16_t duty, TraceOrigin origin) {
+    if (!accepts(channel)) {
+        return false;
+    }
+    PWMCommand command;
+    command.type = PWM_CMD_SET_DUTY16;
+    command.channel = channel;
+    command.value = duty;
+    return post(command, origin);
+}
+
+bool PWMActor::fadeTo(uint8_t channel, uint8_t dutyCycle, uint32_t durationMs, TraceOrigin origin) {
+    if (!accepts(channel)) {
+        return false;
+    }
+    PWMCommand command;
+    command.type = PWM_CMD_FADE;
+    command.channel = channel;
+    command.value = dutyCycle;
+    command.arg = durationMs;
+    return post(command, origin);
+}
+
+bool PWMActor::configureChannel(uint8_t channel, uint32_t frequency, uint8_t resolution, TraceOrigin origin) {
+    if (!pwm_.isChannelActive(channel) || !pwm_.isValidTiming(frequency, resolution)) {
+        return false;
+    }
+    PWMCommand command;
+    command.type = PWM_CMD_CONFIGURE;
+    command.channel = channel;
+    command.value = frequency;
+    command.arg = resolution;
+    return post(command, origin);
+}
+
+bool PWMActor::setDithering(uint8_t channel, bool enabled, TraceOrigin origin) {
+    if (!pwm_.isChannelActive(channel)) {
+        return false;
+    }
+    PWMCommand command;
+    command.type = PWM_CMD_DITHER;
+    command.channel = channel;
+    command.value = enabled;
+    return post(command, origin);
+}
+
+bool PWMActor::applyBatch(const PWMDutyUpdate* updates, uint8_t count, TraceOrigin origin) {
+    if (count > PWM_MAX_CHANNELS) {
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        if (!accepts(updates[i].channel)) {
+            return false;
+        }
+    }
+    PWMCommand command;
+    command.type = PWM_CMD_BATCH;
+    command.channel = 0;
+    command.count = count;
+    memcpy(command.batch, updates, count * sizeof(PWMDutyUpdate));
+    return post(command, origin);
+}
+
+bool PWMActor::increaseDutyCycle(TraceOrigin origin) {
+    if (isReserved(0)) {
+        return false;
+    }
+    PWMCommand command;
+    command.type = PWM_CMD_INCREASE;
+    command.channel = 0;
+    return post(command, origin);
+}
+
+bool PWMActor::cycleDutyCycle(uint32_t stepMs, TraceOrigin origin) {
+    if (isReserved(0)) {
+        return false;
+    }
+    PWMCommand command;
+    command.type = PWM_CMD_HOLD_STEP;
+    command.channel = 0;
+    command.value = stepMs ? stepMs : PWM_LONG_PRESS_INTERVAL_MS;
+    return post(command, origin);
+}
+
+bool PWMActor::resetLongPressCycle(TraceOrigin origin) {
+    PWMCommand command;
+    command.type = PWM_CMD_HOLD_END;
+    command.channel = 0;
+    return post(command, origin);
+}
+
+void PWMActor::reserveChannels(uint16_t mask) {
+    __atomic_store_n(&reserved_, mask, __ATOMIC_RELAXED);
+}
+
+bool PWMActor::isReserved(uint8_t channel) const {
+    return channel < PWM_MAX_CHANNELS && (reservedChannels() & (1U << channel));
+}
+
+uint16_t PWMActor::reservedChannels() const {
+    return __atomic_load_n(&reserved_, __ATOMIC_RELAXED);
+}
+
+bool PWMActor::accepts(uint8_t channel) const {
+    return pwm_.isChannelActive(channel) && !isReserved(channel);
+}
+
+bool PWMActor::post(PWMCommand& command, TraceOrigin origin) {
+    command.enqueuedUs = nowUs();
+    command.originUs = origin.timeUs ? origin.timeUs : command.enqueuedUs;
+    command.traceId = origin.id;
+    
+    // Производитель не ждёт владельца: при полной очереди команда теряется и считается
+    if (!queue_ || xQueueSend(queue_, &command, 0) != pdTRUE) {
+        __atomic_fetch_add(&dropped_, 1, __ATOMIC_RELAXED);
+        Stats::add(STAT_PWM_DROPPED);
+        Logger::error("PWM command queue full, command %u dropped", command.type);
+        return false;
+    }
+    Stats::gauge(STAT_GAUGE_PWM_QUEUE, uxQueueMessagesWaiting(queue_));
+    Trace::markAt(TRACE_QUEUE_SEND, command.traceId, command.enqueuedUs, command.type);
+    if (notifyTask_) {
+        xTaskNotify(notifyTask_, notifyBits_, eSetBits);
+    }
+    return true;
+}
+
+void PWMActor::notifyTask(TaskHandle_t task, uint32_t bits) {
+    notifyBits_ = bits;
+    notifyTask_ = task;
+}
+
+void PWMActor::waitForCommand(TickType_t timeout) {
+    PWMCommand command;
+    xQueuePeek(queue_, &command, timeout);
+}
+
+bool PWMActor::processNext(TickType_t timeout) {
+    PWMCommand command;
+    if (xQueueReceive(queue_, &command, timeout) != pdTRUE) {
+        return false;
+    }
+    
+    // Накопившиеся команды выполняются подряд, снимок публикуется один раз на пачку
+    do {
+        if (command.type == PWM_CMD_REFRESH) {
+            // Не команда пользователя: хватит публикации снимка ниже
+            __atomic_store_n(&refreshPending_, false, __ATOMIC_RELEASE);
+            continue;
+        }
+        Trace::mark(TRACE_QUEUE_RECEIVE, command.traceId, command.type);
+        if (apply(command)) {
+            Trace::mark(TRACE_PWM_APPLY, command.traceId, command.channel);
+            applied_++;
+            publishChange(command);
+            Stats::add(STAT_PWM_APPLIED);
+        } else {
+            rejected_++;
+        }
+        
+        uint32_t now = nowUs();
+        Stats::record(STAT_HIST_COMMAND_APPLY, now - command.originUs);
+        uint32_t latency = now - command.enqueuedUs;
+        lastLatencyUs_ = latency;
+        if (latency > maxLatencyUs_) {
+            maxLatencyUs_ = latency;
+        }
+    } while (xQueueReceive(queue_, &command, 0) == pdTRUE);
+    
+    publishSnapshot();
+    return true;
+}
+
+bool PWMActor::apply(const PWMCommand& command) {
+    // Команда встала в очередь до резервирования канала - контур её перекрыл бы
+    if (command.type == PWM_CMD_BATCH) {
+        for (uint8_t i = 0; i < command.count; i++) {
+            if (isReserved(command.batch[i].channel)) {
+                return false;
+            }
+        }
+    } else if (command.type != PWM_CMD_CONFIGURE && command.type != PWM_CMD_DITHER &&
+               command.type != PWM_CMD_HOLD_END && isReserved(command.channel)) {
+        return false;
+    }
+    
+    switch (command.type) {
+        case PWM_CMD_SET_PERCENT:
+            return pwm_.setDutyCycle(command.channel, (uint8_t)command.value);
+        case PWM_CMD_SET_PERMILLE:
+            return pwm_.setDutyPermille(command.channel, (uint16_t)command.value);
+        case PWM_CMD_SET_DUTY16:
+            return pwm_.setDuty16(command.channel, (uint16_t)command.value);
+        case PWM_CMD_FADE:
+            return pwm_.fadeTo(command.channel, (uint8_t)command.value, command.arg);
+        case PWM_CMD_CONFIGURE:
+            return pwm_.configureChannel(command.channel, command.value, (uint8_t)command.arg);
+        case PWM_CMD_DITHER:
+            return pwm_.setDithering(command.channel, command.value != 0);
+        case PWM_CMD_BATCH:
+            return pwm_.applyBatch(command.batch, command.count);
+        case PWM_CMD_INCREASE:
+            pwm_.increaseDutyCycle();
+            return true;
+        case PWM_CMD_HOLD_STEP:
+            pwm_.cycleDutyCycle(command.value);
+            return true;
+        case PWM_CMD_HOLD_END:
+            pwm_.resetLongPressCycle();
+            return true;
+        default:
+            return false;
+    }
+}
+
+void PWMActor::publishChange(const PWMCommand& command) {
+    if (command.type == PWM_CMD_CONFIGURE || command.type == PWM_CMD_DITHER) {
+        return;  // Скважность не менялась
+    }
+    BusEvent event = {};
+    event.type = BUS_EVENT_PWM;
+    event.timeUs = nowUs();
+    
+    if (command.type == PWM_CMD_BATCH) {
+        for (uint8_t i = 0; i < command.count; i++) {
+            event.source = command.batch[i].channel;
+            event.payload.pwm.duty16 = pwm_.getDuty16(event.source);
+            EventBus::publish(event);
+        }
+    } else {
+        event.source = command.channel;
+        event.payload.pwm.duty16 = pwm_.getDuty16(command.channel);
+        EventBus::publish(event);
+    }
+}
+
+void PWMActor::publishSnapshot() {
+    /**
+     * ПУБЛИКАЦИЯ СНИМКА:
+     * 1. Заполняем буфер, который сейчас не читают (противоположной чётности)
+     * 2. Барьер, затем увеличиваем версию - буфер становится актуальным
+     * Пишет только владелец, поэтому писатели между собой не синхронизируются.
+     */
+    uint32_t version = version_ + 1;
+    PWMSnapshot& next = snapshots_[version & 1];
+    
+    next.activeMask = 0;
+    next.fadingMask = 0;
+    for (uint8_t channel = 0; channel < PWM_MAX_CHANNELS; channel++) {
+        next.duty16[channel] = pwm_.getDuty16(channel);
+        if (pwm_.isChannelActive(channel)) {
+            next.activeMask |= 1U << channel;
+        }
+        if (pwm_.isFading(channel)) {
+            next.fadingMask |= 1U << channel;
+        }
+    }
+    next.applied = applied_;
+    next.rejected = rejected_;
+    next.lastLatencyUs = lastLatencyUs_;
+    next.maxLatencyUs = maxLatencyUs_;
+    
+    __atomic_store_n(&version_, version, __ATOMIC_RELEASE);
+}
+
+void PWMActor::snapshot(PWMSnapshot& out) const {
+    // Повтор только если за время копирования владелец успел выпустить новый снимок
+    uint32_t version;
+    do {
+        version = __atomic_load_n(&version_, __ATOMIC_ACQUIRE);
+        out = snapshots_[version & 1];
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&version_, __ATOMIC_RELAXED) != version);
+    
+    out.dropped = __atomic_load_n(&dropped_, __ATOMIC_RELAXED);
+}
+
+uint8_t PWMActor::getDutyCycle(uint8_t channel) const {
+    if (channel >= PWM_MAX_CHANNELS) {
+        return 0;
+    }
+    PWMSnapshot current;
+    snapshot(current);
+    return dutyToPercent(current.duty16[channel]);
+}
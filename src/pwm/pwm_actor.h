@@ -0,0 +1,139 @@
+#ifndef PWM_ACTOR_H
+#define PWM_ACTOR_H
+
+#include <Arduino.h>
+#include "../common/config.h"
+#include "../common/logger.h"
+#include "pwm.h"
+#include "../common/rtos.h"
+#include "../common/trace.h"
+#include <esp_timer.h>
+
+enum PWMCommandType : uint8_t {
+    PWM_CMD_SET_PERCENT,
+    PWM_CMD_SET_PERMILLE,
+    PWM_CMD_SET_DUTY16,
+    PWM_CMD_FADE,
+    PWM_CMD_CONFIGURE,
+    PWM_CMD_DITHER,
+    PWM_CMD_BATCH,
+    PWM_CMD_INCREASE,        // Шаг вверх по кнопке (канал 0)
+    PWM_CMD_HOLD_STEP,       // Шаг циклического изменения при удержании, value - длительность шага, мс
+    PWM_CMD_HOLD_END,        // Сброс направления цикла
+    PWM_CMD_REFRESH          // Выход изменён мимо очереди или переход закончен: только снимок
+};
+
+// Команда задаче-владельцу ШИМ, копируется в очередь по значению
+struct PWMCommand {
+    PWMCommandType type;
+    uint8_t channel;
+    uint8_t count;                           // Число записей batch для PWM_CMD_BATCH
+    uint32_t value;                          // Скважность, промилле, частота или флаг
+    uint32_t arg;                            // Длительность перехода или разрешение
+    uint32_t enqueuedUs;                     // Момент постановки в очередь
+    uint32_t originUs;                       // Момент приёма исходной команды
+    uint16_t traceId;                        // Корреляционный ID трассы, 0 - без трассы
+    PWMDutyUpdate batch[PWM_MAX_CHANNELS];
+};
+
+// Согласованный срез состояния ШИМ для чтения из любой задачи
+struct PWMSnapshot {
+    uint16_t duty16[PWM_MAX_CHANNELS];       // Целевая скважность Q16
+    uint16_t activeMask;
+    uint16_t fadingMask;                     // Каналы с незавершённым переходом
+    uint32_t applied;                        // Выполнено команд
+    uint32_t rejected;                       // Отвергнуто контроллером при выполнении
+    uint32_t dropped;                        // Не поместилось в очередь
+    uint32_t lastLatencyUs;                  // Очередь -> применение, последняя команда
+    uint32_t maxLatencyUs;
+};
+
+/**
+ * Единственный владелец PWMController.
+ *
+ * Задачи кнопки и UART не трогают контроллер напрямую: методы ниже проверяют
+ * аргументы, ставят типизированную команду в очередь FreeRTOS и сразу
+ * возвращаются. Команды выполняет одна задача (processNext), поэтому
+ * порядок изменений детерминирован, а состояние контроллера (скважность,
+ * направление цикла удержания) не рвётся без мьютексов.
+ *
+ * Чтение идёт из снимка: владелец после каждой пачки команд пишет его в
+ * свободный из двух буферов и переключает счётчик версии. Изменения мимо
+ * очереди ставят в очередь запрос обновления, не больше одного ожидающего
+ * за раз: начало и конец перехода - сразу, частые записи контура и кадры
+ * секвенсора - однократным таймером через PWM_SNAPSHOT_PERIOD_MS, так что
+ * контур на 1 кГц будит владельца не чаще 1000 / PWM_SNAPSHOT_PERIOD_MS раз в
+ * секунду, а последняя запись всё равно попадает в снимок. Читатель
+ * никогда не ждёт писателя и повторяет копирование, только если за время
+ * чтения вышел новый снимок.
+ *
+ * false из методов-производителей означает неверные аргументы, канал,
+ * зарезервированный за другим писателем (замкнутый контур), или полную
+ * очередь; ошибку самого LEDC владелец пишет в лог и в счётчик rejected.
+ */
+class PWMActor {
+public:
+    typedef Rtos::StaticQueue<PWMCommand, PWM_COMMAND_QUEUE_SIZE> QueueStorage;
+    static constexpr uint32_t STATIC_RAM_BYTES = sizeof(QueueStorage);
+    
+    explicit PWMActor(PWMController& pwm);
+    bool begin();
+    
+    // Производители: можно вызывать из любой задачи. origin - момент приёма
+    // исходной команды или жеста (0 - момент вызова) и ID её трассы
+    bool setDutyCycle(uint8_t channel, uint8_t dutyCycle, TraceOrigin origin = TraceOrigin());
+    bool setDutyPermille(uint8_t channel, uint16_t permille, TraceOrigin origin = TraceOrigin());
+    bool setDuty16(uint8_t channel, uint16_t duty, TraceOrigin origin = TraceOrigin());
+    bool fadeTo(uint8_t channel, uint8_t dutyCycle, uint32_t durationMs, TraceOrigin origin = TraceOrigin());
+    bool configureChannel(uint8_t channel, uint32_t frequency, uint8_t resolution, TraceOrigin origin = TraceOrigin());
+    bool setDithering(uint8_t channel, bool enabled, TraceOrigin origin = TraceOrigin());
+    bool applyBatch(const PWMDutyUpdate* updates, uint8_t count, TraceOrigin origin = TraceOrigin());
+    bool increaseDutyCycle(TraceOrigin origin = TraceOrigin());
+    bool cycleDutyCycle(uint32_t stepMs, TraceOrigin origin = TraceOrigin());  // 0 - PWM_LONG_PRESS_INTERVAL_MS
+    bool resetLongPressCycle(TraceOrigin origin = TraceOrigin());
+    
+    // Владелец: выполняет команды до опустошения очереди, false по таймауту
+    bool processNext(TickType_t timeout);
+    void waitForCommand(TickType_t timeout);  // Сон до появления команды, очередь не трогает
+    
+    // Владелец без собственной задачи: каждая команда выставляет ему биты (eSetBits)
+    void notifyTask(TaskHandle_t task, uint32_t bits);
+    
+    // Каналы, которые пишет кто-то помимо очереди (контур): скважность на них не меняется
+    void reserveChannels(uint16_t mask);
+    bool isReserved(uint8_t channel) const;
+    uint16_t reservedChannels() const;
+    
+    // Чтение из снимка, без блокировок
+    void snapshot(PWMSnapshot& out) const;
+    uint8_t getDutyCycle(uint8_t channel = 0) const;
+
+private:
+    PWMController& pwm_;
+    static QueueStorage queueStorage_;   // Один владелец ШИМ на прошивку
+    QueueHandle_t queue_;
+    TaskHandle_t notifyTask_;
+    uint32_t notifyBits_;
+    PWMSnapshot snapshots_[2];
+    volatile uint32_t version_;      // Чётность - индекс актуального буфера
+    volatile uint32_t dropped_;
+    volatile uint16_t reserved_;
+    volatile bool refreshPending_;   // PWM_CMD_REFRESH уже в очереди
+    volatile bool refreshArmed_;     // Таймер отложенного обновления взведён
+    esp_timer_handle_t refreshTimer_;
+    uint32_t applied_;
+    uint32_t rejected_;
+    uint32_t lastLatencyUs_;
+    uint32_t maxLatencyUs_;
+    
+    bool accepts(uint8_t channel) const;  // Канал активен и не зарезервирован
+    bool post(PWMCommand& command, TraceOrigin origin);
+    bool apply(const PWMCommand& command);
+    void publishChange(const PWMCommand& command);  // BUS_EVENT_PWM на шину событий
+    void publishSnapshot();
+    void requestRefresh();
+    static void outputChanged(void* arg, bool frequent);  // Из контекста любого писателя PWMController
+    static void refreshTimerCallback(void* arg);
+};
+
+#endif
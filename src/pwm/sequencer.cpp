@@ -0,0 +1,210 @@
+#include "sequencer.h"
+#include "../hal/hal.h"
+
+PWMSequencer::PWMSequencer(PWMController& pwm)
+    : pwm_(pwm), count_(0), position_(0), loops_(0), loopsDone_(0), periodUs_(0), maxLateUs_(0),
+      nextUs_(0), playing_(false), timer_(nullptr) {
+    memset(keys_, 0, sizeof(keys_));
+    mux_ = portMUX_INITIALIZER_UNLOCKED;
+}
+
+bool PWMSequencer::begin() {
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = &PWMSequencer::timerCallback;
+    timerArgs.arg = this;
+    timerArgs.dispatch_method = ESP_TIMER_TASK;
+    timerArgs.name = "pwm_seq";
+    if (esp_timer_create(&timerArgs, &timer_) != ESP_OK) {
+        Logger::error("PWM sequence timer creation failed");
+        return false;
+    }
+    return true;
+}
+
+bool PWMSequencer::load(uint16_t loops) {
+    portENTER_CRITICAL(&mux_);
+    bool accepted = !playing_;
+    if (accepted) {
+        count_ = 0;
+        position_ = 0;
+        loops_ = loops;
+        periodUs_ = 0;
+    }
+    portEXIT_CRITICAL(&mux_);
+    return accepted;
+}
+
+bool PWMSequencer::addKey(const SequenceKey& key) {
+    if (!pwm_.isChannelActive(key.channel) || key.mode > SEQ_MODE_RAMP) {
+        return false;
+    }
+
+    portENTER_CRITICAL(&mux_);
+    bool accepted = !playing_ && count_ < PWM_SEQ_MAX_KEYS && key.delayUs <= UINT32_MAX - periodUs_;
+    if (accepted && key.delayUs == 0 && count_ > 0) {
+        // В группе не больше кадра на канал: срабатывание копирует группу на стек
+        // из PWM_MAX_CHANNELS кадров, а два кадра одного канала в один момент бессмысленны
+        uint8_t first = count_ - 1;
+        while (first > 0 && keys_[first].delayUs == 0) {
+            first--;
+        }
+        for (uint8_t i = first; accepted && i < count_; i++) {
+            accepted = keys_[i].channel != key.channel;
+        }
+    }
+    if (accepted) {
+        keys_[count_++] = key;
+        periodUs_ += key.delayUs;
+    }
+    portEXIT_CRITICAL(&mux_);
+    return accepted;
+}
+
+bool PWMSequencer::play() {
+    SequenceKey ramps[PWM_MAX_CHANNELS];
+    uint8_t rampCount = 0;
+
+    portENTER_CRITICAL(&mux_);
+    // Нулевой период зациклил бы таймер без пауз
+    bool valid = timer_ && count_ > 0 && periodUs_ > 0;
+    if (valid) {
+        if (playing_) {
+            esp_timer_stop(timer_);
+        }
+        int64_t now = Hal::nowUs();
+        position_ = 0;
+        loopsDone_ = 0;
+        maxLateUs_ = 0;
+        playing_ = true;
+        nextUs_ = now + keys_[0].delayUs;
+        startRampsLocked(0, ramps, rampCount);
+        armLocked(now);
+    }
+    portEXIT_CRITICAL(&mux_);
+
+    if (!valid) {
+        return false;
+    }
+    for (uint8_t i = 0; i < rampCount; i++) {
+        pwm_.fadeDuty16(ramps[i].channel, ramps[i].duty, ramps[i].delayUs);
+    }
+    Logger::info("PWM sequence: %u keys, period %lu us, loops %u", count_, (unsigned long)periodUs_, loops_);
+    return true;
+}
+
+void PWMSequencer::stop() {
+    portENTER_CRITICAL(&mux_);
+    playing_ = false;
+    if (timer_) {
+        esp_timer_stop(timer_);
+    }
+    portEXIT_CRITICAL(&mux_);
+}
+
+void PWMSequencer::status(SequenceStatus& out) {
+    portENTER_CRITICAL(&mux_);
+    out.playing = playing_;
+    out.keys = count_;
+    out.position = position_;
+    out.loops = loops_;
+    out.loopsDone = loopsDone_;
+    out.periodUs = periodUs_;
+    out.maxLateUs = maxLateUs_;
+    portEXIT_CRITICAL(&mux_);
+}
+
+uint16_t PWMSequencer::channelMask() {
+    uint16_t mask = 0;
+    portENTER_CRITICAL(&mux_);
+    for (uint8_t i = 0; i < count_; i++) {
+        mask |= 1U << keys_[i].channel;
+    }
+    portEXIT_CRITICAL(&mux_);
+    return mask;
+}
+
+uint8_t PWMSequencer::groupEnd(uint8_t first) const {
+    uint8_t end = first + 1;
+    while (end < count_ && keys_[end].delayUs == 0) {
+        end++;
+    }
+    return end;
+}
+
+void PWMSequencer::startRampsLocked(uint8_t first, SequenceKey* ramps, uint8_t& rampCount) const {
+    // Переходы к группе first стартуют сейчас и заканчиваются к её сроку (nextUs_)
+    uint8_t end = groupEnd(first);
+    for (uint8_t i = first; i < end; i++) {
+        if (keys_[i].mode == SEQ_MODE_RAMP) {
+            ramps[rampCount] = keys_[i];
+            ramps[rampCount].delayUs = keys_[first].delayUs;
+            rampCount++;
+        }
+    }
+}
+
+void PWMSequencer::armLocked(int64_t now) {
+    // Срок абсолютный: опоздание одного срабатывания не сдвигает следующие
+    int64_t wait = nextUs_ - now;
+    esp_timer_start_once(timer_, wait > 0 ? (uint64_t)wait : 0);
+}
+
+void PWMSequencer::timerCallback(void* arg) {
+    static_cast<PWMSequencer*>(arg)->onTimer();
+}
+
+void PWMSequencer::onTimer() {
+    /**
+     * СРАБАТЫВАНИЕ ТАЙМЕРА:
+     * 1. Под спинлоком копируем текущую группу кадров и переходы к следующей
+     * 2. Сдвигаем абсолютный срок и взводим таймер до записи в LEDC
+     * 3. Вне спинлока пишем точные значения группы и запускаем переходы
+     * stop() под тем же спинлоком снимает playing_, поэтому таймер после
+     * остановки не перевзводится.
+     */
+    SequenceKey group[PWM_MAX_CHANNELS];
+    SequenceKey ramps[PWM_MAX_CHANNELS];
+    uint8_t groupCount = 0;
+    uint8_t rampCount = 0;
+    bool finished = false;
+    int64_t now = Hal::nowUs();
+
+    portENTER_CRITICAL(&mux_);
+    if (!playing_) {
+        portEXIT_CRITICAL(&mux_);
+        return;
+    }
+    if (now > nextUs_ && (uint32_t)(now - nextUs_) > maxLateUs_) {
+        maxLateUs_ = (uint32_t)(now - nextUs_);
+    }
+
+    uint8_t end = groupEnd(position_);
+    for (uint8_t i = position_; i < end; i++) {
+        group[groupCount++] = keys_[i];
+    }
+    if (end >= count_) {
+        end = 0;
+        loopsDone_++;
+        finished = loops_ != 0 && loopsDone_ >= loops_;
+    }
+
+    if (finished) {
+        playing_ = false;
+    } else {
+        position_ = end;
+        nextUs_ += keys_[end].delayUs;
+        startRampsLocked(end, ramps, rampCount);
+        armLocked(now);
+    }
+    portEXIT_CRITICAL(&mux_);
+
+    for (uint8_t i = 0; i < groupCount; i++) {
+        pwm_.writeDuty16(group[i].channel, group[i].duty);
+    }
+    for (uint8_t i = 0; i < rampCount; i++) {
+        pwm_.fadeDuty16(ramps[i].channel, ramps[i].duty, ramps[i].delayUs);
+    }
+    if (finished) {
+        Logger::info("PWM sequence finished after %u loops", loopsDone_);
+    }
+}
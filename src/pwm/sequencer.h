@@ -0,0 +1,91 @@
+#ifndef SEQUENCER_H
+#define SEQUENCER_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "../common/config.h"
+#include "../common/logger.h"
+#include "pwm.h"
+
+enum SequenceMode : uint8_t {
+    SEQ_MODE_STEP,           // Скачок в момент кадра
+    SEQ_MODE_RAMP            // Плавный переход от предыдущего кадра (перцептивная кривая)
+};
+
+// Ключевой кадр: через delayUs после предыдущего кадра канал достигает duty
+struct SequenceKey {
+    uint32_t delayUs;        // 0 - одновременно с предыдущим кадром
+    uint16_t duty;           // Скважность Q16
+    uint8_t channel;
+    SequenceMode mode;
+};
+
+struct SequenceStatus {
+    bool playing;
+    uint8_t keys;
+    uint8_t position;        // Следующая группа кадров
+    uint16_t loops;          // Число повторов, 0 - бесконечно
+    uint16_t loopsDone;
+    uint32_t periodUs;       // Длительность одного прохода
+    uint32_t maxLateUs;      // Наибольшее опоздание срабатывания таймера
+};
+
+/**
+ * Проигрыватель последовательностей ключевых кадров.
+ *
+ * Последовательность загружается один раз (load + addKey), дальше её
+ * воспроизводит таймер esp_timer без участия хоста и задач прошивки.
+ * Срабатывание планируется на абсолютное время следующей группы кадров,
+ * поэтому ошибка не накапливается от шага к шагу. Кадры с нулевой задержкой
+ * образуют группу и применяются одним срабатыванием.
+ *
+ * STEP пишется в LEDC в момент кадра. RAMP запускает переход контроллера
+ * в момент предыдущей группы, а в момент кадра значение выставляется точно.
+ * После последней группы воспроизведение повторяется с первой: задержка
+ * первого кадра отсчитывается от последнего.
+ *
+ * Как и переходы PWMController, кадры пишутся из задачи esp_timer, минуя
+ * очередь PWMActor. Ручные команды на тех же каналах действуют до
+ * следующего кадра; снимок PWMActor последовательность не обновляет.
+ * Каналы, зарезервированные за контуром, последовательности не отдаются:
+ * это проверяют связи в App (SEQ KEY, SEQ PLAY, SET TARGET).
+ */
+class PWMSequencer {
+public:
+    static_assert(PWM_SEQ_MAX_KEYS <= 255, "Key positions are 8-bit");
+
+    explicit PWMSequencer(PWMController& pwm);
+    bool begin();
+
+    // Загрузка: новая последовательность на loops проходов (0 - бесконечно).
+    // Во время воспроизведения отвергается
+    bool load(uint16_t loops);
+    bool addKey(const SequenceKey& key);
+
+    bool play();
+    void stop();
+    void status(SequenceStatus& out);
+    uint16_t channelMask();          // Каналы кадров загруженной последовательности
+
+private:
+    PWMController& pwm_;
+    SequenceKey keys_[PWM_SEQ_MAX_KEYS];
+    uint8_t count_;
+    uint8_t position_;
+    uint16_t loops_;
+    uint16_t loopsDone_;
+    uint32_t periodUs_;
+    uint32_t maxLateUs_;
+    int64_t nextUs_;                 // Абсолютное время следующей группы
+    bool playing_;
+    portMUX_TYPE mux_;
+    esp_timer_handle_t timer_;
+
+    uint8_t groupEnd(uint8_t first) const;
+    void startRampsLocked(uint8_t first, SequenceKey* ramps, uint8_t& rampCount) const;
+    void armLocked(int64_t now);
+    void onTimer();
+    static void timerCallback(void* arg);
+};
+
+#endif
@@ -0,0 +1,187 @@
+#include "sim_hal.h"
+
+// ============================================================================
+// GPIO
+// ============================================================================
+
+SimGpio::SimGpio() : levels_(0), driven_(0) {
+    memset(interrupts_, 0, sizeof(interrupts_));
+    memset(analog_, 0, sizeof(analog_));
+}
+
+void SimGpio::setInput(uint8_t pin, bool level) {
+    if (pin >= PIN_COUNT) {
+        return;
+    }
+    driven_ |= 1ULL << pin;
+    changeLevel(pin, level);
+}
+
+bool SimGpio::level(uint8_t pin) const {
+    return pin < PIN_COUNT && ((levels_ >> pin) & 1);
+}
+
+void SimGpio::setAnalog(uint8_t pin, uint16_t value) {
+    if (pin < PIN_COUNT) {
+        analog_[pin] = value;
+    }
+}
+
+void SimGpio::pinMode(uint8_t pin, uint8_t mode) {
+    // Подтяжка держит свободный вход в единице
+    if (pin < PIN_COUNT && (mode & PULLUP) && !((driven_ >> pin) & 1)) {
+        levels_ |= 1ULL << pin;
+    }
+}
+
+void SimGpio::digitalWrite(uint8_t pin, uint8_t level) {
+    if (pin < PIN_COUNT) {
+        changeLevel(pin, level);
+    }
+}
+
+uint32_t SimGpio::readInputs(uint8_t bank) {
+    return (uint32_t)(levels_ >> (bank ? 32 : 0));
+}
+
+void SimGpio::attachEdgeInterrupt(uint8_t pin, void (*handler)(void*), void* arg) {
+    if (pin < PIN_COUNT) {
+        interrupts_[pin] = { handler, arg };
+    }
+}
+
+uint16_t SimGpio::analogRead(uint8_t pin) {
+    return pin < PIN_COUNT ? analog_[pin] : 0;
+}
+
+void SimGpio::changeLevel(uint8_t pin, bool level) {
+    if (level == (((levels_ >> pin) & 1) != 0)) {
+        return;
+    }
+    levels_ = level ? (levels_ | (1ULL << pin)) : (levels_ & ~(1ULL << pin));
+    // Прерывание по обоим фронтам (CHANGE) - сразу, в момент смены уровня
+    if (interrupts_[pin].handler) {
+        interrupts_[pin].handler(interrupts_[pin].arg);
+    }
+}
+
+// ============================================================================
+// LEDC
+// ============================================================================
+
+SimLedc::SimLedc() : writes_(0), listener_(nullptr), listenerContext_(nullptr) {
+    memset(channels_, 0, sizeof(channels_));
+}
+
+void SimLedc::setListener(WriteListener listener, void* context) {
+    listener_ = listener;
+    listenerContext_ = context;
+}
+
+uint32_t SimLedc::counts(uint8_t channel) const {
+    return channel < PWM_MAX_CHANNELS ? channels_[channel].counts : 0;
+}
+
+uint8_t SimLedc::resolution(uint8_t channel) const {
+    return channel < PWM_MAX_CHANNELS ? channels_[channel].resolution : 0;
+}
+
+uint32_t SimLedc::setup(uint8_t channel, uint32_t frequency, uint8_t resolution) {
+    // Те же ограничения, что у драйвера: частота * 2^разрешение не больше тактовой LEDC
+    if (channel >= PWM_MAX_CHANNELS || resolution == 0 || resolution > 20 ||
+        ((uint64_t)frequency << resolution) > PWM_LEDC_CLOCK_HZ) {
+        return 0;
+    }
+    // Таймер общий для пары каналов
+    for (uint8_t ch = channel & ~1; ch <= (channel | 1); ch++) {
+        channels_[ch].frequency = frequency;
+        channels_[ch].resolution = resolution;
+    }
+    return frequency;
+}
+
+void SimLedc::attachPin(uint8_t pin, uint8_t channel) {
+    if (channel < PWM_MAX_CHANNELS) {
+        channels_[channel].pin = pin;
+    }
+}
+
+void SimLedc::setDuty(uint8_t channel, uint32_t counts) {
+    if (channel < PWM_MAX_CHANNELS) {
+        channels_[channel].pending = counts;
+    }
+}
+
+void SimLedc::updateDuty(uint8_t channel) {
+    if (channel >= PWM_MAX_CHANNELS) {
+        return;
+    }
+    channels_[channel].counts = channels_[channel].pending;
+    writes_++;
+    if (listener_) {
+        listener_(channel, channels_[channel].counts, listenerContext_);
+    }
+}
+
+// ============================================================================
+// Последовательный порт
+// ============================================================================
+
+SimSerial::SimSerial()
+    : rxCapacity_(UART_RX_BUFFER_SIZE), rxOverflows_(0), txListener_(nullptr), txContext_(nullptr) {
+}
+
+void SimSerial::inject(const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (rx_.size() < rxCapacity_) {
+            rx_.push_back(data[i]);
+        } else {
+            rxOverflows_++;
+        }
+    }
+    // Драйвер сообщает о приёме по таймауту тишины - после последнего байта порции
+    if (length > 0 && onReceive_) {
+        onReceive_();
+    }
+}
+
+void SimSerial::setTxListener(TxListener listener, void* context) {
+    txListener_ = listener;
+    txContext_ = context;
+}
+
+void SimSerial::begin(unsigned long baud) {
+}
+
+size_t SimSerial::setRxBufferSize(size_t size) {
+    rxCapacity_ = size;
+    return size;
+}
+
+void SimSerial::onReceive(std::function<void()> callback, bool onlyOnTimeout) {
+    onReceive_ = callback;
+}
+
+int SimSerial::available() {
+    return (int)rx_.size();
+}
+
+size_t SimSerial::read(uint8_t* buffer, size_t size) {
+    size_t count = 0;
+    while (count < size && !rx_.empty()) {
+        buffer[count++] = rx_.front();
+        rx_.pop_front();
+    }
+    return count;
+}
+
+int SimSerial::availableForWrite() {
+    return TX_FIFO_SIZE;
+}
+
+size_t SimSerial::write(const uint8_t* data, size_t size) {
+    if (txListener_) {
+        txListener_(data, size, txContext_);
+    }
+    return size;
+}
@@ -0,0 +1,112 @@
+#ifndef SIM_HAL_H
+#define SIM_HAL_H
+
+#include <deque>
+#include "../common/config.h"
+#include "../hal/hal.h"
+
+/**
+ * Модели железа для симулятора (устанавливаются через Hal::install).
+ *
+ * Всё однопоточное и детерминированное: фронт на входе сразу вызывает
+ * обработчик прерывания, запись в LEDC и порт сразу видна слушателю.
+ */
+
+class SimGpio : public Hal::Gpio {
+public:
+    static const uint8_t PIN_COUNT = 40;
+
+    SimGpio();
+
+    // Уровень, выставленный снаружи (кнопка); фронт вызывает прерывание пина
+    void setInput(uint8_t pin, bool level);
+    bool level(uint8_t pin) const;
+    void setAnalog(uint8_t pin, uint16_t value);
+
+    void pinMode(uint8_t pin, uint8_t mode) override;
+    void digitalWrite(uint8_t pin, uint8_t level) override;
+    uint32_t readInputs(uint8_t bank) override;
+    void attachEdgeInterrupt(uint8_t pin, void (*handler)(void*), void* arg) override;
+    uint16_t analogRead(uint8_t pin) override;
+
+private:
+    struct Interrupt {
+        void (*handler)(void*);
+        void* arg;
+    };
+
+    uint64_t levels_;           // Бит n - уровень GPIOn
+    uint64_t driven_;           // Входы, уровень которых задан снаружи
+    Interrupt interrupts_[PIN_COUNT];
+    uint16_t analog_[PIN_COUNT];
+
+    void changeLevel(uint8_t pin, bool level);
+};
+
+class SimLedc : public Hal::Ledc {
+public:
+    typedef void (*WriteListener)(uint8_t channel, uint32_t counts, void* context);
+
+    SimLedc();
+
+    void setListener(WriteListener listener, void* context);
+    uint32_t counts(uint8_t channel) const;
+    uint8_t resolution(uint8_t channel) const;
+    uint32_t writes() const {
+        return writes_;
+    }
+
+    uint32_t setup(uint8_t channel, uint32_t frequency, uint8_t resolution) override;
+    void attachPin(uint8_t pin, uint8_t channel) override;
+    void setDuty(uint8_t channel, uint32_t counts) override;
+    void updateDuty(uint8_t channel) override;
+
+private:
+    struct Channel {
+        uint32_t frequency;
+        uint8_t resolution;
+        uint8_t pin;
+        uint32_t pending;       // Регистр скважности до защёлкивания
+        uint32_t counts;        // Текущий выход
+    };
+
+    Channel channels_[PWM_MAX_CHANNELS];
+    uint32_t writes_;
+    WriteListener listener_;
+    void* listenerContext_;
+};
+
+class SimSerial : public Hal::SerialPort {
+public:
+    typedef void (*TxListener)(const uint8_t* data, size_t length, void* context);
+
+    // Свободное место передатчика: FIFO UART, передача мгновенная
+    static const int TX_FIFO_SIZE = 128;
+
+    SimSerial();
+
+    // Байты от хоста; не поместившиеся в буфер приёма теряются, как в драйвере
+    void inject(const uint8_t* data, size_t length);
+    void setTxListener(TxListener listener, void* context);
+    uint32_t rxOverflows() const {
+        return rxOverflows_;
+    }
+
+    void begin(unsigned long baud) override;
+    size_t setRxBufferSize(size_t size) override;
+    void onReceive(std::function<void()> callback, bool onlyOnTimeout = false) override;
+    int available() override;
+    size_t read(uint8_t* buffer, size_t size) override;
+    int availableForWrite() override;
+    size_t write(const uint8_t* data, size_t size) override;
+
+private:
+    std::deque<uint8_t> rx_;
+    size_t rxCapacity_;
+    uint32_t rxOverflows_;
+    std::function<void()> onReceive_;
+    TxListener txListener_;
+    void* txContext_;
+};
+
+#endif
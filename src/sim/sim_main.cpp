@@ -0,0 +1,631 @@
+/**
+ * Хостовый симулятор прошивки на виртуальных часах (сборка [env:native]).
+ *
+ * Настоящие модули Button, ButtonBank, PWMController, PWMActor, PWMSequencer,
+ * PWMClosedLoop, UARTCommandHandler и шина событий работают поверх моделей
+ * железа из sim_hal.h и связаны тем же кодом, что в прошивке (src/app/).
+ * Задачи заменяет цикл в духе реактора: обработчик вызывается, когда его
+ * уведомили (прерывание кнопки или клавиши, приём, выборка STREAM, очередь
+ * ШИМ) или наступил срок кнопки либо следующий скан панели.
+ * Между событиями часы перескакивают к ближайшему сроку таймера, поэтому
+ * час нажатий и команд проходит за доли секунды.
+ *
+ * Сценарий - текстовый файл (tools/sim/<имя>.sim), команда на строку:
+ *   wait MS              пауза
+ *   press [BOUNCES]      нажатие (вход в 0); BOUNCES - лишние пары фронтов через 1 мс
+ *   release [BOUNCES]    отпускание
+ *   click [HOLD_MS]      нажатие и отпускание через HOLD_MS (по умолчанию 100)
+ *   hold_timing START_MS MIN_MS ACCEL_PERCENT   автоповтор кнопки при удержании
+ *   bank PIN...          панель ButtonBank: клавиша на каждый пин, индекс - порядок в списке
+ *   key K[,K...] press|release [BOUNCES]   клавиши панели, одновременно
+ *   key K[,K...] click [HOLD_MS]
+ *   uart TEXT            строка TEXT + "\r\n" в порт
+ *   mark TEXT            строка TEXT в трассу
+ *   trace on|off         печать событий (счётчики итога идут всегда)
+ *   repeat N ... end     повтор блока
+ *
+ * Трасса - строка на событие с виртуальным временем в мс: жест кнопки
+ * (BUTTON) или клавиши панели (KEY K), новый выход канала LEDC, строка ответа порта. Записи LEDC из таймеров
+ * (переходы, дизеринг) сводятся к последнему значению перед следующим
+ * событием; --ledc-all печатает каждую запись. Последняя строка - итог.
+ *
+ * Сборка и запуск:
+ *   pio run -e native
+ *   .pio/build/native/program tools/sim/clicks.sim                  трасса в stdout
+ *   .pio/build/native/program tools/sim/clicks.sim --golden tools/sim/clicks.golden
+ *   tools/sim/run.sh                                                все сценарии
+ */
+
+#include <stdarg.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "sim_hal.h"
+#include "../app/app.h"
+#include "../common/stats.h"
+
+namespace {
+
+const uint32_t BOUNCE_US = 1000;          // Интервал фронтов дребезга
+const uint32_t DEFAULT_CLICK_MS = 100;
+const uint32_t BUTTON_NOTIFY_BIT = 1;
+const uint32_t KEYS_NOTIFY_BIT = 1;
+const uint32_t UART_NOTIFY_BIT = 1;
+const uint32_t PWM_NOTIFY_BIT = 1;
+
+Hal::VirtualClock simClock;
+SimGpio simGpio;
+SimLedc simLedc;
+SimSerial simSerial;
+
+Button button(BUTTON_PIN);
+ButtonBank buttonBank;
+PWMController pwmController(LED_PWM_PIN);
+PWMActor pwmActor(pwmController);
+PWMSequencer pwmSequencer(pwmController);
+PWMClosedLoop pwmLoop(pwmController, PWM_LOOP_CHANNEL);
+UARTCommandHandler uartHandler;
+
+// "Задачи": значение уведомления выставляют прерывание кнопки, приём, выборки STREAM и очередь ШИМ
+tskTaskControlBlock buttonTask = { "Button", 0 };
+tskTaskControlBlock keysTask = { "Keys", 0 };
+tskTaskControlBlock uartTask = { "UART", 0 };
+void runPwmTask(tskTaskControlBlock* task);
+tskTaskControlBlock pwmTask = { "PWM", 0, runPwmTask };
+
+// ============================================================================
+// Трасса
+// ============================================================================
+
+class Timeline {
+public:
+    Timeline() : enabled_(true), gestures_(0), txLines_(0), ledcAll_(false) {
+        memset(printedCounts_, 0, sizeof(printedCounts_));
+        memset(dirty_, 0, sizeof(dirty_));
+    }
+
+    void setEnabled(bool enabled) {
+        enabled_ = enabled;
+    }
+
+    void setLedcAll(bool all) {
+        ledcAll_ = all;
+    }
+
+    void event(const char* format, ...) {
+        if (!enabled_) {
+            return;
+        }
+        char text[256];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(text, sizeof(text), format, args);
+        va_end(args);
+        lines_.push_back(stamp() + text);
+    }
+
+    // Подписчик жестов на шине, после действий ШИМ из App::wire
+    static void onGesture(const BusEvent& bus);
+
+    static void onLedcWrite(uint8_t channel, uint32_t counts, void* context) {
+        Timeline* timeline = static_cast<Timeline*>(context);
+        if (timeline->ledcAll_) {
+            timeline->event("LEDC ch%u %lu", channel, (unsigned long)counts);
+            timeline->printedCounts_[channel] = counts;
+            return;
+        }
+        timeline->dirty_[channel] = true;
+    }
+
+    // Сводка записей LEDC с прошлого события: только каналы, чей выход изменился
+    void flushLedc() {
+        for (uint8_t channel = 0; channel < PWM_MAX_CHANNELS; channel++) {
+            if (!dirty_[channel]) {
+                continue;
+            }
+            dirty_[channel] = false;
+            uint32_t counts = simLedc.counts(channel);
+            if (counts != printedCounts_[channel]) {
+                printedCounts_[channel] = counts;
+                event("LEDC ch%u %lu/%lu", channel, (unsigned long)counts,
+                      (unsigned long)(1UL << simLedc.resolution(channel)));
+            }
+        }
+    }
+
+    // Ответы порта построчно; байты вне ASCII - как \xNN, 0x00 завершает кадр
+    static void onSerialWrite(const uint8_t* data, size_t length, void* context) {
+        Timeline* timeline = static_cast<Timeline*>(context);
+        for (size_t i = 0; i < length; i++) {
+            uint8_t c = data[i];
+            if (c == '\n' || c == 0) {
+                timeline->flushTx();
+            } else if (c == '\r') {
+                continue;
+            } else if (c >= 0x20 && c < 0x7F) {
+                timeline->txLine_ += (char)c;
+            } else {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\x%02X", c);
+                timeline->txLine_ += escaped;
+            }
+        }
+    }
+
+    void flushTx() {
+        if (!txLine_.empty()) {
+            txLines_++;
+            event("TX %s", txLine_.c_str());
+            txLine_.clear();
+        }
+    }
+
+    void summary() {
+        flushTx();
+        bool enabled = enabled_;
+        enabled_ = true;
+        event("END gestures %lu commands %lu tx_lines %lu ledc_writes %lu rx_overflows %lu",
+              (unsigned long)gestures_, (unsigned long)Stats::counter(STAT_COMMANDS), (unsigned long)txLines_,
+              (unsigned long)simLedc.writes(), (unsigned long)simSerial.rxOverflows());
+        enabled_ = enabled;
+    }
+
+    const std::vector<std::string>& lines() const {
+        return lines_;
+    }
+
+private:
+    std::vector<std::string> lines_;
+    std::string txLine_;
+    bool enabled_;
+    uint32_t gestures_;
+    uint32_t txLines_;
+    bool ledcAll_;
+    uint32_t printedCounts_[PWM_MAX_CHANNELS];
+    bool dirty_[PWM_MAX_CHANNELS];
+
+    static std::string stamp() {
+        int64_t now = simClock.nowUs();
+        char text[32];
+        snprintf(text, sizeof(text), "%9lu.%03lu ", (unsigned long)(now / 1000), (unsigned long)(now % 1000));
+        return text;
+    }
+};
+
+Timeline timeline;
+
+void Timeline::onGesture(const BusEvent& bus) {
+    static const char* const NAMES[] = { "NONE", "SINGLE_CLICK", "DOUBLE_CLICK", "LONG_PRESS",
+                                         "MULTI_CLICK", "HOLD_REPEAT", "HOLD_END" };
+    uint8_t gesture = bus.payload.button.event;
+    const char* name = gesture < sizeof(NAMES) / sizeof(NAMES[0]) ? NAMES[gesture] : "UNKNOWN";
+    timeline.gestures_++;
+    if (bus.source >= App::BANK_SOURCE_FIRST) {
+        timeline.event("KEY %u %s clicks %u%s", bus.source - App::BANK_SOURCE_FIRST, name,
+                       bus.payload.button.clicks, bus.payload.button.upgrade ? " upgrade" : "");
+        return;
+    }
+    timeline.event("BUTTON %s clicks %u%s", name, bus.payload.button.clicks,
+                   bus.payload.button.upgrade ? " upgrade" : "");
+}
+
+// Объект управления - звено первого порядка: обратная связь догоняет выход канала
+uint16_t plantFeedback() {
+    static int32_t feedback = 0;
+    uint8_t resolution = simLedc.resolution(PWM_LOOP_CHANNEL);
+    int32_t output = resolution ? (int32_t)(((uint64_t)simLedc.counts(PWM_LOOP_CHANNEL) * 65535) >> resolution) : 0;
+    feedback += (output - feedback) / 8;
+    return (uint16_t)feedback;
+}
+
+// ============================================================================
+// Планировщик: обработчики по уведомлениям и срокам, время - скачками
+// ============================================================================
+
+// Владелец ШИМ выше по приоритету, чем кнопка и UART (как в Rtos::TASK_TABLE): команда
+// выполняется прямо из уведомления, до следующей строки UART. Уведомление изнутри
+// прохода остаётся в notifyValue и разбирается следующим dispatch
+void runPwmTask(tskTaskControlBlock* task) {
+    static bool running = false;
+    if (running) {
+        return;
+    }
+    running = true;
+    task->notifyValue = 0;
+    pwmActor.processNext(0);
+    running = false;
+}
+
+int64_t buttonWakeUs = -1;      // Срок кнопки (дребезг, удержание, окно клика), -1 - нет
+int64_t keysWakeUs = -1;        // Следующий скан панели, -1 - до фронта
+
+bool buttonDue() {
+    return buttonTask.notifyValue || (buttonWakeUs >= 0 && simClock.nowUs() >= buttonWakeUs);
+}
+
+bool keysDue() {
+    return keysTask.notifyValue || (keysWakeUs >= 0 && simClock.nowUs() >= keysWakeUs);
+}
+
+// Срок, до которого спала бы задача с таким таймаутом (тик - 1 мс)
+int64_t wakeUs(TickType_t ticks) {
+    return ticks == portMAX_DELAY ? -1 : simClock.nowUs() + (int64_t)ticks * 1000 / pdMS_TO_TICKS(1);
+}
+
+bool dispatch() {
+    bool ran = false;
+    if (buttonDue()) {
+        buttonTask.notifyValue = 0;
+        App::processButton();
+        ran = true;
+    }
+    if (keysDue()) {
+        keysTask.notifyValue = 0;
+        App::processBank();
+        keysWakeUs = wakeUs(buttonBank.nextTimeout());
+        ran = true;
+    }
+    if (uartTask.notifyValue) {
+        uartTask.notifyValue = 0;
+        uartHandler.processCommands();
+        ran = true;
+    }
+    if (pwmTask.notifyValue) {
+        runPwmTask(&pwmTask);
+        ran = true;
+    }
+    if (ran) {
+        buttonWakeUs = wakeUs(button.nextTimeout());
+        timeline.flushLedc();
+    }
+    return ran;
+}
+
+void runUntil(int64_t targetUs) {
+    while (true) {
+        while (dispatch()) {
+        }
+        int64_t next = targetUs;
+        int64_t dueUs;
+        if (simClock.nextTimerUs(dueUs) && dueUs < next) {
+            next = dueUs;
+        }
+        if (buttonWakeUs >= 0 && buttonWakeUs < next) {
+            next = buttonWakeUs;
+        }
+        if (keysWakeUs >= 0 && keysWakeUs < next) {
+            next = keysWakeUs;
+        }
+        simClock.setNow(next);
+        bool fired = simClock.runDueTimers();
+        if (!fired && !buttonDue() && !keysDue() && !uartTask.notifyValue && !pwmTask.notifyValue && simClock.nowUs() >= targetUs) {
+            break;
+        }
+    }
+    timeline.flushLedc();
+}
+
+void runFor(uint32_t us) {
+    runUntil(simClock.nowUs() + us);
+}
+
+void setButton(bool pressed, uint32_t bounces) {
+    bool level = pressed ? LOW : HIGH;
+    for (uint32_t i = 0; i < bounces; i++) {
+        simGpio.setInput(BUTTON_PIN, level);
+        runFor(BOUNCE_US);
+        simGpio.setInput(BUTTON_PIN, !level);
+        runFor(BOUNCE_US);
+    }
+    simGpio.setInput(BUTTON_PIN, level);
+    runFor(0);
+}
+
+// Все клавиши из списка меняют уровень одновременно, дребезг - как у кнопки
+void setKeys(const std::vector<uint8_t>& pins, bool pressed, uint32_t bounces) {
+    bool level = pressed ? LOW : HIGH;
+    auto drive = [&](bool value) {
+        for (uint8_t pin : pins) {
+            simGpio.setInput(pin, value);
+        }
+    };
+    for (uint32_t i = 0; i < bounces; i++) {
+        drive(level);
+        runFor(BOUNCE_US);
+        drive(!level);
+        runFor(BOUNCE_US);
+    }
+    drive(level);
+    runFor(0);
+}
+
+// ============================================================================
+// Сценарий
+// ============================================================================
+
+struct Step {
+    int line;
+    std::string command;
+    std::string argument;
+};
+
+const char* scriptName = "";
+std::vector<uint8_t> bankPins;  // Пин клавиши панели по её индексу
+
+[[noreturn]] void scriptError(const Step& step, const char* message) {
+    fprintf(stderr, "%s:%d: %s\n", scriptName, step.line, message);
+    exit(2);
+}
+
+bool loadScript(const char* path, std::vector<Step>& steps) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    char buffer[512];
+    int line = 0;
+    while (fgets(buffer, sizeof(buffer), file)) {
+        line++;
+        std::string text(buffer);
+        size_t comment = text.find('#');
+        if (comment != std::string::npos) {
+            text.erase(comment);
+        }
+        size_t first = text.find_first_not_of(" \t\r\n");
+        if (first == std::string::npos) {
+            continue;
+        }
+        size_t last = text.find_last_not_of(" \t\r\n");
+        text = text.substr(first, last - first + 1);
+        size_t space = text.find_first_of(" \t");
+        Step step = { line, text.substr(0, space), "" };
+        if (space != std::string::npos) {
+            step.argument = text.substr(text.find_first_not_of(" \t", space));
+        }
+        steps.push_back(step);
+    }
+    fclose(file);
+    return true;
+}
+
+uint32_t number(const Step& step, const std::string& text, uint32_t fallback) {
+    if (text.empty()) {
+        return fallback;
+    }
+    char* end;
+    unsigned long value = strtoul(text.c_str(), &end, 10);
+    if (*end) {
+        scriptError(step, "expected a number");
+    }
+    return (uint32_t)value;
+}
+
+uint32_t number(const Step& step, uint32_t fallback) {
+    return number(step, step.argument, fallback);
+}
+
+// "hold_timing START_MS MIN_MS ACCEL_PERCENT": пороги удержания кнопки поверх конфигурации
+void setHoldTiming(const Step& step) {
+    unsigned startMs, minMs, accelPercent;
+    if (sscanf(step.argument.c_str(), "%u %u %u", &startMs, &minMs, &accelPercent) != 3 || accelPercent > 100) {
+        scriptError(step, "expected hold_timing START_MS MIN_MS ACCEL_PERCENT");
+    }
+    GestureTiming timing = DEFAULT_GESTURE_TIMING;
+    timing.repeatStartMs = (uint16_t)startMs;
+    timing.repeatMinMs = (uint16_t)minMs;
+    timing.repeatAccelPercent = (uint8_t)accelPercent;
+    button.setTiming(timing);
+}
+
+// "bank PIN...": клавиши добавляются по порядку, затем begin()
+void createBank(const Step& step) {
+    if (!bankPins.empty()) {
+        scriptError(step, "bank is already configured");
+    }
+    char* cursor = const_cast<char*>(step.argument.c_str());
+    while (*cursor) {
+        char* end;
+        unsigned long pin = strtoul(cursor, &end, 10);
+        if (end == cursor || !buttonBank.addKey((uint8_t)pin)) {
+            scriptError(step, "expected free GPIO pins");
+        }
+        bankPins.push_back((uint8_t)pin);
+        cursor = end + strspn(end, " \t");
+    }
+    if (bankPins.empty()) {
+        scriptError(step, "expected pins");
+    }
+    buttonBank.begin();
+}
+
+// "key K[,K...] press|release [BOUNCES]" и "key K[,K...] click [HOLD_MS]"
+void driveKeys(const Step& step) {
+    char keys[64];
+    char action[16];
+    char extra[16] = "";
+    if (sscanf(step.argument.c_str(), "%63s %15s %15s", keys, action, extra) < 2) {
+        scriptError(step, "expected key K[,K...] press|release|click [N]");
+    }
+    std::vector<uint8_t> pins;
+    for (char* item = strtok(keys, ","); item; item = strtok(nullptr, ",")) {
+        uint32_t key = number(step, item, 0);
+        if (key >= bankPins.size()) {
+            scriptError(step, "no such key in bank");
+        }
+        pins.push_back(bankPins[key]);
+    }
+    if (strcmp(action, "press") == 0 || strcmp(action, "release") == 0) {
+        setKeys(pins, action[0] == 'p', number(step, extra, 0));
+    } else if (strcmp(action, "click") == 0) {
+        setKeys(pins, true, 0);
+        runFor(number(step, extra, DEFAULT_CLICK_MS) * 1000);
+        setKeys(pins, false, 0);
+    } else {
+        scriptError(step, "expected press|release|click");
+    }
+}
+
+// Индекс парного end для repeat на позиции start
+size_t matchingEnd(const std::vector<Step>& steps, size_t start) {
+    int depth = 0;
+    for (size_t i = start; i < steps.size(); i++) {
+        if (steps[i].command == "repeat") {
+            depth++;
+        } else if (steps[i].command == "end" && --depth == 0) {
+            return i;
+        }
+    }
+    scriptError(steps[start], "repeat without end");
+}
+
+void execute(const std::vector<Step>& steps, size_t from, size_t to) {
+    for (size_t i = from; i < to; i++) {
+        const Step& step = steps[i];
+        if (step.command == "wait") {
+            runFor(number(step, 0) * 1000);
+        } else if (step.command == "press") {
+            setButton(true, number(step, 0));
+        } else if (step.command == "release") {
+            setButton(false, number(step, 0));
+        } else if (step.command == "click") {
+            setButton(true, 0);
+            runFor(number(step, DEFAULT_CLICK_MS) * 1000);
+            setButton(false, 0);
+        } else if (step.command == "hold_timing") {
+            setHoldTiming(step);
+        } else if (step.command == "bank") {
+            createBank(step);
+        } else if (step.command == "key") {
+            driveKeys(step);
+        } else if (step.command == "uart") {
+            std::string line = step.argument + "\r\n";
+            simSerial.inject((const uint8_t*)line.data(), line.size());
+            runFor(0);
+        } else if (step.command == "mark") {
+            timeline.event("MARK %s", step.argument.c_str());
+        } else if (step.command == "trace") {
+            if (step.argument != "on" && step.argument != "off") {
+                scriptError(step, "expected trace on|off");
+            }
+            timeline.setEnabled(step.argument == "on");
+        } else if (step.command == "repeat") {
+            size_t end = matchingEnd(steps, i);
+            uint32_t count = number(step, 1);
+            for (uint32_t n = 0; n < count; n++) {
+                execute(steps, i + 1, end);
+            }
+            i = end;
+        } else if (step.command == "end") {
+            scriptError(step, "end without repeat");
+        } else {
+            scriptError(step, "unknown command");
+        }
+    }
+}
+
+bool loadGolden(const char* path, std::vector<std::string>& lines) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    char buffer[512];
+    while (fgets(buffer, sizeof(buffer), file)) {
+        std::string line(buffer);
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) {
+            line.pop_back();
+        }
+        lines.push_back(line);
+    }
+    fclose(file);
+    return true;
+}
+
+// Первое расхождение трассы с эталоном; 0 - совпали
+int compareGolden(const std::vector<std::string>& actual, const std::vector<std::string>& expected) {
+    size_t count = actual.size() > expected.size() ? actual.size() : expected.size();
+    for (size_t i = 0; i < count; i++) {
+        const char* want = i < expected.size() ? expected[i].c_str() : "(end of golden)";
+        const char* got = i < actual.size() ? actual[i].c_str() : "(end of trace)";
+        if (strcmp(want, got) != 0) {
+            fprintf(stderr, "%s: trace differs at line %lu\n  expected: %s\n  actual:   %s\n", scriptName,
+                    (unsigned long)(i + 1), want, got);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const char* goldenPath = nullptr;
+    bool ledcAll = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+            goldenPath = argv[++i];
+        } else if (strcmp(argv[i], "--ledc-all") == 0) {
+            ledcAll = true;
+        } else if (argv[i][0] != '-' && !*scriptName) {
+            scriptName = argv[i];
+        } else {
+            scriptName = "";
+            break;
+        }
+    }
+    if (!*scriptName) {
+        fprintf(stderr, "usage: %s SCENARIO [--golden FILE] [--ledc-all]\n", argv[0]);
+        return 2;
+    }
+    std::vector<Step> steps;
+    if (!loadScript(scriptName, steps)) {
+        return 2;
+    }
+
+    /**
+     * СБОРКА ПРОШИВКИ НА МОДЕЛЯХ:
+     * 1. Модели железа устанавливаются до begin() модулей
+     * 2. Модули уведомляют "задачи" симулятора вместо задач FreeRTOS
+     * 3. Колбэки UART и действия кнопки - App::wire, как в main.cpp
+     */
+    Hal::install(&simClock, &simGpio, &simLedc, &simSerial);
+    timeline.setLedcAll(ledcAll);
+    simLedc.setListener(Timeline::onLedcWrite, &timeline);
+    simSerial.setTxListener(Timeline::onSerialWrite, &timeline);
+
+    button.begin();
+    pwmController.begin();
+    pwmActor.begin();
+    pwmSequencer.begin();
+    pwmLoop.begin(plantFeedback);
+    uartHandler.begin();
+    App::Modules modules = { &button, &buttonBank, &pwmActor, &pwmSequencer, &pwmLoop, &uartHandler };
+    App::wire(modules);
+    EventBus::subscribe(BUS_EVENT_MASK(BUS_EVENT_BUTTON), Timeline::onGesture);
+    button.notifyTask(&buttonTask, BUTTON_NOTIFY_BIT);
+    buttonBank.notifyTask(&keysTask, KEYS_NOTIFY_BIT);
+    uartHandler.notifyTask(&uartTask, UART_NOTIFY_BIT);
+    pwmActor.notifyTask(&pwmTask, PWM_NOTIFY_BIT);
+
+    auto started = std::chrono::steady_clock::now();
+    execute(steps, 0, steps.size());
+    timeline.summary();
+    double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+    int result = 0;
+    if (goldenPath) {
+        std::vector<std::string> expected;
+        if (!loadGolden(goldenPath, expected)) {
+            return 2;
+        }
+        result = compareGolden(timeline.lines(), expected);
+    } else {
+        for (const std::string& line : timeline.lines()) {
+            puts(line.c_str());
+        }
+    }
+    fprintf(stderr, "%s %s: %.1f s simulated in %.1f ms\n", result ? "FAIL" : "PASS", scriptName,
+            simClock.nowUs() / 1e6, wallMs);
+    return result;
+}
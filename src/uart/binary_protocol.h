@@ -0,0 +1,145 @@
+#ifndef BINARY_PROTOCOL_H
+#define BINARY_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Бинарный протокол команд UART (клиент: tools/pwm_bin.py).
+ *
+ * Кадр на линии: 0x00 <COBS(пакет)> 0x00. Нулевой байт в тексте не
+ * встречается, поэтому первый 0x00 переключает обработчик в бинарный режим.
+ *
+ * Пакет запроса:  seq | запись... | crc16 (LE)
+ *   запись:       opcode | channel | value (LE16) [| duration_ms (LE16) для OP_FADE]
+ * Пакет ответа:   seq | status | applied | value (LE16) | crc16 (LE)
+ * Выборка STREAM: 0xFE | seq (LE16) | time_us (LE32) | dropped (LE16) | fields | поля... | crc16 (LE)
+ *   DUTY:         active_mask (LE16) | duty16 (LE16) на каждый активный канал
+ *   BUTTON:       pressed | events (LE32)
+ *   COUNTERS:     commands (LE32) | rx_bytes (LE32) | pwm_applied (LE32)
+ * Запись лога:   0xFD | level | token (LE24) | dt_ms varint | аргументы | crc16 (LE)
+ *   (SET LOG BIN, формат аргументов - src/common/logger.cpp, декодер - tools/log_decode.py)
+ *
+ * Записи применяются по порядку; на первой ошибке обработка кадра
+ * останавливается, applied - число уже выполненных записей.
+ * CRC16-CCITT (полином 0x1021, начальное значение 0xFFFF) считается по всему пакету до CRC.
+ */
+namespace BinaryProtocol {
+
+enum Opcode : uint8_t {
+    OP_SET_PWM = 0x01,       // value: 0-100 %
+    OP_SET_PERMILLE = 0x02,  // value: 0-1000 ‰
+    OP_FADE = 0x03,          // value: 0-100 %, затем длительность в мс
+    OP_GET_PWM = 0x04,       // Ответ: скважность канала 0 в value
+    OP_SET_DITHER = 0x05,    // value: 0|1
+    OP_TEXT_MODE = 0x7F      // Возврат к текстовым командам после ответа
+};
+
+enum Status : uint8_t {
+    STATUS_ACK = 0,
+    STATUS_NACK_CRC = 1,         // Кадр повреждён - ничего не применено
+    STATUS_NACK_FORMAT = 2,      // Ошибка COBS, длины или обрезанная запись
+    STATUS_NACK_OPCODE = 3,
+    STATUS_NACK_RANGE = 4,       // Канал или значение вне диапазона
+    STATUS_NACK_REJECTED = 5,    // Канал не настроен / колбэк вернул false
+    STATUS_NACK_UNSUPPORTED = 6  // Колбэк не установлен
+};
+
+const uint8_t RECORD_SIZE = 4;
+const uint8_t FADE_RECORD_SIZE = 6;
+const uint8_t RESPONSE_SIZE = 7;
+const uint8_t MIN_PACKET_SIZE = 3;  // seq + crc16, без записей
+const uint8_t TELEMETRY_TAG = 0xFE; // Первый байт пакета выборки (ответы - ровно RESPONSE_SIZE байт)
+const uint8_t LOG_TAG = 0xFD;       // Первый байт пакета записи лога
+
+// Таблица CRC16-CCITT, строится при компиляции
+struct CrcTable {
+    uint16_t values[256];
+
+    constexpr CrcTable() : values() {
+        for (uint16_t i = 0; i < 256; i++) {
+            uint16_t crc = i << 8;
+            for (uint8_t bit = 0; bit < 8; bit++) {
+                crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+            }
+            values[i] = crc;
+        }
+    }
+};
+
+constexpr CrcTable CRC_TABLE;
+static_assert(CRC_TABLE.values[1] == 0x1021, "CRC16 table is broken");
+
+inline uint16_t crc16(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc = (uint16_t)(crc << 8) ^ CRC_TABLE.values[(crc >> 8) ^ data[i]];
+    }
+    return crc;
+}
+
+// Максимальная длина после COBS для пакета длины length
+constexpr size_t cobsEncodedSize(size_t length) {
+    return length + length / 254 + 1;
+}
+
+// Кодирует пакет без завершающего нуля, возвращает длину результата
+inline size_t cobsEncode(const uint8_t* input, size_t length, uint8_t* output) {
+    size_t codeIndex = 0;
+    size_t outIndex = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < length; i++) {
+        if (input[i] != 0) {
+            output[outIndex++] = input[i];
+            code++;
+        }
+        if (input[i] == 0 || code == 0xFF) {
+            output[codeIndex] = code;
+            codeIndex = outIndex++;
+            code = 1;
+        }
+    }
+    output[codeIndex] = code;
+    return outIndex;
+}
+
+/**
+ * Декодирует кадр на месте (результат не длиннее входа).
+ * Возвращает false, если кадр содержит ноль или обрывается внутри блока.
+ */
+inline bool cobsDecode(uint8_t* data, size_t length, size_t& decodedLength) {
+    size_t in = 0;
+    size_t out = 0;
+    while (in < length) {
+        uint8_t code = data[in++];
+        if (code == 0 || in + code - 1 > length) {
+            return false;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            data[out++] = data[in++];
+        }
+        if (code < 0xFF && in < length) {
+            data[out++] = 0;
+        }
+    }
+    decodedLength = out;
+    return true;
+}
+
+inline uint16_t readLe16(const uint8_t* data) {
+    return data[0] | (uint16_t)(data[1] << 8);
+}
+
+inline void writeLe16(uint8_t* data, uint16_t value) {
+    data[0] = value & 0xFF;
+    data[1] = value >> 8;
+}
+
+inline void writeLe32(uint8_t* data, uint32_t value) {
+    writeLe16(data, value & 0xFFFF);
+    writeLe16(data + 2, value >> 16);
+}
+
+}  // namespace BinaryProtocol
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef BUS_ADDRESS_H
+#define BUS_ADDRESS_H
+
+#include <stdint.h>
+
+// Адреса шины RS-485 (префикс строки "@<адрес> ")
+const uint8_t BUS_ADDRESS_NONE = 0;          // Узел без адреса: принимает строки без префикса
+const uint8_t BUS_ADDRESS_MAX = 199;         // Адреса узлов 1-199
+const uint8_t BUS_GROUP_FIRST = 200;         // Групповые адреса 200-254
+const uint8_t BUS_GROUP_LAST = 254;
+const uint8_t BUS_BROADCAST = 255;           // Все узлы, также "@*"
+
+// Как отвечать на принятую строку
+enum BusReply : uint8_t {
+    BUS_REPLY_PLAIN,        // Строка без адреса - ответ как раньше
+    BUS_REPLY_ADDRESSED,    // Адрес узла - ответ с префиксом "@<адрес> "
+    BUS_REPLY_SILENT        // Широковещательный или групповой адрес - без ответа
+};
+
+/**
+ * Разбор адресного префикса строки по мере приёма символов.
+ *
+ * feed() получает каждый символ строки до конца строки и решает его
+ * судьбу: префикс "@12 " не попадает в буфер команды, а строка для
+ * другого узла отбрасывается уже на первом пробеле после адреса - без
+ * копирования, разбора на слова и поиска команды. Так узел на нагруженной
+ * шине тратит на чужую строку одно сравнение на символ.
+ *
+ * Узел без адреса (BUS_ADDRESS_NONE) работает как одиночный: строки без
+ * префикса выполняются, адресные - только широковещательные и групповые.
+ * Узел с адресом принимает только адресные строки, иначе на общей линии
+ * ему отвечали бы все узлы разом.
+ *
+ * Заголовок не зависит от Arduino: тот же код проверяется моделью шины
+ * на хосте (tools/bus_sim.cpp).
+ */
+class BusAddressFilter {
+public:
+    enum Action : uint8_t {
+        BUS_SKIP,       // Символ префикса - не сохранять
+        BUS_STORE,      // Символ команды
+        BUS_DISCARD     // Строка не для этого узла - пропускать до конца строки
+    };
+
+    BusAddressFilter() : address_(BUS_ADDRESS_NONE), groups_(0) {
+        startLine();
+    }
+
+    // false - адрес вне диапазона узлов
+    bool setAddress(uint8_t address) {
+        if (address > BUS_ADDRESS_MAX) {
+            return false;
+        }
+        address_ = address;
+        return true;
+    }
+
+    uint8_t address() const {
+        return address_;
+    }
+
+    // false - адрес не групповой
+    bool setGroup(uint8_t group, bool member) {
+        if (group < BUS_GROUP_FIRST || group > BUS_GROUP_LAST) {
+            return false;
+        }
+        uint64_t bit = 1ULL << (group - BUS_GROUP_FIRST);
+        groups_ = member ? (groups_ | bit) : (groups_ & ~bit);
+        return true;
+    }
+
+    bool isGroupMember(uint8_t group) const {
+        return group >= BUS_GROUP_FIRST && group <= BUS_GROUP_LAST &&
+               (groups_ >> (group - BUS_GROUP_FIRST)) & 1;
+    }
+
+    // Вызывается после конца строки (и при сбросе приёма)
+    void startLine() {
+        state_ = STATE_LINE_START;
+        target_ = 0;
+        digits_ = 0;
+        // Вне адресной строки узел с адресом молчит: ошибки приёма не должны сталкиваться на линии
+        reply_ = address_ == BUS_ADDRESS_NONE ? BUS_REPLY_PLAIN : BUS_REPLY_SILENT;
+    }
+
+    Action feed(char c) {
+        switch (state_) {
+            case STATE_LINE_START:
+                if (c == ' ' || c == '\t') {
+                    return BUS_SKIP;
+                }
+                if (c == '@') {
+                    state_ = STATE_ADDRESS;
+                    return BUS_SKIP;
+                }
+                if (address_ != BUS_ADDRESS_NONE) {
+                    return discard();
+                }
+                state_ = STATE_BODY;
+                return BUS_STORE;
+
+            case STATE_ADDRESS:
+                if (c >= '0' && c <= '9' && digits_ < 3) {
+                    target_ = target_ * 10 + (c - '0');
+                    digits_++;
+                    return target_ <= BUS_BROADCAST ? BUS_SKIP : discard();
+                }
+                if (c == '*' && digits_ == 0) {
+                    target_ = BUS_BROADCAST;
+                    digits_ = 3;
+                    return BUS_SKIP;
+                }
+                if ((c == ' ' || c == '\t') && digits_ > 0) {
+                    return accept((uint8_t)target_);
+                }
+                return discard();
+
+            case STATE_BODY:
+                return BUS_STORE;
+
+            default:
+                return BUS_DISCARD;
+        }
+    }
+
+    // Режим ответа для строки, принятой целиком (действителен до startLine)
+    BusReply reply() const {
+        return reply_;
+    }
+
+    // Адрес из префикса строки - его повторяет ответ
+    uint8_t target() const {
+        return (uint8_t)target_;
+    }
+
+private:
+    enum State : uint8_t {
+        STATE_LINE_START,
+        STATE_ADDRESS,
+        STATE_BODY,
+        STATE_DISCARD
+    };
+
+    uint8_t address_;
+    uint64_t groups_;           // Бит i - членство в группе BUS_GROUP_FIRST + i
+    State state_;
+    uint16_t target_;
+    uint8_t digits_;
+    BusReply reply_;
+
+    Action accept(uint8_t target) {
+        if (target == BUS_BROADCAST || isGroupMember(target)) {
+            reply_ = BUS_REPLY_SILENT;
+        } else if (target != BUS_ADDRESS_NONE && target == address_) {
+            reply_ = BUS_REPLY_ADDRESSED;
+        } else {
+            return discard();
+        }
+        state_ = STATE_BODY;
+        return BUS_SKIP;
+    }
+
+    Action discard() {
+        state_ = STATE_DISCARD;
+        return BUS_DISCARD;
+    }
+};
+
+#endif
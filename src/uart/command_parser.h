@@ -0,0 +1,124 @@
+#ifndef COMMAND_PARSER_H
+#define COMMAND_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "../common/config.h"
+
+/**
+ * Разбор текстовых команд без выделения памяти.
+ *
+ * - Строка режется на слова прямо в буфере команды: разделители заменяются
+ *   на '\0', буквы приводятся к верхнему регистру.
+ * - Глагол команды (одно или два первых слова) ищется по FNV-1a хешу,
+ *   который для таблицы команд считается при компиляции.
+ * - Числа разбираются без strtol/String, с проверкой переполнения.
+ *
+ * Время разбора ограничено длиной буфера и числом слов UART_MAX_TOKENS.
+ */
+namespace CommandParser {
+
+struct Tokens {
+    char* words[UART_MAX_TOKENS];
+    uint8_t count;
+};
+
+constexpr uint32_t FNV_OFFSET = 2166136261u;
+constexpr uint32_t FNV_PRIME = 16777619u;
+
+constexpr uint32_t hashChar(uint32_t hash, char c) {
+    return (hash ^ (uint8_t)c) * FNV_PRIME;
+}
+
+constexpr uint32_t hashAppend(uint32_t hash, const char* text) {
+    while (*text) {
+        hash = hashChar(hash, *text++);
+    }
+    return hash;
+}
+
+// Хеш глагола вида "SET PWM" - совпадает с хешем слов, склеенных пробелом
+constexpr uint32_t verbHash(const char* verb) {
+    return hashAppend(FNV_OFFSET, verb);
+}
+
+inline uint32_t wordsHash(char* const* words, uint8_t count) {
+    uint32_t hash = FNV_OFFSET;
+    for (uint8_t i = 0; i < count; i++) {
+        if (i > 0) {
+            hash = hashChar(hash, ' ');
+        }
+        hash = hashAppend(hash, words[i]);
+    }
+    return hash;
+}
+
+// Сравнение глагола таблицы со словами команды (защита от коллизии хеша)
+inline bool wordsEqual(const char* verb, char* const* words, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (i > 0 && *verb++ != ' ') {
+            return false;
+        }
+        size_t length = strlen(words[i]);
+        if (strncmp(verb, words[i], length) != 0) {
+            return false;
+        }
+        verb += length;
+    }
+    return *verb == '\0';
+}
+
+/**
+ * Разбивает строку на слова на месте.
+ * Возвращает false, если слов больше UART_MAX_TOKENS.
+ */
+inline bool tokenize(char* line, Tokens& tokens) {
+    tokens.count = 0;
+    char* p = line;
+    while (true) {
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        if (*p == '\0') {
+            return true;
+        }
+        if (tokens.count >= UART_MAX_TOKENS) {
+            return false;
+        }
+        tokens.words[tokens.count++] = p;
+        while (*p != '\0' && *p != ' ' && *p != '\t') {
+            if (*p >= 'a' && *p <= 'z') {
+                *p -= 'a' - 'A';
+            }
+            p++;
+        }
+        if (*p != '\0') {
+            *p++ = '\0';
+        }
+    }
+}
+
+// Десятичное число без знака; false при пустой строке, лишних символах или переполнении
+inline bool parseUnsigned(const char* text, uint32_t& value) {
+    if (*text == '\0') {
+        return false;
+    }
+    uint32_t result = 0;
+    for (; *text; text++) {
+        if (*text < '0' || *text > '9') {
+            return false;
+        }
+        uint32_t digit = *text - '0';
+        if (result > (UINT32_MAX - digit) / 10) {
+            return false;
+        }
+        result = result * 10 + digit;
+    }
+    value = result;
+    return true;
+}
+
+}  // namespace CommandParser
+
+#endif
@@ -0,0 +1,200 @@
+#include "telemetry.h"
+#include "binary_protocol.h"
+#include "../hal/hal.h"
+
+static_assert(BinaryProtocol::cobsEncodedSize(Telemetry::PACKET_MAX) + 2 <= Telemetry::RECORD_MAX,
+              "Telemetry frame does not fit a ring record");
+
+Telemetry::Telemetry()
+    : source_(nullptr), wake_(nullptr), wakeContext_(nullptr), timer_(nullptr), running_(false), fields_(0),
+      binary_(false), rateHz_(0), sequence_(0), dropped_(0) {
+}
+
+bool Telemetry::begin(WakeCallback wake, void* context) {
+    wake_ = wake;
+    wakeContext_ = context;
+    
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = &Telemetry::timerCallback;
+    timerArgs.arg = this;
+    timerArgs.dispatch_method = ESP_TIMER_TASK;
+    timerArgs.name = "telemetry";
+    if (esp_timer_create(&timerArgs, &timer_) != ESP_OK) {
+        Logger::error("Telemetry timer creation failed");
+        return false;
+    }
+    return true;
+}
+
+void Telemetry::setSource(SampleSource source) {
+    source_ = source;
+}
+
+bool Telemetry::start(uint8_t fields, uint16_t rateHz, bool binary) {
+    if (!timer_ || !source_ || fields == 0 || (fields & ~TELEMETRY_ALL) || rateHz == 0 ||
+        rateHz > TELEMETRY_MAX_RATE_HZ) {
+        return false;
+    }
+    
+    // Новые параметры - с чистого потока: таймер стоит, хвост старых выборок сброшен
+    esp_timer_stop(timer_);
+    running_ = false;
+    ring_.clear();
+    fields_ = fields;
+    binary_ = binary;
+    rateHz_ = rateHz;
+    sequence_ = 0;
+    dropped_ = 0;
+    running_ = true;
+    esp_timer_start_periodic(timer_, 1000000UL / rateHz);
+    
+    Logger::info("Telemetry stream: fields 0x%02X, %u Hz, %s", fields, rateHz, binary ? "BIN" : "TEXT");
+    return true;
+}
+
+void Telemetry::stop() {
+    if (!running_) {
+        return;
+    }
+    running_ = false;
+    esp_timer_stop(timer_);
+    // Не выданные выборки не должны прийти после ответа на STREAM OFF
+    ring_.clear();
+    Logger::info("Telemetry stream stopped: %lu samples, %lu dropped",
+                 (unsigned long)sequence_, (unsigned long)dropped_);
+}
+
+size_t Telemetry::peek(uint8_t* record, size_t capacity) {
+    uint8_t stored[RECORD_MAX + 1];
+    if (ring_.peek(stored, 1) == 0) {
+        return 0;
+    }
+    size_t length = stored[0];
+    if (length > capacity || ring_.peek(stored, length + 1) < length + 1) {
+        return 0;
+    }
+    memcpy(record, stored + 1, length);
+    return length;
+}
+
+void Telemetry::consume(size_t length) {
+    ring_.skip(length + 1);
+}
+
+void Telemetry::timerCallback(void* arg) {
+    static_cast<Telemetry*>(arg)->onTimer();
+}
+
+void Telemetry::onTimer() {
+    /**
+     * ВЫБОРКА (задача esp_timer, единственный производитель кольца):
+     * 1. Номер выборки растёт всегда - пропуск виден на хосте
+     * 2. Запись целиком или никак: нет места - только счётчик потерь
+     * 3. Пробуждение задачи UART, которая разбирает кольцо
+     */
+    if (!running_) {
+        return;
+    }
+    uint32_t sequence = sequence_++;
+    uint32_t timeUs = (uint32_t)Hal::nowUs();
+    
+    TelemetrySample sample = {};
+    source_(sample);
+    
+    uint8_t record[RECORD_MAX + 1];
+    size_t length = binary_ ? encodeBinary(sample, sequence, timeUs, record + 1)
+                            : encodeText(sample, sequence, timeUs, record + 1);
+    if (length == 0 || ring_.space() < length + 1) {
+        dropped_++;
+        return;
+    }
+    record[0] = (uint8_t)length;
+    ring_.write(record, length + 1);
+    
+    if (wake_) {
+        wake_(wakeContext_);
+    }
+}
+
+size_t Telemetry::encodeText(const TelemetrySample& sample, uint32_t sequence, uint32_t timeUs, uint8_t* out) {
+    // T <номер> <время, мкс> <потеряно> [DUTY ch:‰ ...] [BTN нажата жестов] [CNT команд байт применено]
+    char* line = (char*)out;
+    const size_t capacity = RECORD_MAX;
+    int length = snprintf(line, capacity, "T %lu %lu %lu", (unsigned long)sequence, (unsigned long)timeUs,
+                          (unsigned long)dropped_);
+    uint8_t fields = fields_;
+    
+    if (fields & TELEMETRY_DUTY) {
+        length += snprintf(line + length, capacity - length, " DUTY");
+        for (uint8_t ch = 0; ch < PWM_MAX_CHANNELS && length < (int)capacity; ch++) {
+            if (sample.activeMask & (1 << ch)) {
+                uint32_t permille = ((uint32_t)sample.duty16[ch] * 1000 + 32767) / 65535;
+                length += snprintf(line + length, capacity - length, " %u:%lu", ch, (unsigned long)permille);
+            }
+        }
+    }
+    if ((fields & TELEMETRY_BUTTON) && length < (int)capacity) {
+        length += snprintf(line + length, capacity - length, " BTN %u %lu", sample.pressed ? 1 : 0,
+                           (unsigned long)sample.buttonEvents);
+    }
+    if ((fields & TELEMETRY_COUNTERS) && length < (int)capacity) {
+        length += snprintf(line + length, capacity - length, " CNT %lu %lu %lu", (unsigned long)sample.commands,
+                           (unsigned long)sample.rxBytes, (unsigned long)sample.pwmApplied);
+    }
+    
+    // Усечённая строка хосту не нужна - считаем выборку потерянной
+    if (length < 0 || length + 2 > (int)capacity) {
+        return 0;
+    }
+    line[length++] = '\r';
+    line[length++] = '\n';
+    return length;
+}
+
+size_t Telemetry::encodeBinary(const TelemetrySample& sample, uint32_t sequence, uint32_t timeUs, uint8_t* out) {
+    using namespace BinaryProtocol;
+    
+    // Формат пакета - в binary_protocol.h
+    uint8_t packet[PACKET_MAX];
+    size_t length = 0;
+    uint8_t fields = fields_;
+    uint32_t dropped = dropped_;
+    packet[length++] = TELEMETRY_TAG;
+    writeLe16(packet + length, (uint16_t)sequence);
+    length += 2;
+    writeLe32(packet + length, timeUs);
+    length += 4;
+    writeLe16(packet + length, dropped > 0xFFFF ? 0xFFFF : (uint16_t)dropped);
+    length += 2;
+    packet[length++] = fields;
+    
+    if (fields & TELEMETRY_DUTY) {
+        writeLe16(packet + length, sample.activeMask);
+        length += 2;
+        for (uint8_t ch = 0; ch < PWM_MAX_CHANNELS; ch++) {
+            if (sample.activeMask & (1 << ch)) {
+                writeLe16(packet + length, sample.duty16[ch]);
+                length += 2;
+            }
+        }
+    }
+    if (fields & TELEMETRY_BUTTON) {
+        packet[length++] = sample.pressed ? 1 : 0;
+        writeLe32(packet + length, sample.buttonEvents);
+        length += 4;
+    }
+    if (fields & TELEMETRY_COUNTERS) {
+        writeLe32(packet + length, sample.commands);
+        writeLe32(packet + length + 4, sample.rxBytes);
+        writeLe32(packet + length + 8, sample.pwmApplied);
+        length += 12;
+    }
+    writeLe16(packet + length, crc16(packet, length));
+    length += 2;
+    
+    // Как и ответы, кадр окружён нулями - его не спутать с текстом лога
+    out[0] = 0;
+    size_t wireLength = 1 + cobsEncode(packet, length, out + 1);
+    out[wireLength++] = 0;
+    return wireLength;
+}
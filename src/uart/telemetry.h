@@ -0,0 +1,88 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "../common/config.h"
+#include "../common/logger.h"
+#include "../common/ring_buffer.h"
+
+// Поля выборки (маска в команде STREAM)
+enum TelemetryField : uint8_t {
+    TELEMETRY_DUTY = 1 << 0,         // Скважность активных каналов
+    TELEMETRY_BUTTON = 1 << 1,       // Состояние кнопки и число жестов
+    TELEMETRY_COUNTERS = 1 << 2,     // Команды, принятые байты, применённые команды ШИМ
+    TELEMETRY_ALL = TELEMETRY_DUTY | TELEMETRY_BUTTON | TELEMETRY_COUNTERS
+};
+
+// Значения для одной выборки, заполняет источник из main.cpp
+struct TelemetrySample {
+    uint16_t activeMask;
+    uint16_t duty16[PWM_MAX_CHANNELS];
+    bool pressed;
+    uint32_t buttonEvents;
+    uint32_t commands;
+    uint32_t rxBytes;
+    uint32_t pwmApplied;
+};
+
+/**
+ * Поток телеметрии STREAM вместо опроса GET PWM.
+ *
+ * Таймер esp_timer с заданной частотой собирает выборку, кодирует её
+ * (текстовая строка или COBS-кадр, см. binary_protocol.h) и кладёт в
+ * кольцо целой записью. Места нет - выборка отбрасывается и считается,
+ * таймер никогда не ждёт UART. Номер выборки растёт и для отброшенных,
+ * поэтому хост видит пропуски и без счётчика.
+ *
+ * Кольцо разбирает задача UART (drain) после ответов на команды и только
+ * целыми записями, которые помещаются в буфер передачи драйвера, - строки
+ * выборок не перемешиваются с ответами. После каждой выборки таймер будит
+ * задачу через wake.
+ */
+class Telemetry {
+public:
+    typedef void (*SampleSource)(TelemetrySample& sample);
+    typedef void (*WakeCallback)(void* context);
+    
+    static const size_t RECORD_MAX = 255;   // Длина записи хранится одним байтом
+    // Пакет выборки со всеми полями: заголовок 10, DUTY, BUTTON 5, COUNTERS 12, CRC 2
+    static const size_t PACKET_MAX = 10 + 2 + 2 * PWM_MAX_CHANNELS + 5 + 12 + 2;
+    
+    Telemetry();
+    bool begin(WakeCallback wake, void* context);
+    void setSource(SampleSource source);
+    
+    bool start(uint8_t fields, uint16_t rateHz, bool binary);
+    void stop();
+    bool isRunning() const { return running_; }
+    uint8_t fields() const { return fields_; }
+    uint16_t rateHz() const { return rateHz_; }
+    bool isBinary() const { return binary_; }
+    uint32_t sampleCount() const { return sequence_; }
+    uint32_t droppedCount() const { return dropped_; }
+    
+    // Потребитель (задача UART): следующая запись целиком, 0 - записей нет
+    size_t peek(uint8_t* record, size_t capacity);
+    void consume(size_t length);
+
+private:
+    RingBuffer<uint8_t, TELEMETRY_BUFFER_SIZE> ring_;  // [длина][запись]...
+    SampleSource source_;
+    WakeCallback wake_;
+    void* wakeContext_;
+    esp_timer_handle_t timer_;
+    volatile bool running_;
+    volatile uint8_t fields_;
+    volatile bool binary_;
+    uint16_t rateHz_;
+    volatile uint32_t sequence_;
+    volatile uint32_t dropped_;
+    
+    size_t encodeText(const TelemetrySample& sample, uint32_t sequence, uint32_t timeUs, uint8_t* out);
+    size_t encodeBinary(const TelemetrySample& sample, uint32_t sequence, uint32_t timeUs, uint8_t* out);
+    void onTimer();
+    static void timerCallback(void* arg);
+};
+
+#endif
@@ -1,119 +1,203 @@
 #include "uart.h"
+#include "../pwm/duty_table.h"
+#include "../common/rtos.h"
+#include "../hal/hal.h"
+#include <esp_system.h>
+#include <array>
+#include <stdarg.h>
 
 // ============================================================================
-// Реализация кольцевого буфера
+// Реализация обработчика UART команд
 // ============================================================================
 
-UARTCommandHandler::RingBuffer::RingBuffer() 
-    : head_(0), tail_(0), count_(0) {
-    memset(data_, 0, sizeof(data_));
+UARTCommandHandler::UARTCommandHandler() 
+    : cmdIndex_(0), discardingLine_(false), binaryMode_(false), rxTask_(nullptr), rxNotifyBits_(0), rxTimeUs_(0), lineStartUs_(0), traceId_(0),
+      txLength_(0), transactionOpen_(false), transactionFailed_(false), stagedCount_(0),
+      setPWMCallback_(nullptr), getPWMCallback_(nullptr),
+      setChannelPWMCallback_(nullptr), fadeCallback_(nullptr), permilleCallback_(nullptr),
+      pwmConfigCallback_(nullptr), ditherCallback_(nullptr), batchCallback_(nullptr),
+      sequenceLoadCallback_(nullptr), sequenceKeyCallback_(nullptr), sequencePlayCallback_(nullptr),
+      sequenceStatusCallback_(nullptr), loopTargetCallback_(nullptr), loopGainsCallback_(nullptr),
+      loopStatusCallback_(nullptr), pwmStatusCallback_(nullptr) {
+    memset(cmdBuffer_, 0, sizeof(cmdBuffer_));
 }
 
-bool UARTCommandHandler::RingBuffer::put(char c) {
-    if (isFull()) {
-        return false; // Буфер переполнен
-    }
+void UARTCommandHandler::begin() {
+    // Установка размера буфера ДО начала Serial
+    Hal::serial().setRxBufferSize(UART_RX_BUFFER_SIZE);
+    Hal::serial().begin(UART_BAUDRATE);
     
-    data_[head_] = c;
-    head_ = (head_ + 1) % UART_RX_BUFFER_SIZE;
-    count_++;
-    return true;
-}
-
-bool UARTCommandHandler::RingBuffer::get(char* c) {
-    if (isEmpty()) {
-        return false; // Буфер пуст
-    }
+#if BUS_RS485_DE_PIN >= 0
+    // Драйвер UART сам держит DE (вывод RTS) на время передачи
+    Hal::serial().setPins(-1, -1, -1, BUS_RS485_DE_PIN);
+    Hal::serial().setMode(UART_MODE_RS485_HALF_DUPLEX);
+#endif
+    busFilter_.setAddress(BUS_NODE_ADDRESS);
+    busFilter_.startLine();
+    // На общей шине лог всех узлов сталкивался бы на линии и с ответами
+    Logger::setSerialOutput(BUS_NODE_ADDRESS == BUS_ADDRESS_NONE);
     
-    *c = data_[tail_];
-    tail_ = (tail_ + 1) % UART_RX_BUFFER_SIZE;
-    count_--;
-    return true;
-}
-
-void UARTCommandHandler::RingBuffer::clear() {
-    head_ = 0;
-    tail_ = 0;
-    count_ = 0;
-    memset(data_, 0, sizeof(data_));
-}
-
-bool UARTCommandHandler::RingBuffer::isFull() const {
-    return count_ >= UART_RX_BUFFER_SIZE;
-}
-
-bool UARTCommandHandler::RingBuffer::isEmpty() const {
-    return count_ == 0;
+    /**
+     * ПРИЁМ ПО СОБЫТИЯМ:
+     * Драйвер UART вызывает onReceive при заполнении FIFO или по таймауту
+     * тишины в UART_RX_TIMEOUT_SYMBOLS символов (~0.2 мс на 115200), то есть
+     * сразу после конца пакета. Колбэк только будит задачу UART.
+     */
+    Hal::serial().setRxTimeout(UART_RX_TIMEOUT_SYMBOLS);
+    Hal::serial().onReceive([this]() { notifyDataReceived(); }, false);
+    
+    // Выборки STREAM будят задачу так же, как приём
+    telemetry_.begin([](void* context) { static_cast<UARTCommandHandler*>(context)->notifyDataReceived(); }, this);
+    
+    Logger::info("UART initialized with ring buffer %u bytes", UART_RX_BUFFER_SIZE);
 }
 
-uint16_t UARTCommandHandler::RingBuffer::available() const {
-    return count_;
+void UARTCommandHandler::notifyDataReceived() {
+    TaskHandle_t task = rxTask_;
+    if (!task) {
+        return;
+    }
+    if (rxNotifyBits_) {
+        xTaskNotify(task, rxNotifyBits_, eSetBits);
+    } else {
+        xTaskNotifyGive(task);
+    }
 }
 
-// ============================================================================
-// Реализация обработчика UART команд
-// ============================================================================
-
-UARTCommandHandler::UARTCommandHandler() 
-    : cmdIndex_(0), setPWMCallback_(nullptr), getPWMCallback_(nullptr) {
-    memset(cmdBuffer_, 0, sizeof(cmdBuffer_));
+void UARTCommandHandler::notifyTask(TaskHandle_t task, uint32_t bits) {
+    rxNotifyBits_ = bits;
+    rxTask_ = task;
 }
 
-void UARTCommandHandler::begin() {
-    // Установка размера буфера ДО начала Serial
-    Serial.setRxBufferSize(UART_RX_BUFFER_SIZE);
-    Serial.begin(UART_BAUDRATE);
-    Logger::info("UART initialized with ring buffer " + String(UART_RX_BUFFER_SIZE) + " bytes");
+void UARTCommandHandler::waitForData(TickType_t timeout) {
+    if (!rxTask_) {
+        rxTask_ = xTaskGetCurrentTaskHandle();
+    }
+    
+    // Данные могли прийти до регистрации задачи - тогда не спим
+    if (Hal::serial().available() > 0) {
+        return;
+    }
+    ulTaskNotifyTake(pdTRUE, timeout);
 }
 
 void UARTCommandHandler::processCommands() {
-    // Шаг 1: Чтение данных из UART в кольцевой буфер
-    while (Serial.available() > 0) {
-        char c = Serial.read();
+    // Шаг 1: Чтение данных из UART порциями, пока драйвер не опустеет
+    uint8_t chunk[UART_RX_CHUNK_SIZE];
+    int available;
+    while ((available = Hal::serial().available()) > 0) {
+        size_t received = Hal::serial().read(chunk, available < (int)sizeof(chunk) ? available : sizeof(chunk));
+        rxTimeUs_ = (uint32_t)Hal::nowUs();
+        Stats::add(STAT_RX_BYTES, received);
         
-        if (!rxRingBuffer_.put(c)) {
+        if (rxRingBuffer_.write((const char*)chunk, received) < received) {
             // ПЕРЕПОЛНЕНИЕ КОЛЬЦЕВОГО БУФЕРА - критическая ошибка
             handleBufferOverflow();
             break; // Прерываем чтение чтобы стабилизировать систему
         }
+        Stats::gauge(STAT_GAUGE_UART_RX, rxRingBuffer_.available());
+        
+        processRxBuffer();
     }
     
-    // Шаг 2: Обработка данных из кольцевого буфера
-    char c;
-    while (rxRingBuffer_.get(&c)) {
-        if (c == '\n' || c == '\r') {
-            // Конец команды
-            if (cmdIndex_ > 0) {
-                cmdBuffer_[cmdIndex_] = '\0';
-                
-                // Проверка на переполнение буфера команды
-                if (cmdIndex_ >= (UART_CMD_BUFFER_SIZE - 1)) {
-                    handleCommandOverflow();
-                } else {
-                    processCommand(String(cmdBuffer_));
-                }
-                
-                cmdIndex_ = 0;
-                memset(cmdBuffer_, 0, sizeof(cmdBuffer_));
-            }
-        } else if (cmdIndex_ < (UART_CMD_BUFFER_SIZE - 1)) {
-            // Накопление символов команды
-            cmdBuffer_[cmdIndex_++] = c;
-        } else {
-            // ПЕРЕПОЛНЕНИЕ БУФЕРА КОМАНДЫ
-            handleCommandOverflow();
-            
-            // Пропускаем оставшиеся символы до конца строки
-            char temp;
-            while (rxRingBuffer_.get(&temp)) {
-                if (temp == '\n' || temp == '\r') {
-                    break;
-                }
-            }
+    // Шаг 3: Все ответы прохода - одной записью в UART
+    flushResponses();
+    
+    // Шаг 4: Выборки STREAM - после ответов, целыми записями
+    drainTelemetry();
+}
+
+void UARTCommandHandler::processRxBuffer() {
+    // Шаг 2: Сборка команд из кольцевого буфера (извлечение пачками)
+    char chunk[UART_RX_CHUNK_SIZE];
+    size_t count;
+    while ((count = rxRingBuffer_.read(chunk, sizeof(chunk))) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            processChar(chunk[i]);
         }
     }
 }
 
+void UARTCommandHandler::processChar(char c) {
+    if (binaryMode_) {
+        processBinaryByte(c);
+        return;
+    }
+    
+    if (c == '\0') {
+        cmdIndex_ = 0;
+        busFilter_.startLine();
+        if (busFilter_.address() != BUS_ADDRESS_NONE) {
+            // На общей шине кадры без адреса не принимаются: строка до нуля и хвост кадра отбрасываются
+            discardingLine_ = true;
+            return;
+        }
+        // Нулевой байт не встречается в тексте - это разделитель бинарного кадра
+        binaryMode_ = true;
+        discardingLine_ = false;
+        Logger::debug("UART: binary protocol detected");
+        return;
+    }
+    
+    bool endOfLine = (c == '\n' || c == '\r');
+    
+    if (discardingLine_) {
+        // Пропускаем оставшиеся символы слишком длинной команды или чужой строки до конца строки
+        discardingLine_ = !endOfLine;
+        if (endOfLine) {
+            busFilter_.startLine();
+        }
+        return;
+    }
+    
+    if (endOfLine) {
+        // Конец команды
+        if (cmdIndex_ > 0) {
+            cmdBuffer_[cmdIndex_] = '\0';
+            startTrace(lineStartUs_);
+            processCommand(cmdBuffer_);
+            cmdIndex_ = 0;
+        }
+        busFilter_.startLine();
+        return;
+    }
+    
+    // Адресный префикс: чужая строка отбрасывается до копирования и разбора
+    BusAddressFilter::Action action = busFilter_.feed(c);
+    if (action == BusAddressFilter::BUS_DISCARD) {
+        Stats::add(STAT_FOREIGN_LINES);
+        discardingLine_ = true;
+        return;
+    }
+    if (action == BusAddressFilter::BUS_SKIP) {
+        return;
+    }
+    
+    if (cmdIndex_ < (UART_CMD_BUFFER_SIZE - 1)) {
+        // Накопление символов команды
+        if (cmdIndex_ == 0) {
+            lineStartUs_ = rxTimeUs_;
+        }
+        cmdBuffer_[cmdIndex_++] = c;
+    } else {
+        // ПЕРЕПОЛНЕНИЕ БУФЕРА КОМАНДЫ
+        handleCommandOverflow();
+        discardingLine_ = true;
+    }
+}
+
+void UARTCommandHandler::startTrace(uint32_t rxTimeUs) {
+    // Одна трасса на строку или кадр: команды через ';' и записи кадра делят её ID
+    traceId_ = Trace::begin();
+    Trace::markAt(TRACE_UART_RX, traceId_, rxTimeUs);
+    Trace::mark(TRACE_UART_LINE, traceId_);
+}
+
+TraceOrigin UARTCommandHandler::commandOrigin() const {
+    TraceOrigin origin = { rxTimeUs_, traceId_ };
+    return origin;
+}
+
 void UARTCommandHandler::handleBufferOverflow() {
     /**
      * СТРАТЕГИЯ ОБРАБОТКИ ПЕРЕПОЛНЕНИЯ КОЛЬЦЕВОГО БУФЕРА:
@@ -123,6 +207,7 @@ void UARTCommandHandler::handleBufferOverflow() {
      * 4. Продолжаем работу в штатном режиме
      */
     Logger::error("UART ring buffer overflow detected! Clearing buffer.");
+    Stats::add(STAT_RX_OVERFLOWS);
     
     // Очистка кольцевого буфера
     rxRingBuffer_.clear();
@@ -132,7 +217,7 @@ void UARTCommandHandler::handleBufferOverflow() {
     memset(cmdBuffer_, 0, sizeof(cmdBuffer_));
     
     // Уведомление пользователя
-    sendResponse("ERROR: Buffer overflow - data lost. Please resend command.");
+    sendError("Buffer overflow - data lost. Please resend command.");
 }
 
 void UARTCommandHandler::handleCommandOverflow() {
@@ -144,16 +229,17 @@ void UARTCommandHandler::handleCommandOverflow() {
      * 4. Продолжаем обработку новых команд
      */
     Logger::error("UART command buffer overflow! Command too long.");
+    Stats::add(STAT_CMD_OVERFLOWS);
     
     // Сброс текущей команды
     cmdIndex_ = 0;
     memset(cmdBuffer_, 0, sizeof(cmdBuffer_));
     
     // Уведомление пользователя
-    sendResponse("ERROR: Command too long - maximum " + String(UART_CMD_BUFFER_SIZE - 1) + " characters allowed");
+    sendError("Command too long - maximum %d characters allowed", UART_CMD_BUFFER_SIZE - 1);
 }
 
-void UARTCommandHandler::setPWMCallback(void (*callback)(uint8_t)) {
+void UARTCommandHandler::setPWMCallback(bool (*callback)(uint8_t)) {
     setPWMCallback_ = callback;
 }
 
@@ -161,85 +247,1173 @@ void UARTCommandHandler::getPWMCallback(uint8_t (*callback)()) {
     getPWMCallback_ = callback;
 }
 
-void UARTCommandHandler::processCommand(const String& command) {
-    Logger::debug("UART command: " + command);
-    
-    String cmd = command;
-    cmd.toUpperCase();
-    cmd.trim();
+void UARTCommandHandler::setChannelPWMCallback(bool (*callback)(uint8_t, uint8_t)) {
+    setChannelPWMCallback_ = callback;
+}
+
+void UARTCommandHandler::setFadeCallback(bool (*callback)(uint8_t, uint8_t, uint32_t)) {
+    fadeCallback_ = callback;
+}
+
+void UARTCommandHandler::setPermilleCallback(bool (*callback)(uint8_t, uint16_t)) {
+    permilleCallback_ = callback;
+}
+
+void UARTCommandHandler::setPWMConfigCallback(bool (*callback)(uint8_t, uint32_t, uint8_t)) {
+    pwmConfigCallback_ = callback;
+}
+
+void UARTCommandHandler::setDitherCallback(bool (*callback)(uint8_t, bool)) {
+    ditherCallback_ = callback;
+}
+
+void UARTCommandHandler::setBatchCallback(bool (*callback)(const PWMDutyUpdate*, uint8_t)) {
+    batchCallback_ = callback;
+}
+
+void UARTCommandHandler::setSequenceLoadCallback(bool (*callback)(uint16_t)) {
+    sequenceLoadCallback_ = callback;
+}
+
+void UARTCommandHandler::setSequenceKeyCallback(bool (*callback)(const SequenceKey&)) {
+    sequenceKeyCallback_ = callback;
+}
+
+void UARTCommandHandler::setSequencePlayCallback(bool (*callback)(bool)) {
+    sequencePlayCallback_ = callback;
+}
+
+void UARTCommandHandler::setSequenceStatusCallback(void (*callback)(SequenceStatus&)) {
+    sequenceStatusCallback_ = callback;
+}
+
+void UARTCommandHandler::setLoopTargetCallback(bool (*callback)(bool, uint16_t)) {
+    loopTargetCallback_ = callback;
+}
+
+void UARTCommandHandler::setLoopGainsCallback(void (*callback)(uint32_t, uint32_t, uint32_t)) {
+    loopGainsCallback_ = callback;
+}
+
+void UARTCommandHandler::setTelemetrySource(Telemetry::SampleSource source) {
+    telemetry_.setSource(source);
+}
+
+void UARTCommandHandler::setPWMStatusCallback(void (*callback)(PWMSnapshot&)) {
+    pwmStatusCallback_ = callback;
+}
+
+void UARTCommandHandler::setLoopStatusCallback(void (*callback)(ClosedLoopStatus&)) {
+    loopStatusCallback_ = callback;
+}
+
+// ============================================================================
+// Таблица команд
+// ============================================================================
+
+namespace {
+
+const uint8_t MAX_VERB_WORDS = 2;
+
+// Флаги команд
+const uint8_t CMD_NONE = 0;
+const uint8_t CMD_TRANSACTION = 1 << 0;  // Допустима между BEGIN и COMMIT
+
+constexpr uint8_t countWords(const char* verb) {
+    uint8_t words = 1;
+    for (; *verb; verb++) {
+        if (*verb == ' ') {
+            words++;
+        }
+    }
+    return words;
+}
+
+// Сортировка вставками при компиляции: таблица маленькая, порядок строк в исходнике свободный
+template <typename Spec, size_t N>
+constexpr std::array<Spec, N> sortByHash(const Spec (&list)[N]) {
+    std::array<Spec, N> sorted{};
+    for (size_t i = 0; i < N; i++) {
+        size_t j = i;
+        while (j > 0 && sorted[j - 1].hash > list[i].hash) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = list[i];
+    }
+    return sorted;
+}
+
+template <typename Spec, size_t N>
+constexpr bool hashesUnique(const std::array<Spec, N>& table) {
+    for (size_t i = 1; i < N; i++) {
+        if (table[i - 1].hash == table[i].hash) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+#define UART_COMMAND(verb, minArgs, maxArgs, flags, method, usage) \
+    { CommandParser::verbHash(verb), verb, countWords(verb), minArgs, maxArgs, flags, &UARTCommandHandler::method, usage }
+
+const UARTCommandHandler::CommandSpec* UARTCommandHandler::findCommand(const CommandParser::Tokens& tokens) {
+    /**
+     * РЕГИСТРАЦИЯ КОМАНД:
+     * Новая команда - одна строка в таблице и метод-обработчик.
+     * 1. Хеши глаголов считаются при компиляции, таблица сортируется по ним
+     * 2. Коллизия хешей двух глаголов - ошибка компиляции
+     * 3. Число параметров проверяется до вызова обработчика, при ошибке
+     *    в ответ уходит usage
+     * 4. Внутри BEGIN/COMMIT допускаются только команды с CMD_TRANSACTION
+     */
+    static constexpr CommandSpec COMMANDS[] = {
+        UART_COMMAND("SET PWM",      1, 2, CMD_TRANSACTION, handleSetPWM,       "SET PWM [CH] X (0-100)"),
+        UART_COMMAND("GET PWM",      0, 0, CMD_TRANSACTION, handleGetPWM,       "GET PWM"),
+        UART_COMMAND("FADE PWM",     2, 3, CMD_NONE,        handleFadePWM,      "FADE PWM [CH] X MS"),
+        UART_COMMAND("SET PERMILLE", 1, 2, CMD_NONE,        handleSetPermille,  "SET PERMILLE [CH] X (0-1000)"),
+        UART_COMMAND("SET PWMCFG",   3, 3, CMD_NONE,        handleSetPWMConfig, "SET PWMCFG CH HZ BITS"),
+        UART_COMMAND("SET DITHER",   2, 2, CMD_NONE,        handleSetDither,    "SET DITHER CH 0|1"),
+        UART_COMMAND("SET LOG",      1, 1, CMD_NONE,        handleSetLog,       "SET LOG TEXT|BIN"),
+        UART_COMMAND("SET ADDRESS",  1, 1, CMD_NONE,        handleSetAddress,   "SET ADDRESS N (1-199, 0 - none)"),
+        UART_COMMAND("SET GROUP",    2, 2, CMD_NONE,        handleSetGroup,     "SET GROUP G (200-254) 0|1"),
+        UART_COMMAND("GET NODE",     0, 0, CMD_NONE,        handleGetNode,      "GET NODE"),
+        UART_COMMAND("SET TARGET",   1, 1, CMD_NONE,        handleSetTarget,    "SET TARGET PERMILLE|OFF"),
+        UART_COMMAND("SET GAINS",    3, 3, CMD_NONE,        handleSetGains,     "SET GAINS KP KI KD (milli)"),
+        UART_COMMAND("GET LOOP",     0, 0, CMD_NONE,        handleGetLoop,      "GET LOOP"),
+        UART_COMMAND("SEQ LOAD",     0, 1, CMD_NONE,        handleSeqLoad,      "SEQ LOAD [LOOPS] (0 - forever)"),
+        UART_COMMAND("SEQ KEY",      3, 4, CMD_NONE,        handleSeqKey,       "SEQ KEY CH PERMILLE DELAY_US [STEP|RAMP]"),
+        UART_COMMAND("SEQ PLAY",     0, 0, CMD_NONE,        handleSeqPlay,      "SEQ PLAY"),
+        UART_COMMAND("SEQ STOP",     0, 0, CMD_NONE,        handleSeqStop,      "SEQ STOP"),
+        UART_COMMAND("SEQ STATUS",   0, 0, CMD_NONE,        handleSeqStatus,    "SEQ STATUS"),
+        UART_COMMAND("MEM",          0, 0, CMD_NONE,        handleMem,          "MEM"),
+        UART_COMMAND("STATS",        0, 1, CMD_NONE,        handleStats,        "STATS [RESET]"),
+        UART_COMMAND("TRACE",        1, 1, CMD_NONE,        handleTrace,        "TRACE DUMP|CLEAR|ON|OFF"),
+        UART_COMMAND("STREAM",       0, 3, CMD_NONE,        handleStream,       "STREAM [FIELDS|ALL HZ [TEXT|BIN]|OFF]"),
+        UART_COMMAND("BEGIN",        0, 0, CMD_NONE,        handleBegin,        "BEGIN"),
+        UART_COMMAND("COMMIT",       0, 0, CMD_TRANSACTION, handleCommit,       "COMMIT"),
+        UART_COMMAND("ABORT",        0, 0, CMD_TRANSACTION, handleAbort,        "ABORT"),
+    };
+    static constexpr auto TABLE = sortByHash(COMMANDS);
+    static_assert(hashesUnique(TABLE), "UART command verb hash collision");
     
-    if (cmd.startsWith("SET PWM")) {
-        handleSetPWM(cmd.substring(7));
-    } else if (cmd == "GET PWM") {
-        handleGetPWM();
-    } else if (cmd.length() > 0) {
-        sendResponse("ERROR: Unknown command");
-        Logger::error("Unknown UART command: " + command);
+    // Сначала самый длинный глагол, затем короче
+    for (uint8_t words = tokens.count < MAX_VERB_WORDS ? tokens.count : MAX_VERB_WORDS; words > 0; words--) {
+        uint32_t hash = CommandParser::wordsHash(tokens.words, words);
+        
+        // Двоичный поиск по отсортированной таблице
+        size_t low = 0;
+        size_t high = TABLE.size();
+        while (low < high) {
+            size_t middle = (low + high) / 2;
+            if (TABLE[middle].hash < hash) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        
+        if (low < TABLE.size() && TABLE[low].hash == hash && TABLE[low].verbWords == words &&
+            CommandParser::wordsEqual(TABLE[low].verb, tokens.words, words)) {
+            return &TABLE[low];
+        }
     }
+    return nullptr;
 }
 
-void UARTCommandHandler::sendResponse(const String& response) {
-    Serial.println(response);
+#undef UART_COMMAND
+
+void UARTCommandHandler::processCommand(char* line) {
+    Logger::debug("UART command: %s", line);
+    
+    // Несколько команд в строке через ';' выполняются по порядку
+    char* command = line;
+    while (command) {
+        char* next = strchr(command, ';');
+        if (next) {
+            *next++ = '\0';
+        }
+        executeCommand(command);
+        command = next;
+    }
 }
 
-void UARTCommandHandler::handleSetPWM(const String& parameters) {
-    if (!setPWMCallback_) {
-        sendResponse("ERROR: PWM callback not set");
+void UARTCommandHandler::executeCommand(char* line) {
+    // Разбор на месте: слова остаются в cmdBuffer_, куча не используется
+    CommandParser::Tokens tokens;
+    if (!CommandParser::tokenize(line, tokens)) {
+        sendError("Too many parameters");
+        return;
+    }
+    if (tokens.count == 0) {
         return;
     }
+    Stats::add(STAT_COMMANDS);
+    Trace::mark(TRACE_UART_PARSE, traceId_);
     
-    String params = parameters;
-    params.trim();
+    const CommandSpec* command = findCommand(tokens);
+    if (!command) {
+        sendError("Unknown command");
+        Logger::error("Unknown UART command: %s", tokens.words[0]);
+        return;
+    }
+    
+    if (transactionOpen_ && !(command->flags & CMD_TRANSACTION)) {
+        sendError("%s is not allowed inside BEGIN/COMMIT", command->verb);
+        return;
+    }
+    
+    CommandArgs args = { tokens.words + command->verbWords, (uint8_t)(tokens.count - command->verbWords) };
+    if (args.count < command->minArgs || args.count > command->maxArgs) {
+        sendError("Usage: %s", command->usage);
+        return;
+    }
+    
+    Trace::mark(TRACE_UART_DISPATCH, traceId_);
+    (this->*command->method)(args);
+}
+
+void UARTCommandHandler::sendResponse(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    queueResponse(format, args);
+    va_end(args);
+}
+
+void UARTCommandHandler::sendError(const char* format, ...) {
+    // Любая ошибка внутри транзакции делает её невыполнимой целиком
+    if (transactionOpen_) {
+        transactionFailed_ = true;
+    }
+    Stats::add(STAT_COMMAND_ERRORS);
+    
+    char message[UART_RESPONSE_SIZE];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    sendResponse("ERROR: %s", message);
+}
+
+void UARTCommandHandler::queueResponse(const char* format, va_list args) {
+    // Широковещательные и групповые команды выполняются без ответа - иначе узлы столкнутся на линии
+    BusReply reply = busFilter_.reply();
+    if (reply == BUS_REPLY_SILENT) {
+        return;
+    }
     
-    // Проверка на пустые параметры
-    if (params.length() == 0) {
-        sendResponse("ERROR: Missing PWM value. Usage: SET PWM X (0-100)");
+    char response[UART_RESPONSE_SIZE + 2];
+    int prefix = 0;
+    if (reply == BUS_REPLY_ADDRESSED) {
+        prefix = snprintf(response, UART_RESPONSE_SIZE, "@%u ", busFilter_.target());
+    }
+    int length = vsnprintf(response + prefix, UART_RESPONSE_SIZE - prefix, format, args);
+    if (length < 0) {
+        return;
+    }
+    length += prefix;
+    if (length >= UART_RESPONSE_SIZE) {
+        length = UART_RESPONSE_SIZE - 1;
+    }
+    response[length++] = '\r';
+    response[length++] = '\n';
+    queueBytes((const uint8_t*)response, length);
+}
+
+void UARTCommandHandler::queueBytes(const uint8_t* data, size_t length) {
+    if (txLength_ + length > sizeof(txBuffer_)) {
+        flushResponses();
+    }
+    memcpy(txBuffer_ + txLength_, data, length);
+    txLength_ += length;
+}
+
+void UARTCommandHandler::flushResponses() {
+    if (txLength_ > 0) {
+        Hal::serial().write((const uint8_t*)txBuffer_, txLength_);
+        txLength_ = 0;
+    }
+}
+
+void UARTCommandHandler::drainTelemetry() {
+    /**
+     * Запись уходит, только если целиком помещается в буфер передачи
+     * драйвера: Hal::serial().write не блокирует задачу, а выборка не рвётся
+     * посередине. Остаток ждёт следующего прохода - его запустит
+     * следующая выборка или приём.
+     */
+    uint8_t record[Telemetry::RECORD_MAX];
+    size_t length;
+    while ((length = telemetry_.peek(record, sizeof(record))) > 0) {
+        if (Hal::serial().availableForWrite() < (int)length) {
+            break;
+        }
+        Hal::serial().write(record, length);
+        telemetry_.consume(length);
+    }
+}
+
+void UARTCommandHandler::handleSetPWM(const CommandArgs& args) {
+    uint32_t values[2];
+    if (!parseArgs(args, values)) {
         return;
     }
     
-    int pwmValue;
-    if (validateNumber(params, pwmValue)) {
-        if (pwmValue >= 0 && pwmValue <= 100) {
-            setPWMCallback_(pwmValue);
+    // Форма "SET PWM <ch> <value>" - адресная установка канала
+    if (args.count == 2) {
+        uint32_t channel = values[0];
+        uint32_t pwmValue = values[1];
+        
+        if (!setChannelPWMCallback_ && !transactionOpen_) {
+            sendError("PWM channel callback not set");
+            return;
+        }
+        if (channel >= PWM_MAX_CHANNELS) {
+            sendError("PWM channel must be 0-%d", PWM_MAX_CHANNELS - 1);
+            return;
+        }
+        if (pwmValue > 100) {
+            sendError("PWM value must be 0-100");
+            Logger::error("UART: Invalid PWM value %lu", (unsigned long)pwmValue);
+            return;
+        }
+        
+        if (transactionOpen_) {
+            stageDuty(channel, pwmValue);
+        } else if (setChannelPWMCallback_(channel, pwmValue)) {
             sendResponse("OK");
-            Logger::info("UART: PWM set to " + String(pwmValue) + "%");
+            Logger::info("UART: PWM[%lu] set to %lu%%", (unsigned long)channel, (unsigned long)pwmValue);
         } else {
-            sendResponse("ERROR: PWM value must be 0-100");
-            Logger::error("UART: Invalid PWM value " + String(pwmValue));
+            sendChannelError(channel);
         }
+        return;
+    }
+    
+    if (!setPWMCallback_ && !transactionOpen_) {
+        sendError("PWM callback not set");
+        return;
+    }
+    
+    uint32_t pwmValue = values[0];
+    if (pwmValue <= 100 && transactionOpen_) {
+        stageDuty(0, pwmValue);
+    } else if (pwmValue <= 100 && !setPWMCallback_(pwmValue)) {
+        sendChannelError(0);
+    } else if (pwmValue <= 100) {
+        sendResponse("OK");
+        Logger::info("UART: PWM set to %lu%%", (unsigned long)pwmValue);
     } else {
-        sendResponse("ERROR: Invalid number format");
-        Logger::error("UART: Invalid number format: " + params);
+        sendError("PWM value must be 0-100");
+        Logger::error("UART: Invalid PWM value %lu", (unsigned long)pwmValue);
     }
 }
 
-void UARTCommandHandler::handleGetPWM() {
+void UARTCommandHandler::handleGetPWM(const CommandArgs& args) {
     if (!getPWMCallback_) {
-        sendResponse("ERROR: PWM callback not set");
+        sendError("PWM callback not set");
         return;
     }
     
     uint8_t pwmValue = getPWMCallback_();
-    sendResponse(String(pwmValue));
-    Logger::debug("UART: GET PWM returned " + String(pwmValue));
+    sendResponse("%u", pwmValue);
+    Logger::debug("UART: GET PWM returned %u", pwmValue);
 }
 
-bool UARTCommandHandler::validateNumber(const String& str, int& value) {
-    String numStr = str;
-    numStr.trim();
+void UARTCommandHandler::handleFadePWM(const CommandArgs& args) {
+    if (!fadeCallback_) {
+        sendError("Fade callback not set");
+        return;
+    }
     
-    // Проверка на пустую строку
-    if (numStr.length() == 0) {
-        return false;
+    // Разбор "FADE PWM [CH] X MS" на 2 или 3 числа
+    uint32_t values[3];
+    if (!parseArgs(args, values)) {
+        return;
     }
     
-    // Проверка что все символы - цифры
-    for (size_t i = 0; i < numStr.length(); i++) {
-        if (!isdigit(numStr[i])) {
-            return false;
+    uint32_t channel = args.count == 3 ? values[0] : 0;
+    uint32_t pwmValue = values[args.count - 2];
+    uint32_t durationMs = values[args.count - 1];
+    
+    if (channel >= PWM_MAX_CHANNELS || pwmValue > 100 || durationMs > PWM_FADE_MAX_MS) {
+        sendError("Usage: FADE PWM [CH] X MS (0-100, 0-%d)", PWM_FADE_MAX_MS);
+        return;
+    }
+    
+    if (fadeCallback_(channel, pwmValue, durationMs)) {
+        sendResponse("OK");
+        Logger::info("UART: PWM[%lu] fading to %lu%% in %lu ms",
+                     (unsigned long)channel, (unsigned long)pwmValue, (unsigned long)durationMs);
+    } else {
+        sendChannelError(channel);
+    }
+}
+
+void UARTCommandHandler::handleSetPermille(const CommandArgs& args) {
+    if (!permilleCallback_) {
+        sendError("Permille callback not set");
+        return;
+    }
+    
+    uint32_t values[2];
+    if (!parseArgs(args, values)) {
+        return;
+    }
+    
+    uint32_t channel = args.count == 2 ? values[0] : 0;
+    uint32_t permille = values[args.count - 1];
+    
+    if (channel >= PWM_MAX_CHANNELS || permille > 1000) {
+        sendError("Usage: SET PERMILLE [CH] X (0-1000)");
+        return;
+    }
+    
+    if (permilleCallback_(channel, permille)) {
+        sendResponse("OK");
+    } else {
+        sendChannelError(channel);
+    }
+}
+
+void UARTCommandHandler::handleSetPWMConfig(const CommandArgs& args) {
+    if (!pwmConfigCallback_) {
+        sendError("PWM config callback not set");
+        return;
+    }
+    
+    uint32_t values[3];
+    if (!parseArgs(args, values)) {
+        return;
+    }
+    
+    if (values[0] >= PWM_MAX_CHANNELS || values[2] > PWM_MAX_RESOLUTION) {
+        sendError("Usage: SET PWMCFG CH HZ BITS (1-%d bits)", PWM_MAX_RESOLUTION);
+        return;
+    }
+    
+    if (pwmConfigCallback_(values[0], values[1], values[2])) {
+        sendResponse("OK");
+        Logger::info("UART: PWM[%lu] %lu Hz, %lu bit",
+                     (unsigned long)values[0], (unsigned long)values[1], (unsigned long)values[2]);
+    } else {
+        sendError("Unsupported frequency/resolution for channel %lu", (unsigned long)values[0]);
+    }
+}
+
+void UARTCommandHandler::handleSetDither(const CommandArgs& args) {
+    if (!ditherCallback_) {
+        sendError("Dither callback not set");
+        return;
+    }
+    
+    uint32_t values[2];
+    if (!parseArgs(args, values)) {
+        return;
+    }
+    
+    if (values[0] >= PWM_MAX_CHANNELS || values[1] > 1) {
+        sendError("Usage: SET DITHER CH 0|1");
+        return;
+    }
+    
+    if (ditherCallback_(values[0], values[1] == 1)) {
+        sendResponse("OK");
+    } else {
+        sendError("PWM channel %lu not configured", (unsigned long)values[0]);
+    }
+}
+
+void UARTCommandHandler::handleSetLog(const CommandArgs& args) {
+    bool binary = strcmp(args.words[0], "BIN") == 0;
+    if (!binary && strcmp(args.words[0], "TEXT") != 0) {
+        sendError("Usage: SET LOG TEXT|BIN");
+        return;
+    }
+    
+    // Ответ уходит до переключения, чтобы хост увидел его в прежнем формате
+    sendResponse("OK");
+    flushResponses();
+    Logger::setBinaryMode(binary);
+}
+
+void UARTCommandHandler::handleSetAddress(const CommandArgs& args) {
+    uint32_t address;
+    if (!parseArgs(args, &address)) {
+        return;
+    }
+    if (address > BUS_ADDRESS_MAX) {
+        sendError("Address must be 1-%u or 0", BUS_ADDRESS_MAX);
+        return;
+    }
+    
+    // Ответ уходит в режиме текущей строки: "@12 SET ADDRESS 13" отвечает от имени 12
+    busFilter_.setAddress((uint8_t)address);
+    Logger::info("UART bus address: %lu", (unsigned long)address);
+    Logger::setSerialOutput(address == BUS_ADDRESS_NONE);
+    sendResponse("OK");
+}
+
+void UARTCommandHandler::handleSetGroup(const CommandArgs& args) {
+    uint32_t values[2];
+    if (!parseArgs(args, values)) {
+        return;
+    }
+    if (values[1] > 1 || values[0] > 0xFF || !busFilter_.setGroup((uint8_t)values[0], values[1] != 0)) {
+        sendError("Usage: SET GROUP G (%u-%u) 0|1", BUS_GROUP_FIRST, BUS_GROUP_LAST);
+        return;
+    }
+    sendResponse("OK");
+}
+
+void UARTCommandHandler::handleGetNode(const CommandArgs& args) {
+    // NODE ADDRESS <адрес> GROUPS <группа>,... (- если групп нет)
+    char line[UART_RESPONSE_SIZE];
+    int length = snprintf(line, sizeof(line), "NODE ADDRESS %u GROUPS ", busFilter_.address());
+    bool any = false;
+    for (uint16_t group = BUS_GROUP_FIRST; group <= BUS_GROUP_LAST && length < (int)sizeof(line) - 5; group++) {
+        if (busFilter_.isGroupMember((uint8_t)group)) {
+            length += snprintf(line + length, sizeof(line) - length, any ? ",%u" : "%u", group);
+            any = true;
+        }
+    }
+    sendResponse("%s%s", line, any ? "" : "-");
+}
+
+void UARTCommandHandler::handleSeqLoad(const CommandArgs& args) {
+    if (!sequenceLoadCallback_) {
+        sendError("Sequence callback not set");
+        return;
+    }
+    
+    uint32_t loops = 0;
+    if (args.count == 1 && !parseArgs(args, &loops)) {
+        return;
+    }
+    if (loops > UINT16_MAX) {
+        sendError("Usage: SEQ LOAD [LOOPS] (0-%u)", UINT16_MAX);
+        return;
+    }
+    
+    if (sequenceLoadCallback_(loops)) {
+        sendResponse("OK");
+    } else {
+        sendError("Sequence is playing - SEQ STOP first");
+    }
+}
+
+void UARTCommandHandler::handleSeqKey(const CommandArgs& args) {
+    if (!sequenceKeyCallback_) {
+        sendError("Sequence callback not set");
+        return;
+    }
+    
+    // Разбор "SEQ KEY CH PERMILLE DELAY_US [STEP|RAMP]": режим - слово, остальное числа
+    SequenceMode mode = SEQ_MODE_STEP;
+    if (args.count == 4) {
+        if (strcmp(args.words[3], "RAMP") == 0) {
+            mode = SEQ_MODE_RAMP;
+        } else if (strcmp(args.words[3], "STEP") != 0) {
+            sendError("Usage: SEQ KEY CH PERMILLE DELAY_US [STEP|RAMP]");
+            return;
         }
     }
     
-    value = numStr.toInt();
+    uint32_t values[3];
+    CommandArgs numbers = { args.words, 3 };
+    if (!parseArgs(numbers, values)) {
+        return;
+    }
+    if (values[0] >= PWM_MAX_CHANNELS || values[1] > 1000) {
+        sendError("Usage: SEQ KEY CH PERMILLE DELAY_US [STEP|RAMP]");
+        return;
+    }
+    
+    SequenceKey key = { values[2], DUTY_FROM_PERMILLE.values[values[1]], (uint8_t)values[0], mode };
+    if (sequenceKeyCallback_(key)) {
+        sendResponse("OK");
+    } else {
+        sendError("Key rejected: playing, channel off, closed loop or twice in group, %u keys max",
+                  PWM_SEQ_MAX_KEYS);
+    }
+}
+
+void UARTCommandHandler::handleSeqPlay(const CommandArgs& args) {
+    if (!sequencePlayCallback_) {
+        sendError("Sequence callback not set");
+        return;
+    }
+    
+    if (sequencePlayCallback_(true)) {
+        sendResponse("OK");
+    } else {
+        sendError("No sequence loaded, zero period or a key on the closed loop channel");
+    }
+}
+
+void UARTCommandHandler::handleSeqStop(const CommandArgs& args) {
+    if (!sequencePlayCallback_) {
+        sendError("Sequence callback not set");
+        return;
+    }
+    
+    sequencePlayCallback_(false);
+    sendResponse("OK");
+}
+
+void UARTCommandHandler::handleSeqStatus(const CommandArgs& args) {
+    if (!sequenceStatusCallback_) {
+        sendError("Sequence callback not set");
+        return;
+    }
+    
+    SequenceStatus status;
+    sequenceStatusCallback_(status);
+    sendResponse("SEQ %s KEYS %u POS %u LOOP %u/%u PERIOD_US %lu LATE_MAX_US %lu",
+                 status.playing ? "PLAYING" : "STOPPED", status.keys, status.position,
+                 status.loopsDone, status.loops, (unsigned long)status.periodUs,
+                 (unsigned long)status.maxLateUs);
+}
+
+void UARTCommandHandler::handleSetTarget(const CommandArgs& args) {
+    if (!loopTargetCallback_) {
+        sendError("Loop callback not set");
+        return;
+    }
+    
+    if (strcmp(args.words[0], "OFF") == 0) {
+        loopTargetCallback_(false, 0);
+        sendResponse("OK");
+        return;
+    }
+    
+    // Задание - в промилле полной шкалы обратной связи
+    uint32_t permille;
+    if (!parseArgs(args, &permille)) {
+        return;
+    }
+    if (permille > 1000) {
+        sendError("Usage: SET TARGET PERMILLE|OFF (0-1000)");
+        return;
+    }
+    
+    if (loopTargetCallback_(true, DUTY_FROM_PERMILLE.values[permille])) {
+        sendResponse("OK");
+    } else {
+        sendError("Closed loop unavailable: channel %u off or used by a playing sequence", PWM_LOOP_CHANNEL);
+    }
+}
+
+void UARTCommandHandler::handleSetGains(const CommandArgs& args) {
+    if (!loopGainsCallback_) {
+        sendError("Loop callback not set");
+        return;
+    }
+    
+    uint32_t values[3];
+    if (!parseArgs(args, values)) {
+        return;
+    }
+    
+    // Ограничения держат коэффициенты Q16.16 на такт в int32 (Kd умножается на частоту)
+    const uint32_t maxMilli = 1000000UL;
+    const uint32_t maxKdMilli = 32000000UL / PWM_LOOP_RATE_HZ;
+    if (values[0] > maxMilli || values[1] > maxMilli || values[2] > maxKdMilli) {
+        sendError("Usage: SET GAINS KP KI KD (KP, KI 0-%lu, KD 0-%lu milli)",
+                  (unsigned long)maxMilli, (unsigned long)maxKdMilli);
+        return;
+    }
+    
+    loopGainsCallback_(values[0], values[1], values[2]);
+    sendResponse("OK");
+}
+
+void UARTCommandHandler::handleGetLoop(const CommandArgs& args) {
+    if (!loopStatusCallback_) {
+        sendError("Loop callback not set");
+        return;
+    }
+    
+    ClosedLoopStatus status;
+    loopStatusCallback_(status);
+    sendResponse("LOOP %s CH %u TARGET %u MEAS %u OUT %u SAT %u", status.enabled ? "ON" : "OFF",
+                 status.channel, dutyToPermille(status.target), dutyToPermille(status.measurement),
+                 dutyToPermille(status.output), status.saturated);
+    sendResponse("LOOP TICKS %lu PERIOD_US %ld..%ld BUSY_MAX_US %lu", (unsigned long)status.ticks,
+                 (long)status.periodMinUs, (long)status.periodMaxUs, (unsigned long)status.busyMaxUs);
+}
+
+void UARTCommandHandler::handleMem(const CommandArgs& args) {
+    // Минимум свободного стека за всё время работы - запас, на который можно уменьшить стек
+    for (uint8_t id = 0; id < Rtos::TASK_COUNT; id++) {
+        TaskHandle_t task = Rtos::taskHandle((Rtos::TaskId)id);
+        if (!task) {
+            continue;
+        }
+        const Rtos::TaskSpec& spec = Rtos::TASK_TABLE[id];
+        sendResponse("MEM TASK %s stack %lu free %lu core %d", spec.name, (unsigned long)spec.stackBytes,
+                     (unsigned long)uxTaskGetStackHighWaterMark(task), (int)spec.core);
+    }
+    sendResponse("MEM HEAP free %lu min %lu", (unsigned long)esp_get_free_heap_size(),
+                 (unsigned long)esp_get_minimum_free_heap_size());
+}
+
+void UARTCommandHandler::handleStats(const CommandArgs& args) {
+    if (args.count == 1) {
+        if (strcmp(args.words[0], "RESET") != 0) {
+            sendError("Usage: STATS [RESET]");
+            return;
+        }
+        Stats::reset();
+        sendResponse("OK");
+        return;
+    }
+    
+    uint32_t elapsedMs = Stats::sinceResetMs();
+    sendResponse("STATS UPTIME_MS %lu", (unsigned long)elapsedMs);
+    for (uint8_t id = 0; id < STAT_COUNTER_COUNT; id++) {
+        sendResponse("STATS COUNTER %s %lu", Stats::counterName((StatCounter)id),
+                     (unsigned long)Stats::counter((StatCounter)id));
+    }
+    sendResponse("STATS COUNTER LOG_DROPPED %lu", (unsigned long)Logger::droppedCount());
+    
+    // Владелец ШИМ считает с запуска, STATS RESET эти значения не обнуляет
+    if (pwmStatusCallback_) {
+        PWMSnapshot pwm;
+        pwmStatusCallback_(pwm);
+        sendResponse("STATS PWM APPLIED %lu REJECTED %lu DROPPED %lu FADING 0x%04X",
+                     (unsigned long)pwm.applied, (unsigned long)pwm.rejected, (unsigned long)pwm.dropped,
+                     (unsigned)pwm.fadingMask);
+        sendResponse("STATS PWM LATENCY_US LAST %lu MAX %lu",
+                     (unsigned long)pwm.lastLatencyUs, (unsigned long)pwm.maxLatencyUs);
+    }
+    
+    uint32_t perSecond = elapsedMs ? (uint32_t)((uint64_t)Stats::counter(STAT_COMMANDS) * 1000 / elapsedMs) : 0;
+    sendResponse("STATS RATE COMMANDS_PER_S %lu", (unsigned long)perSecond);
+    
+    // Доля CPU - время работы циклов задачи к интервалу с последнего сброса, в промилле
+    for (uint8_t id = 0; id < Rtos::TASK_COUNT; id++) {
+        Stats::TaskTime time = Stats::taskTime((Rtos::TaskId)id);
+        if (!Rtos::taskHandle((Rtos::TaskId)id) || time.loops == 0) {
+            continue;
+        }
+        uint32_t permille = elapsedMs ? (uint32_t)((uint64_t)time.busyUs / elapsedMs) : 0;
+        sendResponse("STATS TASK %s LOOPS %lu AVG_US %lu MAX_US %lu PERMILLE %lu",
+                     Rtos::TASK_TABLE[id].name, (unsigned long)time.loops,
+                     (unsigned long)(time.busyUs / time.loops), (unsigned long)time.maxLoopUs,
+                     (unsigned long)permille);
+    }
+    
+    for (uint8_t id = 0; id < STAT_GAUGE_COUNT; id++) {
+        Stats::Gauge gauge = Stats::gaugeValue((StatGauge)id);
+        sendResponse("STATS QUEUE %s DEPTH %lu MAX %lu", Stats::gaugeName((StatGauge)id),
+                     (unsigned long)gauge.current, (unsigned long)gauge.max);
+    }
+    
+    for (uint8_t id = 0; id < STAT_HIST_COUNT; id++) {
+        sendHistogram((StatHistogram)id);
+    }
+}
+
+void UARTCommandHandler::sendHistogram(StatHistogram id) {
+    /**
+     * ФОРМАТ ГИСТОГРАММЫ:
+     * STATS HIST <имя> MAX <мкс> <i>:<число> ... - только непустые корзины,
+     * корзина i - значения меньше 2^i мкс (и не меньше 2^(i-1)).
+     * Длинный список переносится на следующую строку с тем же префиксом.
+     */
+    Stats::Histogram histogram;
+    Stats::histogram(id, histogram);
+    
+    char line[UART_RESPONSE_SIZE];
+    int prefix = snprintf(line, sizeof(line), "STATS HIST %s", Stats::histogramName(id));
+    int length = prefix + snprintf(line + prefix, sizeof(line) - prefix, " MAX %lu", (unsigned long)histogram.max);
+    
+    for (uint8_t bucket = 0; bucket < STATS_HIST_BUCKETS; bucket++) {
+        if (histogram.buckets[bucket] == 0) {
+            continue;
+        }
+        char item[16];
+        int itemLength = snprintf(item, sizeof(item), " %u:%lu", bucket, (unsigned long)histogram.buckets[bucket]);
+        if (length + itemLength >= (int)sizeof(line)) {
+            sendResponse("%s", line);
+            length = prefix;
+        }
+        memcpy(line + length, item, itemLength + 1);
+        length += itemLength;
+    }
+    sendResponse("%s", line);
+}
+
+void UARTCommandHandler::handleTrace(const CommandArgs& args) {
+    const char* action = args.words[0];
+    if (strcmp(action, "CLEAR") == 0) {
+        Trace::clear();
+    } else if (strcmp(action, "ON") == 0) {
+        Trace::setEnabled(true);
+    } else if (strcmp(action, "OFF") == 0) {
+        Trace::setEnabled(false);
+    } else if (strcmp(action, "DUMP") != 0) {
+        sendError("Usage: TRACE DUMP|CLEAR|ON|OFF");
+        return;
+    } else {
+        /**
+         * ФОРМАТ ВЫГРУЗКИ (разбирает tools/trace_json.py):
+         * TRACE BEGIN <записей> <потеряно> <текущее время, мкс>
+         * TRACE <время, мкс> <ID> <этап> <arg>   - от старой записи к новой
+         * TRACE END
+         * Запись останавливается на время выгрузки, иначе кольцо перезапишется под чтением.
+         */
+        bool wasEnabled = Trace::isEnabled();
+        Trace::setEnabled(false);
+        
+        uint16_t count = Trace::available();
+        sendResponse("TRACE BEGIN %u %lu %lu", count, (unsigned long)Trace::lost(),
+                     (unsigned long)Hal::nowUs());
+        TraceRecord record;
+        for (uint16_t i = 0; i < count && Trace::read(i, record); i++) {
+            sendResponse("TRACE %lu %u %s %u", (unsigned long)record.timeUs, record.id,
+                         Trace::stageName(record.stage), record.arg);
+        }
+        sendResponse("TRACE END");
+        
+        Trace::setEnabled(wasEnabled);
+        return;
+    }
+    sendResponse("OK");
+}
+
+void UARTCommandHandler::handleStream(const CommandArgs& args) {
+    if (args.count == 0) {
+        sendResponse("STREAM %s FIELDS 0x%02X HZ %u %s SAMPLES %lu DROPPED %lu",
+                     telemetry_.isRunning() ? "ON" : "OFF", telemetry_.fields(), telemetry_.rateHz(),
+                     telemetry_.isBinary() ? "BIN" : "TEXT", (unsigned long)telemetry_.sampleCount(),
+                     (unsigned long)telemetry_.droppedCount());
+        return;
+    }
+    if (args.count == 1 && strcmp(args.words[0], "OFF") == 0) {
+        telemetry_.stop();
+        sendResponse("OK");
+        return;
+    }
+    
+    // Поток запускается только строкой этому узлу: по "@*" потоки всех узлов столкнулись бы на линии
+    if (busFilter_.reply() == BUS_REPLY_SILENT) {
+        sendError("STREAM needs a node address");
+        return;
+    }
+    
+    // Разбор "STREAM DUTY,BUTTON,COUNTERS HZ [TEXT|BIN]": поля через запятую или ALL
+    uint8_t fields = 0;
+    bool binary = false;
+    uint32_t rateHz = 0;
+    bool valid = args.count >= 2 && CommandParser::parseUnsigned(args.words[1], rateHz);
+    if (valid && args.count == 3) {
+        binary = strcmp(args.words[2], "BIN") == 0;
+        valid = binary || strcmp(args.words[2], "TEXT") == 0;
+    }
+    for (char* field = args.words[0]; valid && *field; ) {
+        char* next = strchr(field, ',');
+        if (next) {
+            *next++ = '\0';
+        }
+        if (strcmp(field, "DUTY") == 0) {
+            fields |= TELEMETRY_DUTY;
+        } else if (strcmp(field, "BUTTON") == 0) {
+            fields |= TELEMETRY_BUTTON;
+        } else if (strcmp(field, "COUNTERS") == 0) {
+            fields |= TELEMETRY_COUNTERS;
+        } else if (strcmp(field, "ALL") == 0) {
+            fields |= TELEMETRY_ALL;
+        } else {
+            valid = false;
+        }
+        field = next ? next : field + strlen(field);
+    }
+    if (!valid || fields == 0) {
+        sendError("Usage: STREAM DUTY,BUTTON,COUNTERS|ALL HZ [TEXT|BIN] or STREAM OFF");
+        return;
+    }
+    if (rateHz == 0 || rateHz > TELEMETRY_MAX_RATE_HZ) {
+        sendError("Rate must be 1-%u Hz", TELEMETRY_MAX_RATE_HZ);
+        return;
+    }
+    
+    if (telemetry_.start(fields, (uint16_t)rateHz, binary)) {
+        sendResponse("OK");
+    } else {
+        sendError("Telemetry source not set");
+    }
+}
+
+void UARTCommandHandler::handleBegin(const CommandArgs& args) {
+    if (transactionOpen_) {
+        sendError("Transaction already open");
+        return;
+    }
+    
+    transactionOpen_ = true;
+    transactionFailed_ = false;
+    stagedCount_ = 0;
+    sendResponse("OK");
+}
+
+void UARTCommandHandler::handleCommit(const CommandArgs& args) {
+    /**
+     * СТРАТЕГИЯ ФИКСАЦИИ ТРАНЗАКЦИИ:
+     * 1. Транзакция закрывается в любом случае
+     * 2. Если внутри была ошибка - не применяем ничего
+     * 3. Иначе все накопленные каналы уходят одним пакетом applyBatch:
+     *    переключение в одном периоде ШИМ, либо отказ целиком
+     */
+    if (!transactionOpen_) {
+        sendError("COMMIT without BEGIN");
+        return;
+    }
+    transactionOpen_ = false;
+    
+    if (transactionFailed_) {
+        sendError("Transaction aborted - %u changes discarded", stagedCount_);
+        return;
+    }
+    if (stagedCount_ == 0) {
+        sendResponse("OK");
+        return;
+    }
+    if (!batchCallback_) {
+        sendError("Batch callback not set");
+        return;
+    }
+    
+    if (batchCallback_(staged_, stagedCount_)) {
+        sendResponse("OK");
+        Logger::info("UART: transaction applied to %u channels", stagedCount_);
+    } else {
+        sendError("Transaction rejected - channel not configured or driven by closed loop");
+    }
+}
+
+void UARTCommandHandler::handleAbort(const CommandArgs& args) {
+    if (!transactionOpen_) {
+        sendError("ABORT without BEGIN");
+        return;
+    }
+    
+    transactionOpen_ = false;
+    sendResponse("OK");
+}
+
+void UARTCommandHandler::stageDuty(uint8_t channel, uint8_t dutyCycle) {
+    // Повторная запись в канал внутри транзакции заменяет предыдущую
+    uint8_t index = 0;
+    while (index < stagedCount_ && staged_[index].channel != channel) {
+        index++;
+    }
+    if (index == stagedCount_) {
+        stagedCount_++;
+    }
+    staged_[index].channel = channel;
+    staged_[index].dutyCycle = dutyCycle;
+    sendResponse("QUEUED");
+}
+
+bool UARTCommandHandler::loopOwnsChannel(uint8_t channel) {
+    if (!loopStatusCallback_) {
+        return false;
+    }
+    ClosedLoopStatus status;
+    loopStatusCallback_(status);
+    return status.enabled && status.channel == channel;
+}
+
+void UARTCommandHandler::sendChannelError(uint8_t channel) {
+    // Пока контур включён, ШИМ его канала пишет только он (см. PWMClosedLoop)
+    if (loopOwnsChannel(channel)) {
+        sendError("PWM channel %u is driven by closed loop (SET TARGET OFF)", channel);
+    } else {
+        sendError("PWM channel %u not configured", channel);
+    }
+}
+
+bool UARTCommandHandler::parseArgs(const CommandArgs& args, uint32_t* values) {
+    // Все параметры - десятичные числа без знака
+    for (uint8_t i = 0; i < args.count; i++) {
+        if (!CommandParser::parseUnsigned(args.words[i], values[i])) {
+            sendError("Invalid number format");
+            Logger::error("UART: Invalid number format: %s", args.words[i]);
+            return false;
+        }
+    }
     return true;
-}
\ No newline at end of file
+}
+
+// ============================================================================
+// Бинарный протокол (COBS + CRC16, см. binary_protocol.h)
+// ============================================================================
+
+void UARTCommandHandler::processBinaryByte(uint8_t byte) {
+    if (byte == 0) {
+        // Разделитель: закрывает текущий кадр и открывает следующий
+        if (cmdIndex_ > 0 && !discardingLine_) {
+            processFrame((uint8_t*)cmdBuffer_, cmdIndex_);
+        }
+        cmdIndex_ = 0;
+        discardingLine_ = false;
+        return;
+    }
+    
+    if (discardingLine_) {
+        return;
+    }
+    
+    if (cmdIndex_ < UART_CMD_BUFFER_SIZE) {
+        if (cmdIndex_ == 0) {
+            lineStartUs_ = rxTimeUs_;
+        }
+        cmdBuffer_[cmdIndex_++] = byte;
+    } else {
+        // Кадр длиннее буфера - пропускаем до следующего разделителя
+        Logger::error("UART binary frame too long");
+        sendFrame(0, BinaryProtocol::STATUS_NACK_FORMAT, 0, 0);
+        discardingLine_ = true;
+    }
+}
+
+void UARTCommandHandler::processFrame(uint8_t* frame, size_t length) {
+    using namespace BinaryProtocol;
+    
+    /**
+     * СТРАТЕГИЯ ОБРАБОТКИ КАДРА:
+     * 1. COBS-декодирование на месте, в cmdBuffer_
+     * 2. Проверка CRC до применения чего-либо: повреждённый кадр отбрасывается целиком
+     * 3. Записи выполняются по порядку через те же колбэки, что и текстовые команды
+     * 4. Один ответ на кадр: ACK или NACK с числом выполненных записей
+     */
+    Stats::add(STAT_BINARY_FRAMES);
+    startTrace(lineStartUs_);
+    size_t packetLength;
+    if (!cobsDecode(frame, length, packetLength) || packetLength < MIN_PACKET_SIZE) {
+        sendFrame(0, STATUS_NACK_FORMAT, 0, 0);
+        return;
+    }
+    
+    uint8_t sequence = frame[0];
+    size_t end = packetLength - 2;
+    if (crc16(frame, end) != readLe16(frame + end)) {
+        sendFrame(sequence, STATUS_NACK_CRC, 0, 0);
+        Logger::error("UART binary frame %u: CRC mismatch", sequence);
+        return;
+    }
+    Trace::mark(TRACE_UART_PARSE, traceId_);
+    
+    uint8_t applied = 0;
+    uint16_t value = 0;
+    bool textMode = false;
+    for (size_t pos = 1; pos < end; applied++) {
+        size_t recordSize = frame[pos] == OP_FADE ? FADE_RECORD_SIZE : RECORD_SIZE;
+        if (pos + recordSize > end) {
+            sendFrame(sequence, STATUS_NACK_FORMAT, applied, 0);
+            return;
+        }
+        
+        if (frame[pos] == OP_TEXT_MODE) {
+            textMode = true;
+        } else {
+            Trace::mark(TRACE_UART_DISPATCH, traceId_, frame[pos]);
+            Status status = applyRecord(frame + pos, value);
+            if (status != STATUS_ACK) {
+                sendFrame(sequence, status, applied, 0);
+                return;
+            }
+        }
+        pos += recordSize;
+    }
+    
+    sendFrame(sequence, STATUS_ACK, applied, value);
+    
+    if (textMode) {
+        // Переключение после ответа, чтобы хост получил ACK кадром
+        binaryMode_ = false;
+        Logger::debug("UART: text protocol");
+    }
+}
+
+BinaryProtocol::Status UARTCommandHandler::applyRecord(const uint8_t* record, uint16_t& value) {
+    using namespace BinaryProtocol;
+    
+    uint8_t channel = record[1];
+    uint16_t argument = readLe16(record + 2);
+    if (channel >= PWM_MAX_CHANNELS) {
+        return STATUS_NACK_RANGE;
+    }
+    
+    // В бинарном режиме команды не логируются на уровне info: лог делит с ними UART
+    switch (record[0]) {
+        case OP_SET_PWM:
+            if (!setChannelPWMCallback_) {
+                return STATUS_NACK_UNSUPPORTED;
+            }
+            if (argument > 100) {
+                return STATUS_NACK_RANGE;
+            }
+            return setChannelPWMCallback_(channel, argument) ? STATUS_ACK : STATUS_NACK_REJECTED;
+        
+        case OP_SET_PERMILLE:
+            if (!permilleCallback_) {
+                return STATUS_NACK_UNSUPPORTED;
+            }
+            if (argument > 1000) {
+                return STATUS_NACK_RANGE;
+            }
+            return permilleCallback_(channel, argument) ? STATUS_ACK : STATUS_NACK_REJECTED;
+        
+        case OP_FADE: {
+            if (!fadeCallback_) {
+                return STATUS_NACK_UNSUPPORTED;
+            }
+            uint16_t durationMs = readLe16(record + 4);
+            if (argument > 100 || durationMs > PWM_FADE_MAX_MS) {
+                return STATUS_NACK_RANGE;
+            }
+            return fadeCallback_(channel, argument, durationMs) ? STATUS_ACK : STATUS_NACK_REJECTED;
+        }
+        
+        case OP_GET_PWM:
+            if (!getPWMCallback_) {
+                return STATUS_NACK_UNSUPPORTED;
+            }
+            value = getPWMCallback_();
+            return STATUS_ACK;
+        
+        case OP_SET_DITHER:
+            if (!ditherCallback_) {
+                return STATUS_NACK_UNSUPPORTED;
+            }
+            if (argument > 1) {
+                return STATUS_NACK_RANGE;
+            }
+            return ditherCallback_(channel, argument == 1) ? STATUS_ACK : STATUS_NACK_REJECTED;
+        
+        default:
+            return STATUS_NACK_OPCODE;
+    }
+}
+
+void UARTCommandHandler::sendFrame(uint8_t sequence, BinaryProtocol::Status status, uint8_t applied, uint16_t value) {
+    using namespace BinaryProtocol;
+    
+    uint8_t packet[RESPONSE_SIZE];
+    packet[0] = sequence;
+    packet[1] = status;
+    packet[2] = applied;
+    writeLe16(packet + 3, value);
+    writeLe16(packet + 5, crc16(packet, RESPONSE_SIZE - 2));
+    
+    // Ведущий ноль отделяет кадр от строк лога, идущих по тому же UART
+    uint8_t wire[cobsEncodedSize(RESPONSE_SIZE) + 2];
+    wire[0] = 0;
+    size_t length = 1 + cobsEncode(packet, RESPONSE_SIZE, wire + 1);
+    wire[length++] = 0;
+    queueBytes(wire, length);
+}
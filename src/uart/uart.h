@@ -4,45 +4,148 @@
 #include <Arduino.h>
 #include "../common/config.h"
 #include "../common/logger.h"
+#include "../common/ring_buffer.h"
+#include "../common/stats.h"
+#include "../common/trace.h"
+#include "../pwm/pwm.h"
+#include "../pwm/pwm_actor.h"
+#include "../pwm/sequencer.h"
+#include "../pwm/closed_loop.h"
+#include "binary_protocol.h"
+#include "bus_address.h"
+#include "command_parser.h"
+#include "telemetry.h"
 
 class UARTCommandHandler {
 public:
     UARTCommandHandler();
     void begin();
     void processCommands();
-    void setPWMCallback(void (*callback)(uint8_t));
+    void waitForData(TickType_t timeout);  // Сон задачи до прихода данных
+    void notifyTask(TaskHandle_t task, uint32_t bits);  // Приём выставляет биты задачи (eSetBits)
+    TraceOrigin commandOrigin() const;  // Приём и трасса выполняемой команды (для колбэков)
+    void setPWMCallback(bool (*callback)(uint8_t));
     void getPWMCallback(uint8_t (*callback)());
+    void setChannelPWMCallback(bool (*callback)(uint8_t, uint8_t));
+    void setFadeCallback(bool (*callback)(uint8_t, uint8_t, uint32_t));
+    void setPermilleCallback(bool (*callback)(uint8_t, uint16_t));
+    void setPWMConfigCallback(bool (*callback)(uint8_t, uint32_t, uint8_t));
+    void setDitherCallback(bool (*callback)(uint8_t, bool));
+    void setBatchCallback(bool (*callback)(const PWMDutyUpdate*, uint8_t));
+    void setSequenceLoadCallback(bool (*callback)(uint16_t));
+    void setSequenceKeyCallback(bool (*callback)(const SequenceKey&));
+    void setSequencePlayCallback(bool (*callback)(bool));
+    void setSequenceStatusCallback(void (*callback)(SequenceStatus&));
+    void setLoopTargetCallback(bool (*callback)(bool, uint16_t));
+    void setLoopGainsCallback(void (*callback)(uint32_t, uint32_t, uint32_t));
+    void setLoopStatusCallback(void (*callback)(ClosedLoopStatus&));
+    void setTelemetrySource(Telemetry::SampleSource source);
+    void setPWMStatusCallback(void (*callback)(PWMSnapshot&));  // Счётчики владельца ШИМ для STATS
 
 private:
-    // Кольцевой буфер для приема данных
-    class RingBuffer {
-    private:
-        char data_[UART_RX_BUFFER_SIZE];
-        uint16_t head_;
-        uint16_t tail_;
-        uint16_t count_;
-        
-    public:
-        RingBuffer();
-        bool put(char c);
-        bool get(char* c);
-        void clear();
-        bool isFull() const;
-        bool isEmpty() const;
-        uint16_t available() const;
-    };
-    
-    RingBuffer rxRingBuffer_;           // Кольцевой буфер 256 байт
+    RingBuffer<char, UART_RX_BUFFER_SIZE> rxRingBuffer_; // Кольцевой буфер приёма (SPSC)
     char cmdBuffer_[UART_CMD_BUFFER_SIZE]; // Буфер для сборки команд
     uint16_t cmdIndex_;
-    void (*setPWMCallback_)(uint8_t);
+    bool discardingLine_;               // Пропуск хвоста слишком длинной команды
+    bool binaryMode_;                   // Приём COBS-кадров вместо текстовых строк
+    BusAddressFilter busFilter_;        // Адресный префикс строки на общей шине
+    volatile TaskHandle_t rxTask_;      // Задача, которую будит приём
+    uint32_t rxNotifyBits_;             // 0 - xTaskNotifyGive, иначе биты eSetBits
+    uint32_t rxTimeUs_;                 // Момент чтения последней порции из драйвера
+    uint32_t lineStartUs_;              // Порция с первым байтом текущей строки
+    uint16_t traceId_;                  // Трасса выполняемой строки или кадра
+    char txBuffer_[UART_TX_BUFFER_SIZE]; // Накопленные ответы текущего прохода
+    uint16_t txLength_;
+    bool transactionOpen_;              // Между BEGIN и COMMIT/ABORT
+    bool transactionFailed_;            // Ошибка внутри транзакции - COMMIT откажет
+    PWMDutyUpdate staged_[PWM_MAX_CHANNELS]; // Отложенные изменения транзакции
+    uint8_t stagedCount_;
+    Telemetry telemetry_;               // Поток STREAM, разбирается после ответов
+    bool (*setPWMCallback_)(uint8_t);
     uint8_t (*getPWMCallback_)();
+    bool (*setChannelPWMCallback_)(uint8_t, uint8_t);
+    bool (*fadeCallback_)(uint8_t, uint8_t, uint32_t);
+    bool (*permilleCallback_)(uint8_t, uint16_t);
+    bool (*pwmConfigCallback_)(uint8_t, uint32_t, uint8_t);
+    bool (*ditherCallback_)(uint8_t, bool);
+    bool (*batchCallback_)(const PWMDutyUpdate*, uint8_t);
+    bool (*sequenceLoadCallback_)(uint16_t);
+    bool (*sequenceKeyCallback_)(const SequenceKey&);
+    bool (*sequencePlayCallback_)(bool);          // true - PLAY, false - STOP
+    void (*sequenceStatusCallback_)(SequenceStatus&);
+    bool (*loopTargetCallback_)(bool, uint16_t);  // false - выключить контур
+    void (*loopGainsCallback_)(uint32_t, uint32_t, uint32_t);
+    void (*loopStatusCallback_)(ClosedLoopStatus&);
+    void (*pwmStatusCallback_)(PWMSnapshot&);
+    
+    // Параметры команды (слова после глагола, указывают в cmdBuffer_)
+    struct CommandArgs {
+        char* const* words;
+        uint8_t count;
+    };
+    
+    typedef void (UARTCommandHandler::*CommandMethod)(const CommandArgs& args);
+    
+    // Строка таблицы команд (см. findCommand)
+    struct CommandSpec {
+        uint32_t hash;        // Хеш глагола, считается при компиляции
+        const char* verb;
+        uint8_t verbWords;
+        uint8_t minArgs;
+        uint8_t maxArgs;
+        uint8_t flags;        // CMD_* из uart.cpp
+        CommandMethod method;
+        const char* usage;
+    };
+    
+    static const CommandSpec* findCommand(const CommandParser::Tokens& tokens);
     
-    void processCommand(const String& command);
-    void sendResponse(const String& response);
-    void handleSetPWM(const String& parameters);
-    void handleGetPWM();
-    bool validateNumber(const String& str, int& value);
+    void notifyDataReceived();
+    void processRxBuffer();
+    void processChar(char c);
+    void processCommand(char* line);
+    void executeCommand(char* command);
+    void sendResponse(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    void sendError(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    void queueResponse(const char* format, va_list args);
+    void queueBytes(const uint8_t* data, size_t length);
+    void flushResponses();
+    void drainTelemetry();
+    void handleSetPWM(const CommandArgs& args);
+    void handleGetPWM(const CommandArgs& args);
+    void handleFadePWM(const CommandArgs& args);
+    void handleSetPermille(const CommandArgs& args);
+    void handleSetPWMConfig(const CommandArgs& args);
+    void handleSetDither(const CommandArgs& args);
+    void handleSetLog(const CommandArgs& args);
+    void handleSetAddress(const CommandArgs& args);
+    void handleSetGroup(const CommandArgs& args);
+    void handleGetNode(const CommandArgs& args);
+    void handleSeqLoad(const CommandArgs& args);
+    void handleSeqKey(const CommandArgs& args);
+    void handleSeqPlay(const CommandArgs& args);
+    void handleSeqStop(const CommandArgs& args);
+    void handleSeqStatus(const CommandArgs& args);
+    void handleSetTarget(const CommandArgs& args);
+    void handleSetGains(const CommandArgs& args);
+    void handleGetLoop(const CommandArgs& args);
+    void handleMem(const CommandArgs& args);
+    void handleStats(const CommandArgs& args);
+    void sendHistogram(StatHistogram id);
+    void handleTrace(const CommandArgs& args);
+    void startTrace(uint32_t rxTimeUs);
+    void handleStream(const CommandArgs& args);
+    void handleBegin(const CommandArgs& args);
+    void handleCommit(const CommandArgs& args);
+    void handleAbort(const CommandArgs& args);
+    void stageDuty(uint8_t channel, uint8_t dutyCycle);
+    bool parseArgs(const CommandArgs& args, uint32_t* values);
+    bool loopOwnsChannel(uint8_t channel);
+    void sendChannelError(uint8_t channel);  // Отказ колбэка: канал не настроен или занят контуром
+    void processBinaryByte(uint8_t byte);
+    void processFrame(uint8_t* frame, size_t length);
+    BinaryProtocol::Status applyRecord(const uint8_t* record, uint16_t& value);
+    void sendFrame(uint8_t sequence, BinaryProtocol::Status status, uint8_t applied, uint16_t value);
     void handleBufferOverflow();
     void handleCommandOverflow();
 };
@@ -0,0 +1,194 @@
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+/**
+ * Общее для хостовых бенчмарков конвейера команд (сборка HAL_NATIVE):
+ * реальные часы для Hal, счётчик выделений памяти, перцентили и отчёт
+ * в JSON для tools/bench/compare.py.
+ *
+ * Подключается ровно в один .cpp бенчмарка: здесь определены malloc/free
+ * (подмена glibc, только Linux).
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "hal/hal.h"
+
+// ============================================================================
+// Счётчик выделений: каждый malloc/calloc/realloc (и operator new поверх них)
+// ============================================================================
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void __libc_free(void* pointer);
+}
+
+namespace Bench {
+
+std::atomic<uint64_t> allocations(0);
+thread_local uint64_t threadAllocations = 0;    // Только своего потока - для многопоточных бенчмарков
+
+}  // namespace Bench
+
+extern "C" void* malloc(size_t size) {
+    Bench::allocations.fetch_add(1, std::memory_order_relaxed);
+    Bench::threadAllocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    Bench::allocations.fetch_add(1, std::memory_order_relaxed);
+    Bench::threadAllocations++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+    Bench::allocations.fetch_add(1, std::memory_order_relaxed);
+    Bench::threadAllocations++;
+    return __libc_realloc(pointer, size);
+}
+
+extern "C" void free(void* pointer) {
+    __libc_free(pointer);
+}
+
+namespace Bench {
+
+// Часы Hal - монотонное время хоста: STATS и TRACE показывают настоящие микросекунды
+class RealClock : public Hal::Clock {
+public:
+    RealClock() : start_(std::chrono::steady_clock::now()) {}
+
+    int64_t nowUs() override {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_)
+            .count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+inline double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Лучшее время из нескольких прогонов: на общем хосте шум только замедляет
+template <typename Run>
+double bestSeconds(int repeats, Run run) {
+    double best = 0;
+    for (int i = 0; i < repeats; i++) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        double seconds = secondsSince(start);
+        if (i == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+// Перцентили выборки; values сортируется на месте
+struct Percentiles {
+    double p50;
+    double p90;
+    double p99;
+    double p999;
+    double max;
+};
+
+inline Percentiles percentiles(std::vector<double>& values) {
+    Percentiles result = {};
+    if (values.empty()) {
+        return result;
+    }
+    std::sort(values.begin(), values.end());
+    auto at = [&](double fraction) { return values[(size_t)(fraction * (values.size() - 1))]; };
+    result.p50 = at(0.50);
+    result.p90 = at(0.90);
+    result.p99 = at(0.99);
+    result.p999 = at(0.999);
+    result.max = values.back();
+    return result;
+}
+
+/**
+ * ОТЧЁТ:
+ * Метрика - имя, значение, единица и направление "лучше" (higher/lower),
+ * по которому compare.py отличает регрессию от улучшения; info - только
+ * для сведения, не сравнивается. Текстовая
+ * таблица - для человека, --json - один объект для сравнения между версиями.
+ */
+class Report {
+public:
+    explicit Report(const char* suite) : suite_(suite) {}
+
+    void param(const std::string& name, const std::string& value) {
+        params_.push_back({ name, value });
+    }
+
+    void metric(const std::string& name, double value, const char* unit, const char* better) {
+        metrics_.push_back({ name, value, unit, better });
+    }
+
+    // Максимум - одна выборка, на хосте это шум планировщика: только для сведения
+    void latency(const std::string& prefix, std::vector<double>& samples, const char* unit,
+                 const char* better = "lower") {
+        Percentiles p = percentiles(samples);
+        metric(prefix + "_p50", p.p50, unit, better);
+        metric(prefix + "_p90", p.p90, unit, better);
+        metric(prefix + "_p99", p.p99, unit, better);
+        metric(prefix + "_p999", p.p999, unit, better);
+        metric(prefix + "_max", p.max, unit, "info");
+    }
+
+    void print(bool json) const {
+        if (!json) {
+            for (const Param& p : params_) {
+                printf("%-44s %s\n", p.name.c_str(), p.value.c_str());
+            }
+            for (const Metric& m : metrics_) {
+                printf("%-44s %16.2f %s\n", m.name.c_str(), m.value, m.unit);
+            }
+            return;
+        }
+        printf("{\n  \"suite\": \"%s\",\n  \"params\": {", suite_);
+        for (size_t i = 0; i < params_.size(); i++) {
+            printf("%s\n    \"%s\": \"%s\"", i ? "," : "", params_[i].name.c_str(), params_[i].value.c_str());
+        }
+        printf("\n  },\n  \"metrics\": [");
+        for (size_t i = 0; i < metrics_.size(); i++) {
+            const Metric& m = metrics_[i];
+            printf("%s\n    {\"name\": \"%s\", \"value\": %.3f, \"unit\": \"%s\", \"better\": \"%s\"}", i ? "," : "",
+                   m.name.c_str(), m.value, m.unit, m.better);
+        }
+        printf("\n  ]\n}\n");
+    }
+
+private:
+    struct Param {
+        std::string name;
+        std::string value;
+    };
+
+    struct Metric {
+        std::string name;
+        double value;
+        const char* unit;
+        const char* better;
+    };
+
+    const char* suite_;
+    std::vector<Param> params_;
+    std::vector<Metric> metrics_;
+};
+
+}  // namespace Bench
+
+#endif
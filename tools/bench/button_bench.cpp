@@ -0,0 +1,147 @@
+/**
+ * Хостовый бенчмарк скана панели клавиш ButtonBank (src/button/button_bank.h).
+ *
+ * Настоящий ButtonBank в сборке HAL_NATIVE: входы - два слова уровней, как
+ * GPIO_IN/GPIO_IN1, часы - VirtualClock, который каждый скан сдвигается на
+ * BUTTON_SCAN_MS, чтобы сроки жестов шли как на устройстве. Клавиша k сидит
+ * на пине k. Жесты выбираются из очереди после каждого скана.
+ *
+ * Метрики для 1, 2, 4, 8, 16 и 32 клавиш:
+ *   scan_idle_<N>_ns         скан без нажатий - цена пробуждения по таймеру
+ *   scan_one_active_<N>_ns   клики одной клавишей при N клавишах: не должна расти с N
+ *   scan_all_active_<N>_ns   клики всеми N клавишами сразу
+ *   events_all_active_<N>    жестов за прогон со всеми клавишами (для сведения)
+ *   allocations_per_scan     выделений памяти на скан (ожидается 0)
+ *
+ * Сборка и запуск (tools/bench/run.sh собирает и запускает все бенчмарки):
+ *   g++ -O2 -std=gnu++17 -DHAL_NATIVE -Isrc/hal/native/include -Isrc tools/bench/button_bench.cpp \
+ *       src/button/button_bank.cpp src/button/gesture.cpp src/common/stats.cpp src/common/trace.cpp \
+ *       src/common/logger.cpp src/common/rtos.cpp src/hal/native/hal_native.cpp \
+ *       src/hal/native/esp_timer_native.cpp -o button_bench
+ *   ./button_bench [--scans N] [--json]
+ */
+
+#include <cstring>
+#include "bench_common.h"
+#include "button/button_bank.h"
+#include "hal/native/hal_native.h"
+
+namespace {
+
+const uint8_t KEY_COUNTS[] = { 1, 2, 4, 8, 16, 32 };
+const uint32_t TOGGLE_SCANS = 8;   // Уровень держится 8 сканов (40 мс): 4 на приём и запас
+const int REPEATS = 5;             // Прогонов на замер, берётся лучший
+volatile uint32_t sink;            // Результаты, которые компилятор не должен выбросить
+
+// Входы без прерываний: скан читает слова уровней, как регистры GPIO_IN/GPIO_IN1
+class BenchGpio : public Hal::Gpio {
+public:
+    BenchGpio() {
+        release();
+    }
+
+    // Клавиши по маске пинов 0-31 нажаты (низкий уровень), остальные отпущены
+    void press(uint32_t mask) {
+        levels_[0] = ~mask;
+    }
+
+    void release() {
+        levels_[0] = levels_[1] = UINT32_MAX;
+    }
+
+    void pinMode(uint8_t pin, uint8_t mode) override {}
+    void digitalWrite(uint8_t pin, uint8_t level) override {}
+
+    uint32_t readInputs(uint8_t bank) override {
+        return levels_[bank ? 1 : 0];
+    }
+
+    void attachEdgeInterrupt(uint8_t pin, void (*handler)(void*), void* arg) override {}
+
+    uint16_t analogRead(uint8_t pin) override {
+        return 0;
+    }
+
+private:
+    uint32_t levels_[2];
+};
+
+Hal::VirtualClock virtualClock;
+BenchGpio gpio;
+
+// Наносекунд на скан: pressedMask - клавиши, которые кликают каждые 2 * TOGGLE_SCANS сканов
+double scanNs(uint8_t keys, uint32_t pressedMask, size_t scans, uint32_t& events) {
+    ButtonBank bank;
+    for (uint8_t key = 0; key < keys; key++) {
+        bank.addKey(key);
+    }
+    bank.begin();
+    gpio.release();
+
+    ButtonGesture gesture;
+    uint32_t count = 0;
+    double seconds = Bench::bestSeconds(REPEATS, [&]() {
+        for (size_t i = 0; i < scans; i++) {
+            if (pressedMask && i % TOGGLE_SCANS == 0) {
+                if ((i / TOGGLE_SCANS) % 2) {
+                    gpio.release();
+                } else {
+                    gpio.press(pressedMask);
+                }
+            }
+            virtualClock.setNow(virtualClock.nowUs() + BUTTON_SCAN_MS * 1000);
+            bank.scan();
+            while (bank.getEvent(gesture)) {
+                count++;
+            }
+        }
+    });
+    events = count / REPEATS;
+    sink = count;
+    return seconds * 1e9 / scans;
+}
+
+uint32_t keyMask(uint8_t keys) {
+    return keys >= 32 ? UINT32_MAX : (1UL << keys) - 1;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t scans = 200000;
+    bool json = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--scans") == 0 && i + 1 < argc) {
+            scans = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else {
+            fprintf(stderr, "usage: %s [--scans N] [--json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Hal::install(&virtualClock, &gpio, nullptr, nullptr);
+
+    Bench::Report report("button_bench");
+    report.param("scans", std::to_string(scans));
+    report.param("scan_ms", std::to_string(BUTTON_SCAN_MS));
+
+    uint64_t allocationsBefore = Bench::allocations.load();
+    size_t totalScans = 0;
+    for (uint8_t keys : KEY_COUNTS) {
+        uint32_t events;
+        std::string suffix = std::to_string(keys);
+        report.metric("scan_idle_" + suffix + "_ns", scanNs(keys, 0, scans, events), "ns", "lower");
+        report.metric("scan_one_active_" + suffix + "_ns", scanNs(keys, 1, scans, events), "ns", "lower");
+        report.metric("scan_all_active_" + suffix + "_ns", scanNs(keys, keyMask(keys), scans, events), "ns",
+                      "lower");
+        report.metric("events_all_active_" + suffix, events, "count", "info");
+        totalScans += 3 * REPEATS * scans;
+    }
+    // Выделения в begin() (очередь лога при первом вызове) делятся на все сканы
+    report.metric("allocations_per_scan", (double)(Bench::allocations.load() - allocationsBefore) / totalScans,
+                  "allocs", "lower");
+    report.print(json);
+    return 0;
+}
@@ -0,0 +1,301 @@
+/**
+ * Хостовые микробенчмарки конвейера команд UART.
+ *
+ * Всё - настоящий код прошивки в сборке HAL_NATIVE: RingBuffer приёма,
+ * CommandParser и UARTCommandHandler целиком (чтение из порта, кольцо,
+ * сборка строки, таблица команд, форматирование ответа). Порт - буфер
+ * фиксированного размера без выделений памяти, колбэки ШИМ - заглушки,
+ * чтобы мерить только разбор команд.
+ *
+ * Метрики:
+ *   ring_*            байт/с через кольцо приёма (одним потоком, поэлементно и порциями)
+ *   tokenize_*        строк/с через CommandParser::tokenize
+ *   pipeline_*        строк/с через processCommands по видам строк
+ *   latency_*         время обработки одной строки, перцентили, нс
+ *   allocations_*     выделений памяти на строку (ожидается 0)
+ *
+ * Сборка и запуск (tools/bench/run.sh собирает и запускает все бенчмарки):
+ *   g++ -O2 -std=gnu++17 -DHAL_NATIVE -Isrc/hal/native/include -Isrc tools/bench/command_bench.cpp \
+ *       src/uart/uart.cpp src/uart/telemetry.cpp src/common/stats.cpp src/common/trace.cpp \
+ *       src/common/logger.cpp src/common/rtos.cpp src/hal/native/hal_native.cpp \
+ *       src/hal/native/esp_timer_native.cpp -o command_bench
+ *   ./command_bench [--lines N] [--json]
+ */
+
+#include <cstring>
+#include "bench_common.h"
+#include "uart/uart.h"
+
+namespace {
+
+const char* const VALID_LINES[] = { "SET PWM 42", "GET PWM", "SET PERMILLE 0 500", "SET PWM 0 75", "GET NODE" };
+const char* const MALFORMED_LINES[] = { "SET PWM abc", "XYZZY 1 2", "SET PWM 1 2 3 4 5 6 7 8 9", "GET",
+                                        "SET PERMILLE 0 99999" };
+const char* const BATCH_LINES[] = { "SET PWM 10; GET PWM; SET PWM 20", "BEGIN; SET PWM 0 30; COMMIT" };
+
+const int REPEATS = 5;      // Прогонов на замер пропускной способности, берётся лучший
+volatile uint32_t sink;     // Результаты, которые компилятор не должен выбросить
+
+// Порт без выделений памяти: приём - линейный буфер размером с буфер драйвера,
+// передача только считает байты
+class BenchSerial : public Hal::SerialPort {
+public:
+    BenchSerial() : head_(0), tail_(0), txBytes_(0), overflows_(0) {}
+
+    void inject(const char* data, size_t length) {
+        if (head_ == tail_) {
+            head_ = tail_ = 0;
+        }
+        size_t room = sizeof(rx_) - tail_;
+        if (length > room) {
+            overflows_ += length - room;
+            length = room;
+        }
+        memcpy(rx_ + tail_, data, length);
+        tail_ += length;
+    }
+
+    uint64_t txBytes() const {
+        return txBytes_;
+    }
+
+    uint32_t overflows() const {
+        return overflows_;
+    }
+
+    int available() override {
+        return (int)(tail_ - head_);
+    }
+
+    size_t read(uint8_t* buffer, size_t size) override {
+        size_t count = std::min(size, tail_ - head_);
+        memcpy(buffer, rx_ + head_, count);
+        head_ += count;
+        return count;
+    }
+
+    int availableForWrite() override {
+        return INT32_MAX;
+    }
+
+    size_t write(const uint8_t* data, size_t size) override {
+        txBytes_ += size;
+        return size;
+    }
+
+private:
+    uint8_t rx_[UART_RX_BUFFER_SIZE];
+    size_t head_;
+    size_t tail_;
+    uint64_t txBytes_;
+    uint32_t overflows_;
+};
+
+Bench::RealClock realClock;
+BenchSerial benchSerial;
+UARTCommandHandler handler;
+uint8_t stubDuty = 0;
+
+void setupHandler() {
+    Hal::install(&realClock, nullptr, nullptr, &benchSerial);
+    handler.begin();
+    handler.setPWMCallback([](uint8_t duty) {
+        stubDuty = duty;
+        return true;
+    });
+    handler.getPWMCallback([]() { return stubDuty; });
+    handler.setChannelPWMCallback([](uint8_t channel, uint8_t duty) {
+        stubDuty = duty;
+        return channel == 0;
+    });
+    handler.setPermilleCallback([](uint8_t channel, uint16_t permille) { return channel == 0; });
+    handler.setBatchCallback([](const PWMDutyUpdate* updates, uint8_t count) { return count > 0; });
+}
+
+std::string overlongLine() {
+    return "SET PWM " + std::string(UART_CMD_BUFFER_SIZE * 2, '7');
+}
+
+// Подача потока порциями не больше буфера приёма драйвера и разбор каждой порции
+void feed(const std::string& stream) {
+    for (size_t offset = 0; offset < stream.size(); offset += UART_RX_BUFFER_SIZE) {
+        size_t length = std::min(stream.size() - offset, (size_t)UART_RX_BUFFER_SIZE);
+        benchSerial.inject(stream.data() + offset, length);
+        handler.processCommands();
+    }
+}
+
+// ============================================================================
+// Кольцо приёма
+// ============================================================================
+
+void benchRing(Bench::Report& report, size_t totalBytes) {
+    RingBuffer<char, UART_RX_BUFFER_SIZE> ring;
+    char block[UART_RX_CHUNK_SIZE];
+    for (size_t i = 0; i < sizeof(block); i++) {
+        block[i] = (char)i;
+    }
+
+    uint32_t checksum = 0;
+    double seconds = Bench::bestSeconds(REPEATS, [&]() {
+        for (size_t done = 0; done < totalBytes; done += sizeof(block)) {
+            ring.write(block, sizeof(block));
+            char out[UART_RX_CHUNK_SIZE];
+            size_t count = ring.read(out, sizeof(out));
+            checksum += (uint8_t)out[count - 1];
+        }
+    });
+    report.metric("ring_bulk_64_mb_per_s", totalBytes / seconds / 1e6, "MB/s", "higher");
+
+    seconds = Bench::bestSeconds(REPEATS, [&]() {
+        for (size_t done = 0; done < totalBytes / 8; done++) {
+            ring.put((char)done);
+            char c = 0;
+            ring.get(&c);
+            checksum += (uint8_t)c;
+        }
+    });
+    report.metric("ring_put_get_mb_per_s", totalBytes / 8 / seconds / 1e6, "MB/s", "higher");
+    sink = checksum;
+}
+
+// ============================================================================
+// Разбор на слова
+// ============================================================================
+
+void benchTokenize(Bench::Report& report, size_t lines) {
+    std::vector<std::string> mix;
+    for (const char* line : VALID_LINES) {
+        mix.push_back(line);
+    }
+    for (const char* line : MALFORMED_LINES) {
+        mix.push_back(line);
+    }
+
+    char buffer[UART_CMD_BUFFER_SIZE];
+    CommandParser::Tokens tokens;
+    uint32_t words = 0;
+    double seconds = Bench::bestSeconds(REPEATS, [&]() {
+        for (size_t i = 0; i < lines; i++) {
+            const std::string& line = mix[i % mix.size()];
+            memcpy(buffer, line.c_str(), line.size() + 1);
+            if (CommandParser::tokenize(buffer, tokens)) {
+                words += tokens.count + CommandParser::wordsHash(tokens.words, tokens.count > 2 ? 2 : tokens.count);
+            }
+        }
+    });
+    report.metric("tokenize_lines_per_s", lines / seconds, "lines/s", "higher");
+    sink = words;
+}
+
+// ============================================================================
+// Конвейер processCommands
+// ============================================================================
+
+struct Pipeline {
+    const char* name;
+    std::vector<std::string> lines;
+};
+
+void benchPipeline(Bench::Report& report, const Pipeline& pipeline, size_t lines) {
+    // Поток из повторяющихся строк, подаётся порциями как из драйвера
+    std::string stream;
+    size_t count = 0;
+    while (count < lines) {
+        for (const std::string& line : pipeline.lines) {
+            stream += line;
+            stream += "\r\n";
+            count++;
+        }
+    }
+
+    uint64_t allocationsBefore = Bench::allocations.load();
+    uint64_t txBefore = benchSerial.txBytes();
+    double seconds = Bench::bestSeconds(REPEATS, [&]() { feed(stream); });
+    uint64_t allocated = (Bench::allocations.load() - allocationsBefore) / REPEATS;
+    uint64_t responseBytes = (benchSerial.txBytes() - txBefore) / REPEATS;
+
+    std::string prefix = std::string("pipeline_") + pipeline.name;
+    report.metric(prefix + "_lines_per_s", count / seconds, "lines/s", "higher");
+    report.metric(prefix + "_mb_per_s", stream.size() / seconds / 1e6, "MB/s", "higher");
+    report.metric(prefix + "_response_bytes_per_line", (double)responseBytes / count, "bytes", "lower");
+    report.metric("allocations_per_line_" + std::string(pipeline.name), (double)allocated / count, "allocs", "lower");
+}
+
+// Время одной строки от подачи в порт до записанного ответа
+void benchLatency(Bench::Report& report, const std::vector<std::string>& mix, size_t lines) {
+    std::vector<double> samples;
+    samples.reserve(lines);
+    std::vector<std::string> framed;
+    for (const std::string& line : mix) {
+        framed.push_back(line + "\r\n");
+    }
+    for (size_t i = 0; i < lines; i++) {
+        const std::string& line = framed[i % framed.size()];
+        auto start = std::chrono::steady_clock::now();
+        feed(line);
+        samples.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+    }
+    report.latency("latency_line", samples, "ns");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t lines = 200000;
+    bool json = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--lines") == 0 && i + 1 < argc) {
+            lines = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else {
+            fprintf(stderr, "usage: %s [--lines N] [--json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    setupHandler();
+
+    std::vector<std::string> mixed;
+    Pipeline valid = { "valid", {} };
+    Pipeline malformed = { "malformed", {} };
+    Pipeline batch = { "batch", {} };
+    Pipeline overlong = { "overlong", { overlongLine() } };
+    for (const char* line : VALID_LINES) {
+        valid.lines.push_back(line);
+        mixed.push_back(line);
+    }
+    for (const char* line : MALFORMED_LINES) {
+        malformed.lines.push_back(line);
+        mixed.push_back(line);
+    }
+    for (const char* line : BATCH_LINES) {
+        batch.lines.push_back(line);
+        mixed.push_back(line);
+    }
+    mixed.push_back(overlongLine());
+    Pipeline mixedPipeline = { "mixed", mixed };
+
+    Bench::Report report("command_bench");
+    report.param("lines", std::to_string(lines));
+    report.param("rx_buffer", std::to_string(UART_RX_BUFFER_SIZE));
+    report.param("cmd_buffer", std::to_string(UART_CMD_BUFFER_SIZE));
+
+    benchRing(report, lines * 64);
+    benchTokenize(report, lines);
+    // Первый прогон прогревает кэши и ленивую инициализацию (очередь лога)
+    feed("GET PWM\r\n");
+    for (const Pipeline* pipeline : { &valid, &malformed, &batch, &overlong, &mixedPipeline }) {
+        benchPipeline(report, *pipeline, pipeline == &overlong ? lines / 8 : lines);
+    }
+    benchLatency(report, mixed, lines / 4);
+
+    report.metric("commands", Stats::counter(STAT_COMMANDS), "count", "info");
+    report.metric("command_errors", Stats::counter(STAT_COMMAND_ERRORS), "count", "info");
+    report.metric("cmd_overflows", Stats::counter(STAT_CMD_OVERFLOWS), "count", "info");
+    report.metric("rx_overflows", Stats::counter(STAT_RX_OVERFLOWS), "count", "lower");
+    report.metric("driver_rx_overflows", benchSerial.overflows(), "bytes", "lower");
+    report.print(json);
+    return 0;
+}
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""
+Сравнение результатов бенчмарков (tools/bench/run.sh) с базовыми.
+
+Принимает два JSON-отчёта или два каталога с ними (сравниваются файлы с
+одинаковыми именами). Метрика с better=higher регрессирует, если упала
+больше допуска, с better=lower - если выросла больше допуска; рост от
+нуля (выделения памяти, потери) - регрессия при любом значении. Метрики
+info не сравниваются.
+
+Время и пропускная способность на общей машине (CI, виртуалка с одним
+ядром) гуляют на десятки процентов между соседними прогонами; там
+сравниваются только точные счётчики - выделения, потери, байты ответа:
+
+  python3 tools/bench/compare.py base/ current/ [--tolerance 15] [--counts-only]
+
+Код возврата 1 - есть регрессии; пригоден для проверки в CI.
+"""
+
+import argparse
+import json
+import os
+import sys
+
+DEFAULT_TOLERANCE = 15.0  # Проценты, для замеров времени на свободной машине
+TIMING_UNITS = {'MB/s', 'B/s', 'lines/s', 'cmd/s', 'ns', 'us'}
+
+
+def load(path):
+    with open(path) as f:
+        report = json.load(f)
+    return report['suite'], {m['name']: m for m in report['metrics']}
+
+
+def pairs(baseline, current):
+    if os.path.isdir(baseline):
+        for name in sorted(os.listdir(baseline)):
+            if name.endswith('.json') and os.path.exists(os.path.join(current, name)):
+                yield name, os.path.join(baseline, name), os.path.join(current, name)
+    else:
+        yield os.path.basename(current), baseline, current
+
+
+def compare(base, metrics, tolerance, counts_only):
+    """Строки отчёта и число регрессий."""
+    lines = []
+    regressions = 0
+    for name, metric in metrics.items():
+        if metric['better'] == 'info' or name not in base:
+            continue
+        if counts_only and metric['unit'] in TIMING_UNITS:
+            continue
+        old = base[name]['value']
+        new = metric['value']
+        if old == 0:
+            worse = new > 0 if metric['better'] == 'lower' else False
+            change = 0.0 if new == 0 else float('inf')
+        else:
+            change = (new - old) / abs(old) * 100
+            worse = change < -tolerance if metric['better'] == 'higher' else change > tolerance
+        regressions += worse
+        lines.append('%-4s %-44s %14.2f -> %14.2f %s (%+.1f%%)' % (
+            'FAIL' if worse else 'ok', name, old, new, metric['unit'], change))
+    return lines, regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('baseline', help='базовый отчёт или каталог')
+    parser.add_argument('current', help='новый отчёт или каталог')
+    parser.add_argument('--tolerance', type=float, default=DEFAULT_TOLERANCE, help='допуск, %%')
+    parser.add_argument('--counts-only', action='store_true', help='не сравнивать время и пропускную способность')
+    args = parser.parse_args()
+
+    total = 0
+    for name, base_path, current_path in pairs(args.baseline, args.current):
+        _, base = load(base_path)
+        suite, metrics = load(current_path)
+        lines, regressions = compare(base, metrics, args.tolerance, args.counts_only)
+        print('%s (%s)' % (name, suite))
+        for line in lines:
+            print('  ' + line)
+        total += regressions
+
+    print('regressions: %d' % total)
+    return 1 if total else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
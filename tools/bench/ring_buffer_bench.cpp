@@ -0,0 +1,115 @@
+/**
+ * Хостовый бенчмарк пропускной способности RingBuffer (src/common/ring_buffer.h).
+ *
+ * Производитель и потребитель работают в разных потоках, как ISR и задача на
+ * устройстве. Меряется поэлементный put/get и пакетные write/read с разным
+ * размером порции; каждый прогон проверяет порядок и целостность данных.
+ *
+ * Сборка и запуск:
+ *   g++ -O2 -std=gnu++17 -pthread -Isrc tools/bench/ring_buffer_bench.cpp -o ring_buffer_bench
+ *   ./ring_buffer_bench [мегабайт на прогон]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "common/ring_buffer.h"
+
+namespace {
+
+const size_t CAPACITY = 256;  // Как UART_RX_BUFFER_SIZE на устройстве
+
+struct Result {
+    double megabytesPerSecond;
+    bool valid;
+};
+
+// chunk == 0 - поэлементный put/get. При пустом/полном буфере поток уступает
+// процессор, иначе на одноядерной машине прогон упирается в квант планировщика.
+Result run(size_t totalBytes, size_t chunk) {
+    RingBuffer<uint8_t, CAPACITY> ring;
+    bool valid = true;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread producer([&]() {
+        std::vector<uint8_t> block(chunk ? chunk : 1);
+        size_t sent = 0;
+        while (sent < totalBytes) {
+            if (chunk == 0) {
+                if (ring.put((uint8_t)sent)) {
+                    sent++;
+                } else {
+                    std::this_thread::yield();
+                }
+                continue;
+            }
+            size_t count = std::min(chunk, totalBytes - sent);
+            for (size_t i = 0; i < count; i++) {
+                block[i] = (uint8_t)(sent + i);
+            }
+            size_t offset = 0;
+            while (offset < count) {
+                size_t written = ring.write(block.data() + offset, count - offset);
+                if (written == 0) {
+                    std::this_thread::yield();
+                }
+                offset += written;
+            }
+            sent += count;
+        }
+    });
+
+    std::vector<uint8_t> block(chunk ? chunk : 1);
+    size_t received = 0;
+    while (received < totalBytes) {
+        if (chunk == 0) {
+            uint8_t value;
+            if (ring.get(&value)) {
+                valid &= (value == (uint8_t)received);
+                received++;
+            } else {
+                std::this_thread::yield();
+            }
+            continue;
+        }
+        size_t count = ring.read(block.data(), chunk);
+        if (count == 0) {
+            std::this_thread::yield();
+        }
+        for (size_t i = 0; i < count; i++) {
+            valid &= (block[i] == (uint8_t)(received + i));
+        }
+        received += count;
+    }
+
+    producer.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return Result{ totalBytes / seconds / 1e6, valid };
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? strtoul(argv[1], nullptr, 10) : 16;
+    size_t totalBytes = megabytes * 1024 * 1024;
+    const size_t chunks[] = { 0, 1, 8, 32, 64, 128 };
+
+    printf("RingBuffer<uint8_t, %zu>, %zu MB per run\n", CAPACITY, megabytes);
+    printf("%-10s %12s %8s\n", "mode", "MB/s", "check");
+    bool allValid = true;
+    for (size_t chunk : chunks) {
+        Result result = run(totalBytes, chunk);
+        char mode[32];
+        if (chunk == 0) {
+            snprintf(mode, sizeof(mode), "put/get");
+        } else {
+            snprintf(mode, sizeof(mode), "bulk %zu", chunk);
+        }
+        printf("%-10s %12.1f %8s\n", mode, result.megabytesPerSecond, result.valid ? "ok" : "FAIL");
+        allValid &= result.valid;
+    }
+    return allValid ? 0 : 1;
+}
@@ -0,0 +1,43 @@
+#!/bin/sh
+# Сборка и прогон хостовых бенчмарков конвейера команд и скана панели клавиш, результаты - JSON.
+#
+#   tools/bench/run.sh                         результаты в .pio/bench/results
+#   tools/bench/run.sh DIR                     результаты в DIR
+#   BASELINE=DIR tools/bench/run.sh            затем сравнить с прошлым прогоном (compare.py)
+#   BASELINE=DIR COMPARE="--counts-only" ...   на общей машине - только точные счётчики
+#
+# Сценарии uart_load:
+#   line       115200 бод, задача без задержки - штатный режим, потерь быть не должно
+#   preempted  921600 бод, задача будится с опозданием 2 мс - запас буфера драйвера
+#   flood      залп без темпа линии - предельная пропускная способность и потери
+#
+# Сборка - g++ с флагами [env:native], без sim_main; SECONDS_PER_RUN задаёт длительность.
+
+set -e
+cd "$(dirname "$0")/../.."
+
+OUT=${1:-.pio/bench/results}
+BIN=.pio/bench
+SECONDS_PER_RUN=${SECONDS_PER_RUN:-3}
+mkdir -p "$BIN" "$OUT"
+
+SOURCES="src/uart/uart.cpp src/uart/telemetry.cpp src/common/stats.cpp src/common/trace.cpp \
+    src/common/logger.cpp src/common/rtos.cpp src/hal/native/hal_native.cpp src/hal/native/esp_timer_native.cpp"
+for bench in command_bench uart_load; do
+    g++ -std=gnu++17 -O2 -DHAL_NATIVE -Isrc/hal/native/include -Isrc "tools/bench/$bench.cpp" $SOURCES \
+        -pthread -lutil -o "$BIN/$bench"
+done
+g++ -std=gnu++17 -O2 -DHAL_NATIVE -Isrc/hal/native/include -Isrc tools/bench/button_bench.cpp \
+    src/button/button_bank.cpp src/button/gesture.cpp $SOURCES -o "$BIN/button_bench"
+
+"$BIN/command_bench" --json > "$OUT/command_bench.json"
+"$BIN/uart_load" --json --seconds "$SECONDS_PER_RUN" > "$OUT/uart_load_line.json"
+"$BIN/uart_load" --json --seconds "$SECONDS_PER_RUN" --baud 921600 --task-latency-us 2000 \
+    > "$OUT/uart_load_preempted.json"
+"$BIN/uart_load" --json --seconds "$SECONDS_PER_RUN" --baud 0 > "$OUT/uart_load_flood.json"
+"$BIN/button_bench" --json > "$OUT/button_bench.json"
+echo "results: $OUT"
+
+if [ -n "$BASELINE" ]; then
+    python3 tools/bench/compare.py $COMPARE "$BASELINE" "$OUT"
+fi
@@ -0,0 +1,473 @@
+/**
+ * Генератор нагрузки на конвейер команд через псевдотерминал (pty).
+ *
+ * Прошивочная сторона - настоящий UARTCommandHandler в сборке HAL_NATIVE,
+ * порт - ведомая сторона pty. Между ними модель драйвера UART ESP32:
+ * поток "драйвер" непрерывно принимает байты в буфер размером
+ * UART_RX_BUFFER_SIZE (setRxBufferSize) и теряет всё, что не поместилось;
+ * поток "задача" будится по приёму, спит --task-latency-us (вытеснение
+ * более приоритетной задачей) и вызывает processCommands.
+ *
+ * Генератор пишет в ведущую сторону смесь строк (корректные, ошибочные,
+ * слишком длинные, пакеты через ';') с темпом --baud (0 - без ограничения,
+ * залп), приёмник сопоставляет ответы строкам по порядку и меряет
+ * задержку от отправки строки до последнего её ответа.
+ *
+ * ПОТЕРИ: кольцо приёма разбирается после каждой порции чтения, поэтому
+ * rx_overflows (переполнение кольца) на практике не растёт - данные
+ * теряются раньше, в буфере драйвера (driver_rx_overflow_bytes). После
+ * первой потери строки склеиваются и сопоставление ответов теряет смысл:
+ * задержка считается только по строкам до неё (latency_samples).
+ *
+ * Сборка и запуск (tools/bench/run.sh собирает и запускает все бенчмарки):
+ *   g++ -O2 -std=gnu++17 -DHAL_NATIVE -Isrc/hal/native/include -Isrc tools/bench/uart_load.cpp \
+ *       src/uart/uart.cpp src/uart/telemetry.cpp src/common/stats.cpp src/common/trace.cpp \
+ *       src/common/logger.cpp src/common/rtos.cpp src/hal/native/hal_native.cpp \
+ *       src/hal/native/esp_timer_native.cpp -pthread -lutil -o uart_load
+ *   ./uart_load [--seconds S] [--baud B] [--task-latency-us US] [--mix V,M,L,B] [--seed N] [--json]
+ */
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <poll.h>
+#include <pty.h>
+#include <termios.h>
+#include <unistd.h>
+#include "bench_common.h"
+#include "uart/uart.h"
+
+namespace {
+
+// ============================================================================
+// Прошивочная сторона: модель драйвера UART поверх pty
+// ============================================================================
+
+class PtySerial : public Hal::SerialPort {
+public:
+    explicit PtySerial(int fd) : fd_(fd), capacity_(UART_RX_BUFFER_SIZE), head_(0), count_(0), drops_(0) {}
+
+    // Поток драйвера: приём с линии в буфер, лишнее теряется
+    void receive(const uint8_t* data, size_t length) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 0; i < length; i++) {
+                if (count_ < capacity_) {
+                    buffer_[(head_ + count_) % capacity_] = data[i];
+                    count_++;
+                } else {
+                    drops_++;
+                }
+            }
+        }
+        received_.notify_one();
+    }
+
+    // Поток задачи: ожидание приёма (аналог ulTaskNotifyTake)
+    void waitForData(int timeoutMs) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        received_.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() { return count_ > 0; });
+    }
+
+    void wake() {
+        received_.notify_all();
+    }
+
+    uint64_t drops() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return drops_;
+    }
+
+    size_t setRxBufferSize(size_t size) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        capacity_ = std::min(size, sizeof(buffer_));
+        return capacity_;
+    }
+
+    int available() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return (int)count_;
+    }
+
+    size_t read(uint8_t* buffer, size_t size) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t taken = 0;
+        while (taken < size && count_ > 0) {
+            buffer[taken++] = buffer_[head_];
+            head_ = (head_ + 1) % capacity_;
+            count_--;
+        }
+        return taken;
+    }
+
+    int availableForWrite() override {
+        return INT32_MAX;
+    }
+
+    size_t write(const uint8_t* data, size_t size) override {
+        size_t written = 0;
+        while (written < size) {
+            ssize_t result = ::write(fd_, data + written, size - written);
+            if (result <= 0) {
+                break;
+            }
+            written += result;
+        }
+        return written;
+    }
+
+private:
+    int fd_;
+    std::mutex mutex_;
+    std::condition_variable received_;
+    uint8_t buffer_[4096];
+    size_t capacity_;
+    size_t head_;
+    size_t count_;
+    uint64_t drops_;
+};
+
+// ============================================================================
+// Смесь строк
+// ============================================================================
+
+enum LineKind { LINE_VALID, LINE_MALFORMED, LINE_LONG, LINE_BATCH, LINE_KIND_COUNT };
+
+struct Line {
+    std::string text;           // С "\r\n"
+    uint8_t responses;          // Строк ответа: по одной на непустую команду
+    size_t answerAt;            // Байт, после которого возможен ответ
+};
+
+// Ответов на строку: каждая команда через ';' отвечает одной строкой,
+// слишком длинная строка - одной ошибкой
+uint8_t expectedResponses(const std::string& text, LineKind kind) {
+    if (kind == LINE_LONG) {
+        return 1;
+    }
+    uint8_t count = 0;
+    bool words = false;
+    for (char c : text) {
+        if (c == ';') {
+            count += words;
+            words = false;
+        } else if (c != ' ') {
+            words = true;
+        }
+    }
+    return count + words;
+}
+
+std::string makeLine(LineKind kind, std::mt19937& random) {
+    auto number = [&](uint32_t limit) { return std::to_string(random() % limit); };
+    switch (kind) {
+        case LINE_VALID:
+            switch (random() % 4) {
+                case 0: return "SET PWM " + number(101);
+                case 1: return "SET PWM 0 " + number(101);
+                case 2: return "SET PERMILLE 0 " + number(1001);
+                default: return "GET PWM";
+            }
+        case LINE_MALFORMED: {
+            // Мусор с буквы, без ';', '@' и нуля - иначе это пакет, адрес или бинарный кадр
+            const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 -+.,";
+            std::string text = "X";
+            size_t length = 1 + random() % 40;
+            for (size_t i = 0; i < length; i++) {
+                text += alphabet[random() % (sizeof(alphabet) - 1)];
+            }
+            return text;
+        }
+        case LINE_LONG:
+            return "SET PWM " + std::string(UART_CMD_BUFFER_SIZE + random() % (UART_CMD_BUFFER_SIZE * 2), '5');
+        default:
+            return "SET PWM " + number(101) + "; GET PWM; SET PWM 0 " + number(101);
+    }
+}
+
+// ============================================================================
+// Ожидаемые ответы: строки в порядке отправки
+// ============================================================================
+
+struct Pending {
+    std::chrono::steady_clock::time_point sent;
+    uint8_t responses;
+};
+
+struct Matcher {
+    std::mutex mutex;
+    std::deque<Pending> pending;
+    std::vector<double> latenciesUs;
+    uint64_t responses = 0;
+    uint64_t errors = 0;
+    uint64_t unexpected = 0;
+    bool valid = true;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    double seconds = 2.0;
+    uint32_t baud = UART_BAUDRATE;
+    uint32_t taskLatencyUs = 0;
+    uint32_t seed = 1;
+    uint32_t weights[LINE_KIND_COUNT] = { 70, 15, 5, 10 };
+    bool json = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--baud") == 0 && i + 1 < argc) {
+            baud = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--task-latency-us") == 0 && i + 1 < argc) {
+            taskLatencyUs = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--mix") == 0 && i + 1 < argc &&
+                   sscanf(argv[++i], "%u,%u,%u,%u", &weights[0], &weights[1], &weights[2], &weights[3]) == 4) {
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else {
+            fprintf(stderr,
+                    "usage: %s [--seconds S] [--baud B (0 - flood)] [--task-latency-us US] [--mix V,M,L,B] "
+                    "[--seed N] [--json]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    int master;
+    int slave;
+    if (openpty(&master, &slave, nullptr, nullptr, nullptr) < 0) {
+        perror("openpty");
+        return 1;
+    }
+    // Сырой режим: без эха и замены \r/\n, байты идут как по проводу
+    termios mode;
+    tcgetattr(slave, &mode);
+    cfmakeraw(&mode);
+    tcsetattr(slave, TCSANOW, &mode);
+
+    Bench::RealClock clock;
+    PtySerial serial(slave);
+    Hal::install(&clock, nullptr, nullptr, &serial);
+
+    static uint8_t stubDuty = 0;
+    UARTCommandHandler handler;
+    handler.begin();
+    handler.setPWMCallback([](uint8_t duty) {
+        stubDuty = duty;
+        return true;
+    });
+    handler.getPWMCallback([]() { return stubDuty; });
+    handler.setChannelPWMCallback([](uint8_t channel, uint8_t duty) {
+        stubDuty = duty;
+        return channel == 0;
+    });
+    handler.setPermilleCallback([](uint8_t channel, uint16_t permille) { return channel == 0; });
+
+    // Заранее сгенерированный пул строк: генератор в залпе не должен быть узким местом
+    std::mt19937 random(seed);
+    uint32_t totalWeight = weights[0] + weights[1] + weights[2] + weights[3];
+    if (totalWeight == 0) {
+        fprintf(stderr, "--mix: all weights are zero\n");
+        return 2;
+    }
+    std::vector<Line> pool;
+    for (int i = 0; i < 4096; i++) {
+        uint32_t pick = random() % totalWeight;
+        int kind = 0;
+        while (pick >= weights[kind]) {
+            pick -= weights[kind++];
+        }
+        std::string text = makeLine((LineKind)kind, random);
+        // Слишком длинная строка отвергается, как только заполнен буфер команды, не дожидаясь конца
+        size_t answerAt = kind == LINE_LONG ? UART_CMD_BUFFER_SIZE - 1 : text.size() + 1;
+        pool.push_back({ text + "\r\n", expectedResponses(text, (LineKind)kind), answerAt });
+    }
+
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> taskAllocations(0);
+
+    // Драйвер: приём с линии порциями аппаратного FIFO
+    std::thread driver([&]() {
+        uint8_t fifo[128];
+        pollfd descriptor = { slave, POLLIN, 0 };
+        while (!stop) {
+            if (poll(&descriptor, 1, 10) > 0) {
+                ssize_t length = ::read(slave, fifo, sizeof(fifo));
+                if (length > 0) {
+                    serial.receive(fifo, length);
+                }
+            }
+        }
+    });
+
+    // Задача UART: пробуждение по приёму, задержка планировщика, разбор
+    std::thread task([&]() {
+        uint64_t before = Bench::threadAllocations;
+        while (!stop) {
+            serial.waitForData(10);
+            if (serial.available() == 0) {
+                continue;
+            }
+            if (taskLatencyUs) {
+                std::this_thread::sleep_for(std::chrono::microseconds(taskLatencyUs));
+            }
+            handler.processCommands();
+        }
+        taskAllocations = Bench::threadAllocations - before;
+    });
+
+    // Приёмник ответов
+    Matcher matcher;
+    std::thread receiver([&]() {
+        char buffer[4096];
+        std::string line;
+        pollfd descriptor = { master, POLLIN, 0 };
+        while (!stop) {
+            if (poll(&descriptor, 1, 10) <= 0) {
+                continue;
+            }
+            ssize_t length = ::read(master, buffer, sizeof(buffer));
+            auto now = std::chrono::steady_clock::now();
+            for (ssize_t i = 0; i < length; i++) {
+                if (buffer[i] == '\r') {
+                    continue;
+                }
+                if (buffer[i] != '\n') {
+                    line += buffer[i];
+                    continue;
+                }
+                std::lock_guard<std::mutex> lock(matcher.mutex);
+                matcher.responses++;
+                matcher.errors += line.compare(0, 6, "ERROR:") == 0;
+                line.clear();
+                if (serial.drops() > 0) {
+                    matcher.valid = false;
+                }
+                if (matcher.pending.empty()) {
+                    matcher.unexpected++;
+                    matcher.valid = false;
+                    continue;
+                }
+                Pending& head = matcher.pending.front();
+                if (--head.responses == 0) {
+                    if (matcher.valid) {
+                        matcher.latenciesUs.push_back(
+                            std::chrono::duration<double, std::micro>(now - head.sent).count());
+                    }
+                    matcher.pending.pop_front();
+                }
+            }
+        }
+    });
+
+    /**
+     * ГЕНЕРАТОР:
+     * 1. Строка пишется порциями по UART_RX_CHUNK_SIZE; с --baud каждая
+     *    порция ждёт своего времени на линии (10 бит на байт), так что
+     *    длинная строка приходит в драйвер постепенно, как по проводу
+     * 2. Строка ставится в очередь ожидания перед порцией с байтом, после
+     *    которого возможен ответ (конец строки или переполнение буфера
+     *    команды): ответ не обгонит её, задержка считается от этой порции
+     * 3. Без --baud (0) - залп, ограниченный только буфером pty
+     */
+    uint64_t linesSent = 0;
+    uint64_t bytesSent = 0;
+    uint64_t responsesExpected = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration<double>(seconds);
+    auto next = start;
+    auto writeAll = [&](const char* data, size_t length) {
+        while (length > 0) {
+            ssize_t result = ::write(master, data, length);
+            if (result <= 0) {
+                return;
+            }
+            data += result;
+            length -= result;
+            bytesSent += result;
+        }
+    };
+    while (std::chrono::steady_clock::now() < deadline) {
+        const Line& line = pool[linesSent % pool.size()];
+        for (size_t offset = 0; offset < line.text.size(); offset += UART_RX_CHUNK_SIZE) {
+            size_t length = std::min(line.text.size() - offset, (size_t)UART_RX_CHUNK_SIZE);
+            if (baud) {
+                // Проспавший генератор не догоняет очередью порций: линия не быстрее скорости
+                std::this_thread::sleep_until(next);
+                next = std::max(next, std::chrono::steady_clock::now());
+                next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(length * 10.0 / baud));
+            }
+            if (offset <= line.answerAt && line.answerAt < offset + length) {
+                std::lock_guard<std::mutex> lock(matcher.mutex);
+                matcher.pending.push_back({ std::chrono::steady_clock::now(), line.responses });
+            }
+            writeAll(line.text.data() + offset, length);
+        }
+        linesSent++;
+        responsesExpected += line.responses;
+    }
+    double sendSeconds = Bench::secondsSince(start);
+
+    // Дожидаемся хвоста ответов: до опустевшей очереди или секунды тишины
+    uint64_t lastResponses = ~0ULL;
+    auto quietSince = std::chrono::steady_clock::now();
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        std::lock_guard<std::mutex> lock(matcher.mutex);
+        if (matcher.pending.empty()) {
+            break;
+        }
+        if (matcher.responses != lastResponses) {
+            lastResponses = matcher.responses;
+            quietSince = std::chrono::steady_clock::now();
+        } else if (Bench::secondsSince(quietSince) > 1.0) {
+            break;
+        }
+    }
+    double totalSeconds = Bench::secondsSince(start);
+    stop = true;
+    serial.wake();
+    driver.join();
+    task.join();
+    receiver.join();
+    close(master);
+    close(slave);
+
+    Bench::Report report("uart_load");
+    report.param("seconds", std::to_string(seconds));
+    report.param("baud", baud ? std::to_string(baud) : "flood");
+    report.param("task_latency_us", std::to_string(taskLatencyUs));
+    report.param("mix", std::to_string(weights[0]) + "," + std::to_string(weights[1]) + "," +
+                            std::to_string(weights[2]) + "," + std::to_string(weights[3]));
+    report.param("seed", std::to_string(seed));
+    report.param("rx_buffer", std::to_string(UART_RX_BUFFER_SIZE));
+
+    uint32_t commands = Stats::counter(STAT_COMMANDS);
+    // В залпе потери заложены в сценарий, а задержка меряется до первой потери - по ним
+    // регрессия считается только на скорости линии
+    const char* loss = baud ? "lower" : "info";
+    uint64_t missing = responsesExpected > matcher.responses ? responsesExpected - matcher.responses : 0;
+    report.metric("lines_sent", linesSent, "lines", "info");
+    report.metric("offered_bytes_per_s", bytesSent / sendSeconds, "B/s", "info");
+    report.metric("lines_per_s", linesSent / sendSeconds, "lines/s", "higher");
+    report.metric("commands_per_s", commands / totalSeconds, "cmd/s", "higher");
+    report.metric("responses", matcher.responses, "lines", "info");
+    report.metric("responses_missing", missing, "lines", loss);
+    report.metric("responses_unexpected", matcher.unexpected, "lines", loss);
+    report.metric("error_responses", matcher.errors, "lines", "info");
+    report.metric("command_errors", Stats::counter(STAT_COMMAND_ERRORS), "count", "info");
+    report.metric("cmd_overflows", Stats::counter(STAT_CMD_OVERFLOWS), "count", "info");
+    report.metric("rx_overflows", Stats::counter(STAT_RX_OVERFLOWS), "count", "lower");
+    report.metric("driver_rx_overflow_bytes", serial.drops(), "bytes", loss);
+    report.metric("latency_samples", matcher.latenciesUs.size(), "lines", "info");
+    report.latency("latency_line", matcher.latenciesUs, "us", loss);
+    report.metric("allocations_per_command", commands ? (double)taskAllocations / commands : 0, "allocs", "lower");
+    report.print(json);
+    return 0;
+}
@@ -0,0 +1,443 @@
+/**
+ * Хостовая модель общей шины RS-485 из нескольких узлов (src/uart/bus_address.h).
+ *
+ * Каждый узел - отдельный процесс с настоящей прошивкой в сборке HAL_NATIVE:
+ * UARTCommandHandler, PWMActor, PWMController, секвенсор, контур и Logger,
+ * связанные App::wire, как в main.cpp. Порт узла - SimSerial: принятые байты
+ * он получает из своего псевдотерминала, ответы, телеметрию и лог пишет туда
+ * же. Часы - VirtualClock, подтягиваемый к реальному времени, поэтому таймеры
+ * (STREAM, такт ШИМ) идут как на устройстве. Процессы, а не потоки - потому
+ * что HAL, лог и счётчики прошивки глобальные.
+ *
+ * Концентратор играет роль линии: строку ведущего пишет во все порты, вывод
+ * собирает со всех и считает столкновения - больше одного узла, передававшего
+ * в ответ на одну строку. Строка лога на линии - тоже передача.
+ *
+ * Узлы стартуют без адреса (BUS_NODE_ADDRESS 0) и вводятся в строй по своему
+ * порту: "SET ADDRESS N", затем "@N SET GROUP 200|201 1" по чётности адреса.
+ *
+ * Сценарии: адресные команды и ошибка, широковещательная и групповая без
+ * ответов и без лога, строки без адреса и для отсутствующего узла,
+ * широковещательный STREAM (отвергается молча) и адресный (передаёт только
+ * свой узел), затем поток случайных адресных команд - каждая должна
+ * выполниться ровно одним узлом, а чужие строки отбрасываться до разбора
+ * (счётчик FOREIGN_LINES).
+ *
+ * Сборка и запуск:
+ *   g++ -O2 -std=gnu++17 -DHAL_NATIVE -DDEBUG -Isrc/hal/native/include -Isrc tools/bus_sim.cpp \
+ *       src/app/app.cpp src/button/button.cpp src/button/button_bank.cpp src/button/gesture.cpp \
+ *       src/pwm/pwm.cpp src/pwm/pwm_actor.cpp src/pwm/sequencer.cpp src/pwm/closed_loop.cpp \
+ *       src/uart/uart.cpp src/uart/telemetry.cpp src/common/event_bus.cpp src/common/logger.cpp \
+ *       src/common/reactor.cpp src/common/rtos.cpp src/common/stats.cpp src/common/trace.cpp \
+ *       src/hal/native/hal_native.cpp src/hal/native/esp_timer_native.cpp src/sim/sim_hal.cpp \
+ *       -o bus_sim -lutil
+ *   ./bus_sim [NODES] [RANDOM_COMMANDS]
+ */
+
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "app/app.h"
+#include "common/logger.h"
+#include "hal/native/hal_native.h"
+#include "sim/sim_hal.h"
+
+namespace {
+
+const int DEFAULT_NODES = 8;
+const int DEFAULT_RANDOM_COMMANDS = 200;
+const int QUIET_MS = 30;                  // Тишина на линии - ответы на команду закончились
+const int LISTEN_MS = 350;                // Окно наблюдения за STREAM (выборка 10 Гц - 3 строки и больше)
+const uint8_t GROUP_EVEN = 200;           // Узлы с чётным адресом
+const uint8_t GROUP_ODD = 201;
+
+// ============================================================================
+// Узел
+// ============================================================================
+
+PWMActor* nodeActor = nullptr;
+
+// Владелец ШИМ выполняет команду прямо из уведомления, как задача с высшим приоритетом
+void runPwmTask(tskTaskControlBlock* task) {
+    static bool running = false;
+    if (running) {
+        return;
+    }
+    running = true;
+    task->notifyValue = 0;
+    nodeActor->processNext(0);
+    running = false;
+}
+
+tskTaskControlBlock uartTask = { "UART", 0 };
+tskTaskControlBlock pwmTask = { "PWM", 0, runPwmTask };
+
+void writePort(const uint8_t* data, size_t length, void* context) {
+    int fd = *static_cast<int*>(context);
+    if (write(fd, data, length) != (ssize_t)length) {
+        perror("node write");
+    }
+}
+
+// Процесс узла: прошивка на моделях железа, линия - порт псевдотерминала
+[[noreturn]] void runNode(int portFd) {
+    static Hal::VirtualClock clock;
+    static SimGpio gpio;
+    static SimLedc ledc;
+    static SimSerial serial;
+    static int fd = portFd;
+    Hal::install(&clock, &gpio, &ledc, &serial);
+    serial.setTxListener(writePort, &fd);
+
+    Button button(BUTTON_PIN);
+    PWMController pwm(LED_PWM_PIN);
+    PWMActor actor(pwm);
+    PWMSequencer sequencer(pwm);
+    PWMClosedLoop loop(pwm, PWM_LOOP_CHANNEL);
+    UARTCommandHandler uart;
+    nodeActor = &actor;
+
+    button.begin();
+    pwm.begin();
+    actor.begin();
+    sequencer.begin();
+    loop.begin([]() { return (uint16_t)0; });
+    uart.begin();
+    App::Modules modules = { &button, nullptr, &actor, &sequencer, &loop, &uart };
+    App::wire(modules);
+    uart.notifyTask(&uartTask, 1);
+    actor.notifyTask(&pwmTask, 1);
+
+    auto started = std::chrono::steady_clock::now();
+    uint8_t chunk[UART_RX_CHUNK_SIZE];
+    while (true) {
+        pollfd descriptor = { fd, POLLIN, 0 };
+        if (poll(&descriptor, 1, 1) > 0) {
+            ssize_t received = read(fd, chunk, sizeof(chunk));
+            if (received <= 0) {
+                _exit(0);  // Концентратор закрыл линию
+            }
+            serial.inject(chunk, received);
+        }
+        clock.setNow(std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now() - started).count());
+        clock.runDueTimers();
+        if (uartTask.notifyValue) {
+            uartTask.notifyValue = 0;
+            uart.processCommands();
+        }
+        while (Logger::drain()) {
+        }
+    }
+}
+
+struct Node {
+    uint8_t address;
+    int hubFd;                            // Сторона линии (ведущий пишет сюда)
+    pid_t pid;
+};
+
+bool openPort(int& hubFd, int& portFd) {
+    if (openpty(&hubFd, &portFd, nullptr, nullptr, nullptr) != 0) {
+        perror("openpty");
+        return false;
+    }
+    // Обе стороны - сырой режим, как UART: без эха и построчной обработки
+    termios settings;
+    for (int fd : { hubFd, portFd }) {
+        tcgetattr(fd, &settings);
+        cfmakeraw(&settings);
+        tcsetattr(fd, TCSANOW, &settings);
+    }
+    return true;
+}
+
+// ============================================================================
+// Линия
+// ============================================================================
+
+class Bus {
+public:
+    explicit Bus(std::vector<Node>& nodes) : nodes_(nodes), collisions_(0) {
+    }
+
+    // Строка ведущего уходит во все порты; вывод узлов собирается до тишины на линии
+    std::vector<std::string> transact(const std::string& command) {
+        std::string line = command + "\r\n";
+        for (Node& node : nodes_) {
+            send(node, line);
+        }
+        std::vector<std::string> output = collect(0);
+        if (talkers(output) > 1) {
+            collisions_++;
+        }
+        return output;
+    }
+
+    // Строка в порт одного узла (ввод в строй); вывод отбрасывается
+    void direct(size_t index, const std::string& command) {
+        send(nodes_[index], command + "\r\n");
+        collect(0);
+    }
+
+    // Вывод узлов без передачи ведущего: не меньше minMs, затем до тишины
+    std::vector<std::string> collect(int minMs) {
+        std::vector<std::string> output(nodes_.size());
+        std::vector<pollfd> descriptors;
+        for (Node& node : nodes_) {
+            descriptors.push_back({ node.hubFd, POLLIN, 0 });
+        }
+        auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(minMs);
+        char buffer[512];
+        while (true) {
+            int remaining = (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+                                until - std::chrono::steady_clock::now()).count();
+            if (poll(descriptors.data(), descriptors.size(), remaining > QUIET_MS ? remaining : QUIET_MS) <= 0 &&
+                remaining <= 0) {
+                break;
+            }
+            for (size_t i = 0; i < descriptors.size(); i++) {
+                if (descriptors[i].revents & POLLIN) {
+                    ssize_t count = read(descriptors[i].fd, buffer, sizeof(buffer));
+                    if (count > 0) {
+                        output[i].append(buffer, count);
+                    }
+                }
+            }
+        }
+        return output;
+    }
+
+    static int talkers(const std::vector<std::string>& output) {
+        int count = 0;
+        for (const std::string& text : output) {
+            count += !text.empty();
+        }
+        return count;
+    }
+
+    int collisions() const {
+        return collisions_;
+    }
+
+private:
+    void send(Node& node, const std::string& line) {
+        if (write(node.hubFd, line.data(), line.size()) != (ssize_t)line.size()) {
+            perror("bus write");
+        }
+    }
+
+    std::vector<Node>& nodes_;
+    int collisions_;
+};
+
+int failures = 0;
+
+void expect(bool condition, const char* scenario, const char* what) {
+    printf("%-40s %-44s %s\n", scenario, what, condition ? "ok" : "FAIL");
+    failures += !condition;
+}
+
+bool onlyNode(const std::vector<std::string>& output, size_t node, const std::string& text) {
+    return Bus::talkers(output) == 1 && output[node] == text;
+}
+
+// Значение GET PWM узла, -1 - ответ не тот
+int dutyOf(Bus& bus, const Node& node, size_t index) {
+    char command[16];
+    snprintf(command, sizeof(command), "@%u GET PWM", node.address);
+    std::vector<std::string> output = bus.transact(command);
+    char prefix[8];
+    int length = snprintf(prefix, sizeof(prefix), "@%u ", node.address);
+    if (Bus::talkers(output) != 1 || output[index].compare(0, length, prefix) != 0) {
+        return -1;
+    }
+    return atoi(output[index].c_str() + length);
+}
+
+// Счётчик STATS узла, -1 - нет в ответе
+long counterOf(Bus& bus, const Node& node, size_t index, const char* name) {
+    char command[16];
+    snprintf(command, sizeof(command), "@%u STATS", node.address);
+    std::vector<std::string> output = bus.transact(command);
+    char key[64];
+    snprintf(key, sizeof(key), "@%u STATS COUNTER %s ", node.address, name);
+    size_t at = output[index].find(key);
+    return at == std::string::npos ? -1 : atol(output[index].c_str() + at + strlen(key));
+}
+
+size_t countLines(const std::string& text, const char* start) {
+    size_t count = 0;
+    for (size_t at = 0; at < text.size();) {
+        size_t end = text.find('\n', at);
+        count += text.compare(at, strlen(start), start) == 0;
+        at = end == std::string::npos ? text.size() : end + 1;
+    }
+    return count;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int nodeCount = argc > 1 ? atoi(argv[1]) : DEFAULT_NODES;
+    int randomCommands = argc > 2 ? atoi(argv[2]) : DEFAULT_RANDOM_COMMANDS;
+    if (nodeCount < 3 || nodeCount > BUS_ADDRESS_MAX) {
+        fprintf(stderr, "NODES must be 3-%u\n", BUS_ADDRESS_MAX);
+        return 2;
+    }
+
+    std::vector<Node> nodes;
+    for (int i = 0; i < nodeCount; i++) {
+        int hubFd, portFd;
+        if (!openPort(hubFd, portFd)) {
+            return 2;
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return 2;
+        }
+        if (pid == 0) {
+            close(hubFd);
+            for (Node& node : nodes) {
+                close(node.hubFd);
+            }
+            runNode(portFd);
+        }
+        close(portFd);
+        nodes.push_back({ (uint8_t)(i + 1), hubFd, pid });
+    }
+    Bus bus(nodes);
+
+    /**
+     * ВВОД В СТРОЙ:
+     * 1. Узел без адреса отвечает и пишет лог без префикса - только в свой порт
+     * 2. После SET ADDRESS лог на линию не выходит, ответы - с префиксом
+     */
+    bus.collect(100);  // Лог запуска
+    for (size_t i = 0; i < nodes.size(); i++) {
+        char command[32];
+        snprintf(command, sizeof(command), "SET ADDRESS %u", nodes[i].address);
+        bus.direct(i, command);
+        snprintf(command, sizeof(command), "@%u SET GROUP %u 1", nodes[i].address,
+                 nodes[i].address % 2 ? GROUP_ODD : GROUP_EVEN);
+        bus.direct(i, command);
+    }
+    size_t third = 2;  // Узел с адресом 3
+
+    std::vector<std::string> output = bus.transact("@3 SET PWM 40");
+    expect(onlyNode(output, third, "@3 OK\r\n"), "@3 SET PWM 40", "only node 3 answers, no log");
+    expect(dutyOf(bus, nodes[third], third) == 40 && dutyOf(bus, nodes[0], 0) == 0, "@3 SET PWM 40",
+           "only node 3 applies");
+
+    output = bus.transact("@3 BOGUS");
+    expect(onlyNode(output, third, "@3 ERROR: Unknown command\r\n"), "@3 BOGUS", "error is addressed too");
+
+    output = bus.transact("@* SET PWM 10");
+    bool allTen = true;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        allTen = allTen && dutyOf(bus, nodes[i], i) == 10;
+    }
+    expect(Bus::talkers(output) == 0, "@* SET PWM 10", "nobody answers or logs");
+    expect(allTen, "@* SET PWM 10", "all apply");
+
+    output = bus.transact("@200 SET PWM 70");
+    bool groupApplied = true;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        groupApplied = groupApplied && dutyOf(bus, nodes[i], i) == (nodes[i].address % 2 ? 10 : 70);
+    }
+    expect(Bus::talkers(output) == 0 && groupApplied, "@200 SET PWM 70", "even nodes apply, nobody answers");
+
+    output = bus.transact("SET PWM 99");
+    int talkers = Bus::talkers(output);
+    output = bus.transact("@150 SET PWM 99");
+    talkers += Bus::talkers(output);
+    bool unchanged = true;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        unchanged = unchanged && dutyOf(bus, nodes[i], i) == (nodes[i].address % 2 ? 10 : 70);
+    }
+    expect(talkers == 0 && unchanged, "SET PWM 99 / @150 SET PWM 99", "unaddressed and foreign lines discarded");
+
+    // Широковещательный STREAM отвергается молча: иначе передавали бы все узлы сразу
+    output = bus.transact("@* STREAM ALL 10");
+    std::vector<std::string> streamed = bus.collect(LISTEN_MS);
+    expect(Bus::talkers(output) == 0 && Bus::talkers(streamed) == 0, "@* STREAM ALL 10", "no node starts streaming");
+
+    output = bus.transact("@3 STREAM DUTY 10");
+    streamed = bus.collect(LISTEN_MS);
+    expect(Bus::talkers(output) == 1 && output[third].compare(0, 7, "@3 OK\r\n") == 0, "@3 STREAM DUTY 10",
+           "node 3 accepts");
+    expect(Bus::talkers(streamed) == 1 && countLines(streamed[third], "T ") >= 3, "@3 STREAM DUTY 10",
+           "only node 3 streams");
+    bus.transact("@3 STREAM OFF");
+    streamed = bus.collect(LISTEN_MS);
+    expect(Bus::talkers(streamed) == 0, "@3 STREAM OFF", "line is quiet again");
+
+    /**
+     * ПОТОК СЛУЧАЙНЫХ КОМАНД:
+     * 1. Каждая адресная SET PWM - ровно один ответ от своего узла
+     * 2. Остальные узлы отбрасывают строку до разбора (FOREIGN_LINES)
+     * 3. Запросы STATS - тоже чужие строки для остальных: между двумя опросами
+     *    каждый узел видит N-1 таких строк
+     */
+    std::vector<long> foreignBefore;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        foreignBefore.push_back(counterOf(bus, nodes[i], i, "FOREIGN_LINES"));
+    }
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> pickNode(0, nodeCount - 1);
+    std::uniform_int_distribution<int> pickDuty(0, 100);
+    std::vector<int> duties(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++) {
+        duties[i] = nodes[i].address % 2 ? 10 : 70;
+    }
+    int wrong = 0;
+    auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < randomCommands; i++) {
+        int index = pickNode(random);
+        int duty = pickDuty(random);
+        char command[32];
+        snprintf(command, sizeof(command), "@%u SET PWM %d", nodes[index].address, duty);
+        char expected[32];
+        snprintf(expected, sizeof(expected), "@%u OK\r\n", nodes[index].address);
+        output = bus.transact(command);
+        wrong += !onlyNode(output, index, expected);
+        duties[index] = duty;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    long foreign = 0;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        foreign += counterOf(bus, nodes[i], i, "FOREIGN_LINES") - foreignBefore[i];
+    }
+    for (size_t i = 0; i < nodes.size(); i++) {
+        wrong += dutyOf(bus, nodes[i], i) != duties[i];
+    }
+    char summary[64];
+    snprintf(summary, sizeof(summary), "%d random commands", randomCommands);
+    expect(wrong == 0, summary, "each executed and answered by one node");
+    expect(foreign == (long)(randomCommands + nodeCount) * (nodeCount - 1), summary,
+           "foreign lines dropped before parsing");
+    expect(bus.collisions() == 0, "whole run", "no two nodes answered one command");
+
+    for (Node& node : nodes) {
+        close(node.hubFd);
+    }
+    for (Node& node : nodes) {
+        kill(node.pid, SIGTERM);
+        waitpid(node.pid, nullptr, 0);
+    }
+
+    printf("nodes %d, random commands: %.2f s\n", nodeCount, seconds);
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
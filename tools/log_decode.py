@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+"""
+Декодер бинарного лога (SET LOG BIN).
+
+Читает поток байт из файла, stdin или последовательного порта (нужен pyserial),
+восстанавливает строки лога по таблице токенов и пропускает без изменений
+обычный текст (ответы на команды), который идёт по тому же UART.
+
+Запись лога - кадр 0x00 <COBS> 0x00 с тегом 0xFD и CRC16, как остальные
+бинарные кадры порта (src/uart/binary_protocol.h). Ответы на бинарные
+команды и выборки STREAM BIN пропускаются (с --frames печатаются в hex).
+
+  python tools/log_decode.py capture.bin
+  python tools/log_decode.py --port /dev/ttyUSB0 --baud 115200
+  python tools/log_decode.py --tokens .pio/build/esp32dev/log_tokens.json capture.bin
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import log_tokens  # noqa: E402
+from pwm_bin import cobs_decode, crc16  # noqa: E402
+
+LOG_TAG = 0xFD
+RESPONSE_SIZE = 7  # Ответ на бинарную команду; пакет лога всегда длиннее
+LEVELS = ('INFO', 'ERROR', 'DEBUG')
+SPEC = re.compile(r'%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l|z|j|t)?([diuxXcs%])')
+
+
+def load_tokens(path, src):
+    if path:
+        with open(path, encoding='utf-8') as handle:
+            return {int(token, 16): entry['format'] for token, entry in json.load(handle).items()}
+    tokens, _ = log_tokens.collect(src)
+    return {token: entry['format'] for token, entry in tokens.items()}
+
+
+def read_varint(payload, pos):
+    value = 0
+    shift = 0
+    while True:
+        byte = payload[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def render(fmt, payload, pos):
+    """Подставляет аргументы кадра в строку формата (в том же порядке, что на устройстве)."""
+    out = []
+    last = 0
+    for match in SPEC.finditer(fmt):
+        out.append(fmt[last:match.start()])
+        last = match.end()
+        flags, _, conversion = match.groups()
+        if conversion == '%':
+            out.append('%')
+            continue
+        if pos >= len(payload):
+            out.append('<?>')
+            continue
+        if conversion == 's':
+            length = payload[pos]
+            value = payload[pos + 1:pos + 1 + length].decode('utf-8', 'replace')
+            pos += 1 + length
+        else:
+            raw, pos = read_varint(payload, pos)
+            if conversion in 'di':
+                value = (raw >> 1) ^ -(raw & 1)
+            else:
+                value = raw
+            if conversion == 'u':
+                conversion = 'd'
+        out.append(('%' + flags + conversion) % value)
+    out.append(fmt[last:])
+    return ''.join(out)
+
+
+class Decoder:
+    """Делит поток на кадры 0x00 <COBS> 0x00 и текст между ними."""
+
+    def __init__(self, tokens, show_time, show_frames=False):
+        self.tokens = tokens
+        self.show_time = show_time
+        self.show_frames = show_frames
+        self.timestamp = 0
+        self.buffer = bytearray()
+        self.in_frame = False
+
+    def feed(self, data):
+        lines = []
+        for byte in data:
+            if byte == 0:
+                # Ноль закрывает непустой кадр, иначе открывает следующий ("00 00" между кадрами)
+                if self.in_frame and self.buffer:
+                    lines.append(self.flush())
+                    self.in_frame = False
+                elif not self.in_frame:
+                    lines.append(self.flush())
+                    self.in_frame = True
+            else:
+                self.buffer.append(byte)
+                if not self.in_frame and byte == 0x0A:
+                    lines.append(self.flush())
+        return ''.join(lines)
+
+    def flush(self):
+        chunk = bytes(self.buffer)
+        self.buffer.clear()
+        if not chunk:
+            return ''
+        if not self.in_frame:
+            return chunk.decode('utf-8', 'replace')
+        try:
+            packet = cobs_decode(chunk)
+        except ValueError:
+            packet = b''
+        valid = len(packet) > 2 and crc16(packet[:-2]) == int.from_bytes(packet[-2:], 'little')
+        if valid and len(packet) != RESPONSE_SIZE and packet[0] == LOG_TAG:
+            return self.decode_frame(packet[1], packet[2:-2]) + '\n'
+        if self.show_frames:
+            return '<frame %s%s>\n' % (packet.hex() if valid else chunk.hex(), '' if valid else ' bad')
+        return ''
+
+    def decode_frame(self, level, payload):
+        level = LEVELS[level] if level < len(LEVELS) else 'L%d' % level
+        try:
+            token = int.from_bytes(payload[0:3], 'little')
+            delta, pos = read_varint(payload, 3)
+            self.timestamp += delta
+            if token == 0:
+                dropped, _ = read_varint(payload, pos)
+                text = 'Logger dropped %d messages' % dropped
+            elif token in self.tokens:
+                text = render(self.tokens[token], payload, pos)
+            else:
+                text = '<unknown token %06x: %s>' % (token, payload[pos:].hex())
+        except (IndexError, ValueError, TypeError) as exc:
+            return '<corrupt frame %s: %s>' % (payload.hex(), exc)
+        prefix = '%10.3f ' % (self.timestamp / 1000.0) if self.show_time else ''
+        return '%s[%s] %s' % (prefix, level, text)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode tokenized Logger output')
+    parser.add_argument('input', nargs='?', default='-', help='capture file or - for stdin')
+    parser.add_argument('--tokens', help='log_tokens.json produced by the build')
+    parser.add_argument('--src', default=os.path.join(os.path.dirname(__file__), '..', 'src'),
+                        help='source tree to scan when --tokens is not given')
+    parser.add_argument('--port', help='serial port to read instead of a file')
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--no-time', action='store_true', help='omit device timestamps')
+    parser.add_argument('--frames', action='store_true', help='print non-log binary frames as hex')
+    args = parser.parse_args()
+
+    decoder = Decoder(load_tokens(args.tokens, args.src), not args.no_time, args.frames)
+
+    if args.port:
+        import serial  # pyserial
+        stream = serial.Serial(args.port, args.baud, timeout=0.1)
+    elif args.input == '-':
+        stream = sys.stdin.buffer
+    else:
+        stream = open(args.input, 'rb')
+
+    try:
+        while True:
+            chunk = stream.read(256)
+            if not chunk:
+                if args.port:
+                    continue
+                break
+            sys.stdout.write(decoder.feed(chunk))
+            sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    sys.stdout.write(decoder.flush())
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
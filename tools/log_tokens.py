@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""
+Сбор строк формата Logger в таблицу токенов для бинарного лога.
+
+Токен - FNV-1a 32 от строки формата, свёрнутый до 24 бит (тот же алгоритм,
+что fnv1a24() в src/common/logger.cpp). Токен 0 зарезервирован.
+
+Скрипт работает двумя способами:
+
+  * как extra_script PlatformIO (pre:) - при каждой сборке пишет
+    .pio/build/<env>/log_tokens.json и останавливает сборку при коллизии токенов;
+  * из командной строки:  python tools/log_tokens.py [--src src] [-o log_tokens.json]
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+LOG_CALL = re.compile(r'Logger::(info|error|debug)\s*\(')
+SOURCE_EXTENSIONS = ('.cpp', '.h')
+ESCAPES = {'n': '\n', 'r': '\r', 't': '\t', '\\': '\\', '"': '"', "'": "'", '0': '\0'}
+
+
+def fnv1a24(data):
+    value = 2166136261
+    for byte in data.encode('utf-8'):
+        value ^= byte
+        value = (value * 16777619) & 0xFFFFFFFF
+    return (value >> 24) ^ (value & 0xFFFFFF)
+
+
+def parse_literals(text, pos):
+    """Склеивает подряд идущие строковые литералы, начиная с pos."""
+    result = []
+    found = False
+    while True:
+        while pos < len(text) and text[pos] in ' \t\r\n':
+            pos += 1
+        if pos >= len(text) or text[pos] != '"':
+            break
+        found = True
+        pos += 1
+        while text[pos] != '"':
+            ch = text[pos]
+            if ch == '\\':
+                pos += 1
+                esc = text[pos]
+                if esc == 'x':
+                    match = re.match(r'[0-9a-fA-F]{1,2}', text[pos + 1:])
+                    result.append(chr(int(match.group(0), 16)))
+                    pos += len(match.group(0))
+                else:
+                    result.append(ESCAPES.get(esc, esc))
+            else:
+                result.append(ch)
+            pos += 1
+        pos += 1
+    return ''.join(result) if found else None
+
+
+def collect(src_dir):
+    """Возвращает {токен: {format, locations}} и список коллизий."""
+    tokens = {}
+    collisions = []
+    for root, _, files in os.walk(src_dir):
+        for name in sorted(files):
+            if not name.endswith(SOURCE_EXTENSIONS):
+                continue
+            path = os.path.join(root, name)
+            with open(path, encoding='utf-8') as handle:
+                text = handle.read()
+            for match in LOG_CALL.finditer(text):
+                fmt = parse_literals(text, match.end())
+                if fmt is None:
+                    continue
+                token = fnv1a24(fmt)
+                line = text.count('\n', 0, match.start()) + 1
+                location = '%s:%d' % (os.path.relpath(path, src_dir), line)
+                entry = tokens.setdefault(token, {'format': fmt, 'locations': []})
+                if entry['format'] != fmt or token == 0:
+                    collisions.append((token, entry['format'], fmt))
+                entry['locations'].append(location)
+    return tokens, collisions
+
+
+def write_table(tokens, output):
+    table = {'%06x' % token: entry for token, entry in sorted(tokens.items())}
+    with open(output, 'w', encoding='utf-8') as handle:
+        json.dump(table, handle, ensure_ascii=False, indent=2)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Build the Logger token table')
+    parser.add_argument('--src', default=os.path.join(os.path.dirname(__file__), '..', 'src'))
+    parser.add_argument('-o', '--output', default='log_tokens.json')
+    args = parser.parse_args()
+
+    tokens, collisions = collect(args.src)
+    for token, first, second in collisions:
+        print('Token collision %06x: "%s" vs "%s"' % (token, first, second), file=sys.stderr)
+    write_table(tokens, args.output)
+    print('%d log formats -> %s' % (len(tokens), args.output))
+    return 1 if collisions else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
+elif __name__ == 'SCons.Script':
+    # Запуск из PlatformIO (extra_scripts = pre:tools/log_tokens.py)
+    Import('env')  # noqa: F821
+    project_src = env.subst('$PROJECT_SRC_DIR')  # noqa: F821
+    build_dir = env.subst('$BUILD_DIR')  # noqa: F821
+    found, clashes = collect(project_src)
+    if clashes:
+        for token, first, second in clashes:
+            print('Token collision %06x: "%s" vs "%s"' % (token, first, second))
+        env.Exit(1)  # noqa: F821
+    os.makedirs(build_dir, exist_ok=True)
+    write_table(found, os.path.join(build_dir, 'log_tokens.json'))
@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+"""
+Отчёт о статическом ОЗУ готового образа прошивки.
+
+Читает таблицу символов ELF (nm -S -C) и печатает объекты в .data/.bss:
+отдельно статические объекты RTOS (стеки и TCB из Rtos::TaskStorage,
+хранилища очередей, таймеры) и крупнейшие прочие, плюс итоги. Сумма по
+объектам RTOS должна совпадать с "Static RTOS RAM" в логе при старте.
+
+Скрипт работает двумя способами:
+
+  * как extra_script PlatformIO (post:) - после линковки печатает отчёт;
+  * из командной строки:  python tools/mem_report.py firmware.elf [--nm xtensa-esp32-elf-nm]
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+RAM_TYPES = 'bBdDuVv'  # Шаблонные статические члены - u/V
+RTOS_SYMBOL = re.compile(r'TaskStorage<|StaticQueue<|queueStorage_|EventBus::queues_|TimerStorage')
+DEFAULT_TOP = 15
+
+
+def read_symbols(elf, nm):
+    output = subprocess.run([nm, '-S', '-C', '--size-sort', elf],
+                            check=True, capture_output=True, text=True).stdout
+    symbols = []
+    for line in output.splitlines():
+        parts = line.split(None, 3)
+        if len(parts) < 4 or parts[2] not in RAM_TYPES:
+            continue
+        symbols.append((int(parts[1], 16), parts[3]))
+    symbols.sort(reverse=True)
+    return symbols
+
+
+def report(symbols, top=DEFAULT_TOP):
+    rtos = [s for s in symbols if RTOS_SYMBOL.search(s[1])]
+    other = [s for s in symbols if not RTOS_SYMBOL.search(s[1])]
+    rtos_total = sum(size for size, _ in rtos)
+    total = sum(size for size, _ in symbols)
+
+    lines = ['Static RTOS objects:']
+    lines += ['  %7d  %s' % (size, name) for size, name in rtos]
+    lines.append('  %7d  total' % rtos_total)
+    lines.append('Largest other static objects:')
+    lines += ['  %7d  %s' % (size, name) for size, name in other[:top]]
+    lines.append('Static RAM (.data + .bss): %d bytes, RTOS %d bytes' % (total, rtos_total))
+    return '\n'.join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Static RAM report for the firmware ELF')
+    parser.add_argument('elf')
+    parser.add_argument('--nm', default='xtensa-esp32-elf-nm')
+    parser.add_argument('--top', type=int, default=DEFAULT_TOP)
+    args = parser.parse_args()
+
+    print(report(read_symbols(args.elf, args.nm), args.top))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
+elif __name__ == 'SCons.Script':
+    # Запуск из PlatformIO (extra_scripts = post:tools/mem_report.py)
+    Import('env')  # noqa: F821
+
+    def print_report(source, target, env):
+        compiler = env.subst('$CC')
+        nm = re.sub(r'gcc(\.exe)?$', r'nm\1', compiler)
+        elf = target[0].get_abspath()
+        print(report(read_symbols(elf, nm)))
+
+    env.AddPostAction(os.path.join('$BUILD_DIR', '${PROGNAME}.elf'), print_report)  # noqa: F821
@@ -0,0 +1,138 @@
+/**
+ * Хостовая модель замкнутого контура ШИМ (src/pwm/pid.h).
+ *
+ * Объект - светодиод с фотодатчиком: яркость пропорциональна скважности и
+ * напряжению питания, датчик - RC-фильтр первого порядка и 12-битный АЦП с
+ * шумом. Регулятор работает на частоте PWM_LOOP_RATE_HZ с дрожанием периода;
+ * по ходу прогона питание проседает ступенькой и затем медленно дрейфует.
+ *
+ * Печатает переходный процесс и итог: время установления, перерегулирование,
+ * установившуюся ошибку до и после просадки. Код возврата 1 - контур не
+ * удержал задание в допуске.
+ *
+ * Сборка и запуск:
+ *   g++ -O2 -std=gnu++17 -Isrc tools/pid_sim.cpp -o pid_sim
+ *   ./pid_sim [KP_MILLI KI_MILLI KD_MILLI] [--trace]
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include "common/config.h"
+#include "pwm/pid.h"
+
+namespace {
+
+const double DURATION_S = 4.0;
+const double SENSOR_TAU_S = 0.020;        // RC-фильтр фотодатчика
+const double SUPPLY_NOMINAL_V = 12.0;
+const double SUPPLY_STEP_V = 10.0;        // Просадка питания в момент SUPPLY_STEP_S
+const double SUPPLY_STEP_S = 1.5;
+const double SUPPLY_DRIFT_V_PER_S = 0.5;  // Дрейф после просадки
+const double FULL_SCALE_V = 14.4;         // Яркость 100% при таком питании = полная шкала датчика
+const double JITTER_US = 50.0;            // Разброс периода регулятора
+const int ADC_NOISE_LSB = 2;
+const double TOLERANCE = 0.01;            // Допуск установившейся ошибки, доля шкалы
+const double SETTLE_LIMIT_S = 0.3;
+const int32_t TARGET = 32768;             // 50% шкалы датчика
+
+struct Window {
+    double sumError;
+    double maxError;
+    int samples;
+};
+
+void account(Window& window, double error) {
+    window.sumError += std::fabs(error);
+    window.maxError = std::fmax(window.maxError, std::fabs(error));
+    window.samples++;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    uint32_t kpMilli = PWM_LOOP_KP_MILLI;
+    uint32_t kiMilli = PWM_LOOP_KI_MILLI;
+    uint32_t kdMilli = PWM_LOOP_KD_MILLI;
+    bool trace = false;
+    int position = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--trace") == 0) {
+            trace = true;
+        } else if (position < 3) {
+            uint32_t value = strtoul(argv[i], nullptr, 10);
+            (position == 0 ? kpMilli : position == 1 ? kiMilli : kdMilli) = value;
+            position++;
+        }
+    }
+
+    PIDController pid;
+    pid.setGains(pidGainsFromMilli(kpMilli, kiMilli, kdMilli, PWM_LOOP_RATE_HZ));
+    pid.reset(0, 0);
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<double> jitter(-JITTER_US, JITTER_US);
+    std::uniform_int_distribution<int> noise(-ADC_NOISE_LSB, ADC_NOISE_LSB);
+
+    const double periodS = 1.0 / PWM_LOOP_RATE_HZ;
+    double time = 0;
+    double sensor = 0;          // Выход RC-фильтра, доля шкалы
+    int32_t duty = 0;
+    double peak = 0;
+    double settledAt = -1;
+    int saturatedSamples = 0;
+    Window beforeStep = {};
+    Window afterStep = {};
+
+    while (time < DURATION_S) {
+        double step = periodS + jitter(random) * 1e-6;
+        double supply = time < SUPPLY_STEP_S ? SUPPLY_NOMINAL_V
+                                             : SUPPLY_STEP_V - SUPPLY_DRIFT_V_PER_S * (time - SUPPLY_STEP_S);
+        double light = (duty / 65535.0) * supply / FULL_SCALE_V;
+        sensor += (light - sensor) * (1.0 - std::exp(-step / SENSOR_TAU_S));
+        time += step;
+
+        // АЦП 12 бит -> Q16, как источник обратной связи на устройстве
+        int adc = (int)std::lround(sensor * 4095) + noise(random);
+        adc = adc < 0 ? 0 : (adc > 4095 ? 4095 : adc);
+        int32_t measurement = adc << 4;
+
+        duty = pid.update(TARGET, measurement);
+        saturatedSamples += pid.isSaturated();
+
+        double error = (measurement - TARGET) / 65536.0;
+        if (time < SUPPLY_STEP_S) {
+            peak = std::fmax(peak, (double)measurement);
+            if (settledAt < 0 && std::fabs(error) <= TOLERANCE * 2) {
+                settledAt = time;
+            } else if (settledAt >= 0 && std::fabs(error) > TOLERANCE * 2) {
+                settledAt = -1;
+            }
+        }
+        // Окна установившегося режима: перед просадкой и в конце прогона
+        if (time > SUPPLY_STEP_S - 0.5 && time < SUPPLY_STEP_S) {
+            account(beforeStep, error);
+        } else if (time > DURATION_S - 0.5) {
+            account(afterStep, error);
+        }
+
+        if (trace) {
+            printf("%.4f %d %d %.2f\n", time, measurement, duty, supply);
+        }
+    }
+
+    double overshoot = (peak - TARGET) / 65536.0;
+    double meanBefore = beforeStep.sumError / beforeStep.samples;
+    double meanAfter = afterStep.sumError / afterStep.samples;
+    printf("gains: kp %u ki %u kd %u (milli), rate %d Hz\n", kpMilli, kiMilli, kdMilli, PWM_LOOP_RATE_HZ);
+    printf("settling (2%%): %.1f ms, overshoot: %.2f%%\n", settledAt * 1000, overshoot > 0 ? overshoot * 100 : 0);
+    printf("steady error before supply step: mean %.3f%% max %.3f%%\n", meanBefore * 100, beforeStep.maxError * 100);
+    printf("steady error after step + drift: mean %.3f%% max %.3f%%\n", meanAfter * 100, afterStep.maxError * 100);
+    printf("saturated samples: %d\n", saturatedSamples);
+
+    bool ok = settledAt >= 0 && settledAt <= SETTLE_LIMIT_S && meanBefore <= TOLERANCE && meanAfter <= TOLERANCE;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
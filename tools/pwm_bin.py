@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""
+Клиент бинарного протокола команд (src/uart/binary_protocol.h).
+
+Все записи из командной строки уходят одним кадром и применяются по порядку:
+
+  python tools/pwm_bin.py --port /dev/ttyUSB0 set 0 50 set 1 70 fade 2 100 500
+  python tools/pwm_bin.py --port /dev/ttyUSB0 get
+  python tools/pwm_bin.py --port /dev/ttyUSB0 text          # назад к текстовым командам
+  python tools/pwm_bin.py --encode set 0 50 > frame.bin     # только собрать кадр
+
+Записи: set CH PCT | permille CH X | fade CH PCT MS | get | dither CH 0|1 | text
+"""
+
+import argparse
+import struct
+import sys
+
+OP_SET_PWM = 0x01
+OP_SET_PERMILLE = 0x02
+OP_FADE = 0x03
+OP_GET_PWM = 0x04
+OP_SET_DITHER = 0x05
+OP_TEXT_MODE = 0x7F
+
+# имя записи: (opcode, число аргументов)
+RECORDS = {
+    'set': (OP_SET_PWM, 2),
+    'permille': (OP_SET_PERMILLE, 2),
+    'fade': (OP_FADE, 3),
+    'get': (OP_GET_PWM, 0),
+    'dither': (OP_SET_DITHER, 2),
+    'text': (OP_TEXT_MODE, 0),
+}
+
+STATUSES = ('ACK', 'NACK_CRC', 'NACK_FORMAT', 'NACK_OPCODE', 'NACK_RANGE',
+            'NACK_REJECTED', 'NACK_UNSUPPORTED')
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_index = 0
+    code = 1
+    for byte in data:
+        if byte:
+            out.append(byte)
+            code += 1
+        if not byte or code == 0xFF:
+            out[code_index] = code
+            code_index = len(out)
+            out.append(0)
+            code = 1
+    out[code_index] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    pos = 0
+    while pos < len(data):
+        code = data[pos]
+        if code == 0 or pos + code > len(data):
+            raise ValueError('bad COBS block')
+        out += data[pos + 1:pos + code]
+        pos += code
+        if code < 0xFF and pos < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode_record(name, args):
+    opcode, count = RECORDS[name]
+    if len(args) != count:
+        raise ValueError('%s expects %d arguments' % (name, count))
+    if opcode == OP_FADE:
+        return struct.pack('<BBHH', opcode, args[0], args[1], args[2])
+    channel = args[0] if args else 0
+    value = args[1] if len(args) > 1 else 0
+    return struct.pack('<BBH', opcode, channel, value)
+
+
+def parse_records(words):
+    records = []
+    pos = 0
+    while pos < len(words):
+        name = words[pos]
+        if name not in RECORDS:
+            raise ValueError('unknown record "%s"' % name)
+        count = RECORDS[name][1]
+        args = [int(word, 0) for word in words[pos + 1:pos + 1 + count]]
+        records.append(encode_record(name, args))
+        pos += 1 + count
+    return records
+
+
+def encode_frame(sequence, records):
+    packet = bytes([sequence & 0xFF]) + b''.join(records)
+    packet += struct.pack('<H', crc16(packet))
+    return b'\x00' + cobs_encode(packet) + b'\x00'
+
+
+def decode_response(chunk):
+    """Возвращает (seq, status, applied, value) или None, если это не кадр ответа."""
+    try:
+        packet = cobs_decode(chunk)
+    except ValueError:
+        return None
+    if len(packet) != 7 or crc16(packet[:5]) != struct.unpack('<H', packet[5:])[0]:
+        return None
+    return struct.unpack('<BBBH', packet[:5])
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Send binary PWM commands')
+    parser.add_argument('records', nargs='+', help='set CH PCT | permille CH X | fade CH PCT MS | get | dither CH 0|1 | text')
+    parser.add_argument('--port', help='serial port')
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--seq', type=int, default=1, help='sequence number (0-255)')
+    parser.add_argument('--encode', action='store_true', help='write the frame to stdout instead of sending it')
+    args = parser.parse_args()
+
+    frame = encode_frame(args.seq, parse_records(args.records))
+    if args.encode or not args.port:
+        sys.stdout.buffer.write(frame)
+        return 0
+
+    import serial  # pyserial
+    port = serial.Serial(args.port, args.baud, timeout=1.0)
+    port.write(frame)
+    buffer = bytearray()
+    while True:
+        data = port.read(64)
+        if not data:
+            print('timeout', file=sys.stderr)
+            return 1
+        buffer += data
+        # Между нулями - кадры ответа или строки лога
+        while b'\x00' in buffer:
+            chunk, _, rest = bytes(buffer).partition(b'\x00')
+            buffer = bytearray(rest)
+            if not chunk:
+                continue
+            response = decode_response(chunk)
+            if response is None:
+                sys.stdout.write(chunk.decode('utf-8', 'replace'))
+                continue
+            sequence, status, applied, value = response
+            if sequence != args.seq & 0xFF:
+                continue
+            name = STATUSES[status] if status < len(STATUSES) else 'STATUS_%d' % status
+            print('%s applied=%d value=%d' % (name, applied, value))
+            return 0 if status == 0 else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
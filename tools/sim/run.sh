@@ -0,0 +1,47 @@
+#!/bin/sh
+# Прогон сценариев симулятора (src/sim/sim_main.cpp) против эталонных трасс.
+#
+#   tools/sim/run.sh                 все tools/sim/*.sim
+#   tools/sim/run.sh clicks          один сценарий
+#   UPDATE=1 tools/sim/run.sh        перезаписать эталоны после осознанного изменения поведения
+#
+# Симулятор собирается в [env:native] (pio run -e native); без PlatformIO -
+# напрямую g++ с теми же флагами. Готовый бинарник можно задать через SIM=.
+
+set -e
+cd "$(dirname "$0")/../.."
+
+if [ -z "$SIM" ]; then
+    if command -v pio >/dev/null 2>&1; then
+        pio run -e native >/dev/null
+        SIM=.pio/build/native/program
+    else
+        mkdir -p .pio/sim
+        SIM=.pio/sim/program
+        g++ -std=gnu++17 -O2 -DDEBUG -DHAL_NATIVE -Isrc/hal/native/include \
+            src/button/*.cpp src/pwm/pwm.cpp src/pwm/pwm_actor.cpp src/pwm/sequencer.cpp \
+            src/pwm/closed_loop.cpp src/uart/*.cpp src/led/*.cpp src/app/*.cpp src/common/stats.cpp \
+            src/common/trace.cpp src/common/logger.cpp src/common/rtos.cpp src/common/event_bus.cpp \
+            src/hal/native/*.cpp src/sim/*.cpp -o "$SIM"
+    fi
+fi
+
+if [ $# -gt 0 ]; then
+    scenarios=""
+    for name in "$@"; do
+        scenarios="$scenarios tools/sim/$name.sim"
+    done
+else
+    scenarios=$(ls tools/sim/*.sim)
+fi
+
+failed=0
+for scenario in $scenarios; do
+    golden="${scenario%.sim}.golden"
+    if [ -n "$UPDATE" ]; then
+        "$SIM" "$scenario" > "$golden"
+    elif ! "$SIM" "$scenario" --golden "$golden"; then
+        failed=1
+    fi
+done
+exit $failed
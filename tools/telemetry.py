@@ -0,0 +1,231 @@
+#!/usr/bin/env python3
+"""
+Приём потока телеметрии (команда STREAM, src/uart/telemetry.h).
+
+Разбирает оба формата выборок: текстовые строки "T ..." и COBS-кадры с
+тегом 0xFE (формат - в src/uart/binary_protocol.h). Каждая выборка
+печатается одной строкой; по номерам выборок считаются пропуски, в конце
+- итог: принято, пропущено, потеряно устройством, фактическая частота.
+
+  python tools/telemetry.py --port /dev/ttyUSB0 --stream "ALL 100 BIN" --seconds 10
+  python tools/telemetry.py --port /dev/ttyUSB0                  # поток уже включён
+  python tools/telemetry.py capture.bin                          # сохранённый вывод порта
+
+Строки лога и ответы на команды пропускаются (с --verbose печатаются в stderr).
+"""
+
+import argparse
+import re
+import struct
+import sys
+import time
+
+from pwm_bin import cobs_decode, crc16
+
+TELEMETRY_TAG = 0xFE
+FIELD_DUTY = 1
+FIELD_BUTTON = 2
+FIELD_COUNTERS = 4
+MAX_CHANNELS = 16
+
+TEXT_SAMPLE = re.compile(r'^T (\d+) (\d+) (\d+)(.*)$')
+
+
+def parse_text(line):
+    """Возвращает словарь выборки или None, если строка - не выборка."""
+    match = TEXT_SAMPLE.match(line)
+    if not match:
+        return None
+    sample = {'seq': int(match.group(1)), 'time_us': int(match.group(2)),
+              'dropped': int(match.group(3)), 'seq_bits': 32}
+    words = match.group(4).split()
+    pos = 0
+    while pos < len(words):
+        word = words[pos]
+        if word == 'DUTY':
+            sample['duty'] = {}
+            pos += 1
+            while pos < len(words) and ':' in words[pos]:
+                channel, permille = words[pos].split(':')
+                sample['duty'][int(channel)] = int(permille)
+                pos += 1
+        elif word == 'BTN':
+            sample['pressed'] = int(words[pos + 1])
+            sample['events'] = int(words[pos + 2])
+            pos += 3
+        elif word == 'CNT':
+            sample['commands'], sample['rx_bytes'], sample['applied'] = map(int, words[pos + 1:pos + 4])
+            pos += 4
+        else:
+            return None
+    return sample
+
+
+def parse_frame(chunk):
+    """Возвращает словарь выборки или None, если кадр - не выборка (ответ, мусор)."""
+    try:
+        packet = cobs_decode(chunk)
+    except ValueError:
+        return None
+    if len(packet) < 12 or packet[0] != TELEMETRY_TAG:
+        return None
+    if crc16(packet[:-2]) != struct.unpack('<H', packet[-2:])[0]:
+        return None
+    seq, time_us, dropped, fields = struct.unpack('<HIHB', packet[1:10])
+    sample = {'seq': seq, 'time_us': time_us, 'dropped': dropped, 'seq_bits': 16}
+    pos = 10
+    body = packet[:-2]
+    try:
+        if fields & FIELD_DUTY:
+            mask, = struct.unpack('<H', body[pos:pos + 2])
+            pos += 2
+            sample['duty'] = {}
+            for channel in range(MAX_CHANNELS):
+                if mask & (1 << channel):
+                    duty16, = struct.unpack('<H', body[pos:pos + 2])
+                    sample['duty'][channel] = (duty16 * 1000 + 32767) // 65535
+                    pos += 2
+        if fields & FIELD_BUTTON:
+            sample['pressed'], sample['events'] = struct.unpack('<BI', body[pos:pos + 5])
+            pos += 5
+        if fields & FIELD_COUNTERS:
+            sample['commands'], sample['rx_bytes'], sample['applied'] = struct.unpack('<III', body[pos:pos + 12])
+            pos += 12
+    except struct.error:
+        return None
+    return sample if pos == len(body) else None
+
+
+def format_sample(sample):
+    parts = ['%6d %10d' % (sample['seq'], sample['time_us'])]
+    if 'duty' in sample:
+        parts.append('duty ' + ' '.join('%d:%d' % item for item in sorted(sample['duty'].items())))
+    if 'pressed' in sample:
+        parts.append('button %d events %d' % (sample['pressed'], sample['events']))
+    if 'commands' in sample:
+        parts.append('commands %d rx %d applied %d' % (sample['commands'], sample['rx_bytes'], sample['applied']))
+    return '  '.join(parts)
+
+
+class Summary:
+    def __init__(self):
+        self.received = 0
+        self.gaps = 0
+        self.missing = 0
+        self.device_dropped = 0
+        self.previous = None
+        self.elapsed_us = 0
+
+    def add(self, sample):
+        # Смена формата - новый поток (STREAM перезапущен), номера идут заново
+        if self.previous is not None and self.previous['seq_bits'] != sample['seq_bits']:
+            self.previous = None
+        if self.previous is not None:
+            modulo = 1 << sample['seq_bits']
+            step = (sample['seq'] - self.previous['seq']) % modulo
+            if step > 1:
+                self.gaps += 1
+                self.missing += step - 1
+            self.elapsed_us += (sample['time_us'] - self.previous['time_us']) % (1 << 32)
+        self.previous = sample
+        self.received += 1
+        self.device_dropped = sample['dropped']
+
+    def report(self, out):
+        rate = (self.received - 1) * 1e6 / self.elapsed_us if self.elapsed_us else 0
+        print('received %d, gaps %d (%d samples missing), dropped on device %d, rate %.1f Hz'
+              % (self.received, self.gaps, self.missing, self.device_dropped, rate), file=out)
+
+
+class StreamDecoder:
+    """Делит поток на кадры 0x00 <COBS> 0x00 и текстовые строки между ними."""
+
+    def __init__(self, on_sample, on_other):
+        self.buffer = bytearray()
+        self.in_frame = False
+        self.on_sample = on_sample
+        self.on_other = on_other
+
+    def feed(self, data):
+        for byte in data:
+            if byte == 0:
+                # Ноль закрывает непустой кадр, иначе открывает следующий ("00 00" между кадрами)
+                if self.in_frame and self.buffer:
+                    self.flush()
+                    self.in_frame = False
+                elif not self.in_frame:
+                    self.flush()
+                    self.in_frame = True
+            elif not self.in_frame and byte == 0x0A:
+                self.flush()
+            else:
+                self.buffer.append(byte)
+
+    def flush(self):
+        if not self.buffer:
+            return
+        chunk = bytes(self.buffer)
+        self.buffer.clear()
+        sample = parse_frame(chunk) if self.in_frame else None
+        if sample is not None:
+            self.on_sample(sample)
+            return
+        # Ответ на бинарную команду или текст, принятый за кадр при сбое синхронизации
+        for line in chunk.split(b'\n'):
+            sample = parse_text(line.decode('utf-8', 'replace').strip())
+            if sample is None:
+                if line.strip():
+                    self.on_other(line)
+            else:
+                self.on_sample(sample)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Receive STREAM telemetry samples')
+    parser.add_argument('input', nargs='?', help='captured port output (default: stdin unless --port)')
+    parser.add_argument('--port', help='serial port')
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--stream', help='arguments for STREAM, e.g. "ALL 100 BIN"; STREAM OFF on exit')
+    parser.add_argument('--seconds', type=float, default=0, help='stop after this time (0 - until Ctrl+C)')
+    parser.add_argument('--quiet', action='store_true', help='print only the summary')
+    parser.add_argument('--verbose', action='store_true', help='print non-sample output to stderr')
+    args = parser.parse_args()
+
+    summary = Summary()
+
+    def on_sample(sample):
+        summary.add(sample)
+        if not args.quiet:
+            print(format_sample(sample))
+
+    def on_other(chunk):
+        if args.verbose:
+            print(chunk.decode('utf-8', 'replace').rstrip(), file=sys.stderr)
+
+    decoder = StreamDecoder(on_sample, on_other)
+
+    if not args.port:
+        source = open(args.input, 'rb') if args.input else sys.stdin.buffer
+        decoder.feed(source.read())
+        decoder.flush()
+        summary.report(sys.stderr)
+        return 0 if summary.received else 1
+
+    import serial  # pyserial
+    port = serial.Serial(args.port, args.baud, timeout=0.1)
+    if args.stream:
+        port.write(('STREAM %s\n' % args.stream).encode())
+    deadline = time.monotonic() + args.seconds if args.seconds else None
+    try:
+        while deadline is None or time.monotonic() < deadline:
+            decoder.feed(port.read(4096))
+    except KeyboardInterrupt:
+        pass
+    if args.stream:
+        port.write(b'STREAM OFF\n')
+    summary.report(sys.stderr)
+    return 0 if summary.received else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
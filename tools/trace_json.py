@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""
+Выгрузка трассы (команда TRACE DUMP) -> JSON для chrome://tracing и Perfetto.
+
+Каждый корреляционный ID - отдельная строка таймлайна: одно нажатие кнопки
+(процесс "Button") или одна строка/кадр UART (процесс "UART"). Интервалы между
+соседними этапами - отдельные отрезки (EDGE->ACCEPT, LINE->PARSE, ...), поверх
+них общий отрезок от первого до последнего этапа.
+
+  python tools/trace_json.py --port /dev/ttyUSB0 -o trace.json   # послать TRACE DUMP и прочитать
+  python tools/trace_json.py dump.txt -o trace.json              # уже сохранённый вывод
+  python tools/trace_json.py < dump.txt > trace.json
+
+Строки, не относящиеся к выгрузке (лог, ответы), пропускаются. Самые долгие
+взаимодействия печатаются в stderr.
+"""
+
+import argparse
+import json
+import re
+import sys
+
+BEGIN_LINE = re.compile(r'TRACE BEGIN (\d+) (\d+) (\d+)')
+RECORD_LINE = re.compile(r'TRACE (\d+) (\d+) ([A-Z]+) (\d+)')
+END_LINE = re.compile(r'TRACE END')
+
+BUTTON_STAGES = ('EDGE', 'ACCEPT', 'GESTURE')
+PROCESSES = {'Button': 1, 'UART': 2}
+DEFAULT_TOP = 5
+
+
+def parse_dump(lines):
+    """Возвращает (записи, потеряно); время записей - мкс относительно конца выгрузки."""
+    now = None
+    lost = 0
+    records = []
+    for line in lines:
+        match = BEGIN_LINE.search(line)
+        if match:
+            # Повторная выгрузка в том же вводе заменяет предыдущую
+            lost, now = int(match.group(2)), int(match.group(3))
+            records = []
+            continue
+        if END_LINE.search(line):
+            continue
+        match = RECORD_LINE.search(line)
+        if match and now is not None:
+            time_us, trace_id, stage, arg = match.groups()
+            # Метки 32-битные: отсчитываем назад от времени выгрузки, переполнение не мешает
+            age = (now - int(time_us)) & 0xFFFFFFFF
+            records.append((-age, int(trace_id), stage, int(arg)))
+    return records, lost
+
+
+def group_by_id(records):
+    traces = {}
+    for record in records:
+        traces.setdefault(record[1], []).append(record)
+    for stages in traces.values():
+        stages.sort(key=lambda record: record[0])
+    return traces
+
+
+def to_chrome(traces):
+    origin = min((stages[0][0] for stages in traces.values()), default=0)
+    events = []
+    for name, pid in PROCESSES.items():
+        events.append({'ph': 'M', 'name': 'process_name', 'pid': pid, 'args': {'name': name}})
+
+    for trace_id, stages in sorted(traces.items()):
+        pid = PROCESSES['Button' if stages[0][2] in BUTTON_STAGES else 'UART']
+        events.append({'ph': 'M', 'name': 'thread_name', 'pid': pid, 'tid': trace_id,
+                       'args': {'name': '#%d' % trace_id}})
+
+        first, last = stages[0][0], stages[-1][0]
+        events.append({'ph': 'X', 'name': 'total', 'pid': pid, 'tid': trace_id,
+                       'ts': first - origin, 'dur': last - first})
+        for previous, current in zip(stages, stages[1:]):
+            events.append({'ph': 'X', 'name': '%s->%s' % (previous[2], current[2]),
+                           'pid': pid, 'tid': trace_id, 'ts': previous[0] - origin,
+                           'dur': current[0] - previous[0], 'args': {'arg': current[3]}})
+        for time_us, _, stage, arg in stages:
+            events.append({'ph': 'i', 's': 't', 'name': stage, 'pid': pid, 'tid': trace_id,
+                           'ts': time_us - origin, 'args': {'arg': arg}})
+    return {'traceEvents': events, 'displayTimeUnit': 'ms'}
+
+
+def summary(traces, lost, top=DEFAULT_TOP):
+    lines = ['%d traces, %d records overwritten before the dump' % (len(traces), lost)]
+    durations = sorted(((stages[-1][0] - stages[0][0], trace_id, stages)
+                        for trace_id, stages in traces.items()), reverse=True)
+    for duration, trace_id, stages in durations[:top]:
+        path = ' '.join('%s+%d' % (stage[2], stage[0] - stages[0][0]) for stage in stages)
+        lines.append('  #%-5d %8d us  %s' % (trace_id, duration, path))
+    return '\n'.join(lines)
+
+
+def read_port(port_name, baud, timeout):
+    import serial  # pyserial
+    port = serial.Serial(port_name, baud, timeout=timeout)
+    port.reset_input_buffer()
+    port.write(b'TRACE DUMP\n')
+    lines = []
+    while True:
+        raw = port.readline()
+        if not raw:
+            raise RuntimeError('timeout waiting for TRACE END')
+        line = raw.decode('utf-8', 'replace')
+        lines.append(line)
+        if END_LINE.search(line):
+            return lines
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert a TRACE DUMP to Chrome trace JSON')
+    parser.add_argument('input', nargs='?', help='saved dump (default: stdin)')
+    parser.add_argument('--port', help='serial port: send TRACE DUMP and read the reply')
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--timeout', type=float, default=2.0)
+    parser.add_argument('-o', '--output', help='JSON file (default: stdout)')
+    parser.add_argument('--top', type=int, default=DEFAULT_TOP, help='slowest traces to print')
+    args = parser.parse_args()
+
+    if args.port:
+        lines = read_port(args.port, args.baud, args.timeout)
+    elif args.input:
+        with open(args.input, encoding='utf-8', errors='replace') as source:
+            lines = source.readlines()
+    else:
+        lines = sys.stdin.readlines()
+
+    records, lost = parse_dump(lines)
+    if not records:
+        print('no TRACE records found', file=sys.stderr)
+        return 1
+    traces = group_by_id(records)
+    print(summary(traces, lost, args.top), file=sys.stderr)
+
+    output = open(args.output, 'w') if args.output else sys.stdout
+    json.dump(to_chrome(traces), output)
+    if args.output:
+        output.close()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())